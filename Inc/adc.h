@@ -2,8 +2,70 @@
 #define ADC_H_
 
 #include <stdint.h>
+#include "filter.h"
+
+#define ADC_CH_TEMP             16  // Canal del sensor de temperatura interno
+#define ADC_CH_VREFINT          17  // Canal de la referencia interna
+#define ADC_SCAN_MAX_CHANNELS   18  // Canales 0-15 externos, 16 y 17 internos
+#define ADC_CLOCK_HZ            14000000 // Reloj del ADC (HSI14, CKMODE = 0)
+#define ADC_SAMPLING_MAX_RATE   (ADC_CLOCK_HZ / 14) // 1.5 + 12.5 ciclos por conversión (1Msps)
+#define ADC_FILTER_MAX_OS_BITS  3   // Bits extra de sobremuestreo del filtro de temperatura (lectura en Q3)
+#define ADC_FILTER_MAX_WINDOW   4   // log2 de la ventana máxima de la media móvil de temperatura
+#define ADC_SENSOR_SETTLE_MS    100 // Estabilización del sensor y VREFINT tras un arranque en frío
+#define ADC_ENABLE_SETTLE_MS    20  // Espera tras activar el ADC antes de la primera conversión (arranque en frío)
+#define ADC_WARM_SETTLE_MS      1   // Cada una de las dos esperas tras un reset en caliente (alimentación ya estable)
+#define ADC_ALARM_MAX_MDEG      300000 // Umbrales de la alarma entre -300°C y 300°C (fuera del rango del sensor: ese lado nunca avisa)
+
+// Tiempo de muestreo en ciclos de reloj del ADC (valor de ADC_SMPR)
+typedef enum
+{
+    ADC_SMP_1_5,
+    ADC_SMP_7_5,
+    ADC_SMP_13_5,
+    ADC_SMP_28_5,
+    ADC_SMP_41_5,
+    ADC_SMP_55_5,
+    ADC_SMP_71_5,
+    ADC_SMP_239_5
+} adc_smp_t;
+
+// Canal de un barrido y su tiempo de muestreo
+typedef struct
+{
+    uint8_t channel;        // 0-15 pines externos, ADC_CH_TEMP o ADC_CH_VREFINT
+    adc_smp_t smp;          // Tiempo de muestreo del canal
+} adc_scan_channel_t;
+
+// Aviso de que una mitad del buffer de muestreo está lista para procesarse
+typedef void (*adc_block_cb_t)(const uint16_t *samples, uint16_t count);
+
+// Estado de la alarma de temperatura del watchdog analógico
+typedef enum
+{
+    ADC_ALARM_OFF,          // Watchdog desactivado
+    ADC_ALARM_NORMAL,       // Temperatura dentro de la ventana
+    ADC_ALARM_HIGH,         // Por encima del umbral alto, hasta bajar de él la histéresis
+    ADC_ALARM_LOW           // Por debajo del umbral bajo, hasta superarlo la histéresis
+} adc_alarm_t;
+
+// Aviso de cambio de estado de la alarma, desde la ISR del ADC
+typedef void (*adc_alarm_cb_t)(adc_alarm_t state);
 
 void adc_conf(void);
+uint8_t adc_ready(void);
 int32_t get_temperature(void);
+int32_t get_temperature_mdeg(void);
+int32_t adc_temp_mdeg_from_raw(uint16_t raw);
+uint8_t adc_temp_filter(uint8_t os_bits, filter_mode_t mode, uint8_t shift);
+uint32_t adc_get_vdd(void);
+uint32_t adc_sampling_start(uint8_t channel, uint32_t rate_hz, uint16_t *buf, uint16_t len, adc_block_cb_t cb);
+void adc_sampling_stop(void);
+uint8_t adc_scan_config(const adc_scan_channel_t *channels, uint8_t count);
+uint8_t adc_scan_start(uint16_t *results);
+uint8_t adc_scan_busy(void);
+uint8_t adc_scan_read(uint16_t *results);
+uint8_t adc_temp_alarm(int32_t low_mdeg, int32_t high_mdeg, int32_t hyst_mdeg, adc_alarm_cb_t cb);
+void adc_temp_alarm_off(void);
+adc_alarm_t adc_temp_alarm_state(void);
 
 #endif // ADC_H_
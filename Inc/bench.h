@@ -0,0 +1,15 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdint.h>
+
+#define BENCH_RUNS          15  // Medidas por benchmark (impar: la mediana es la central)
+#define BENCH_UART_LEN      64  // Bytes de la cadena de los benchmarks de uart_send_string()
+
+#ifdef BENCH_BUILD
+
+void bench_run(void);
+
+#endif // BENCH_BUILD
+
+#endif // BENCH_H_
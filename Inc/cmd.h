@@ -0,0 +1,31 @@
+#ifndef CMD_H_
+#define CMD_H_
+
+#include <stdint.h>
+
+#define CMD_LINE_MAX        64  // Longitud máxima de una línea de comandos (sin terminador)
+#define CMD_MAX_ARGS        16  // Argumentos numéricos por comando
+#define CMD_MAX_DIGITS      9   // Dígitos por argumento (hasta 999999999, sin desbordar 32 bits)
+#define CMD_SEPARATOR       ';' // Separador de comandos en una misma línea
+
+// Función que ejecuta un comando con sus argumentos ya validados
+typedef void (*cmd_handler_t)(uint8_t argc, const uint32_t *argv);
+
+// Entrada de la tabla de comandos
+typedef struct
+{
+    const char *name;       // Nombre en mayúsculas (se compara sin distinguir mayúsculas)
+    const char *usage;      // Sintaxis de los argumentos para la ayuda (p.ej. "<0-99>")
+    const char *help;       // Descripción para la ayuda
+    uint8_t min_args;       // Número mínimo de argumentos
+    uint8_t max_args;       // Número máximo de argumentos (hasta CMD_MAX_ARGS)
+    uint32_t max_value;     // Valor máximo de cada argumento
+    cmd_handler_t handler;
+} cmd_entry_t;
+
+void cmd_init(const cmd_entry_t *table, uint8_t count);
+void cmd_feed(char c);
+void cmd_poll(void);
+void cmd_print_help(void);
+
+#endif // CMD_H_
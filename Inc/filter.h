@@ -0,0 +1,39 @@
+#ifndef FILTER_H_
+#define FILTER_H_
+
+#include <stdint.h>
+
+#define FILTER_OS_MAX_BITS  4   // Bits extra máximos por sobremuestreo (4^4 = 256 muestras por salida)
+#define FILTER_MAX_SHIFT    15  // Exponente máximo de la ventana de media móvil o del IIR
+
+// Etapa de filtrado aplicada a la salida del sobremuestreo
+typedef enum
+{
+    FILTER_NONE,        // Solo sobremuestreo y diezmado
+    FILTER_MOVING_AVG,  // Media móvil de 2^shift salidas con suma acumulada
+    FILTER_IIR          // Paso bajo de un polo: y += (x - y) / 2^shift
+} filter_mode_t;
+
+// Estado de un filtro incremental: cada muestra cuesta O(1) independientemente de N
+typedef struct
+{
+    uint32_t os_acc;        // Suma de las muestras del bloque de sobremuestreo en curso
+    uint16_t os_count;      // Muestras acumuladas en el bloque en curso
+    uint16_t os_len;        // Muestras por bloque: 4^os_bits
+    uint8_t os_bits;        // Bits extra de resolución por sobremuestreo
+    uint8_t shift;          // log2 de la ventana (media móvil) o constante del IIR
+    filter_mode_t mode;     // Etapa posterior al diezmado
+    uint16_t *window;       // Media móvil: últimas 2^shift salidas diezmadas
+    uint16_t index;         // Media móvil: posición de la salida más antigua
+    uint32_t acc;           // Suma de la ventana o estado del IIR (y * 2^shift)
+    volatile uint16_t out;  // Última salida, en cuentas de 12 + os_bits bits
+    volatile uint8_t ready; // 1 cuando out contiene una salida válida
+} filter_t;
+
+uint8_t filter_init(filter_t *f, uint8_t os_bits, filter_mode_t mode, uint8_t shift, uint16_t *window);
+void filter_reset(filter_t *f);
+uint8_t filter_push(filter_t *f, uint16_t sample);
+uint16_t filter_output(const filter_t *f);
+uint8_t filter_ready(const filter_t *f);
+
+#endif // FILTER_H_
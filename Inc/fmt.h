@@ -0,0 +1,15 @@
+#ifndef FMT_H_
+#define FMT_H_
+
+#include <stdint.h>
+
+#define FMT_U32_MAX_LEN     10  // Dígitos de 4294967295
+#define FMT_I32_MAX_LEN     11  // Signo + dígitos de -2147483648
+
+uint8_t fmt_u32(char *buf, uint32_t value);
+uint8_t fmt_i32(char *buf, int32_t value);
+uint8_t fmt_hex(char *buf, uint32_t value, uint8_t digits);
+uint8_t fmt_fixed(char *buf, int32_t value, uint8_t decimals);
+uint16_t fmt_format(char *buf, uint16_t size, const char *fmt, ...);
+
+#endif // FMT_H_
@@ -0,0 +1,11 @@
+#ifndef GAMMA_H_
+#define GAMMA_H_
+
+#include <stdint.h>
+
+#define GAMMA_LEVELS        100 // Niveles de brillo percibido (0-99), generados por tools/gen_gamma.py
+
+// Ciclo de trabajo de 16 bits de cada nivel de brillo (Src/gamma.c, en Flash)
+extern const uint16_t gamma_table[GAMMA_LEVELS];
+
+#endif // GAMMA_H_
@@ -0,0 +1,24 @@
+#ifndef LED_SEQ_H_
+#define LED_SEQ_H_
+
+#include <stdint.h>
+
+#define LED_SEQ_MAX_STEPS   128     // Valores de brillo que caben en una secuencia
+#define LED_SEQ_MAX_PERIOD  60000   // Periodo máximo entre pasos en ms
+
+// Estado de la secuencia
+typedef enum
+{
+    LED_SEQ_LOADING,    // Recibiendo valores con led_seq_append()
+    LED_SEQ_PLAYING,    // Reproduciendo desde la rueda de temporizadores
+    LED_SEQ_DONE        // Reproducción terminada o detenida
+} led_seq_state_t;
+
+void led_seq_init(void);
+uint8_t led_seq_append(const uint32_t *duty, uint8_t count);
+uint8_t led_seq_start(uint32_t period_ms, uint8_t repeat);
+void led_seq_stop(void);
+uint8_t led_seq_length(void);
+led_seq_state_t led_seq_state(void);
+
+#endif // LED_SEQ_H_
@@ -0,0 +1,31 @@
+#ifndef MEMMAP_H_
+#define MEMMAP_H_
+
+#include <stdint.h>
+
+#define MEMMAP_STACK_PAINT      0xC5C5C5C5UL    // Patrón con el que Reset_Handler pinta la pila reservada
+#define MEMMAP_GUARD_WORDS      4               // Palabras del fondo de la pila comprobadas por el canario
+
+uint32_t memmap_stack_size(void);
+uint32_t memmap_stack_high_water(void);
+uint8_t memmap_stack_guard_ok(void);
+void memmap_dump(void);
+
+// Bytes del heap de newlib entregados por _sbrk (sysmem.c)
+uint32_t sysmem_heap_used(void);
+
+#ifdef STACK_GUARD
+
+void memmap_stack_guard_check(void);
+void stack_overflow_hook(void);
+
+// Comprobación del canario desde SysTick_Handler
+#define STACK_GUARD_CHECK()     memmap_stack_guard_check()
+
+#else
+
+#define STACK_GUARD_CHECK()     ((void)0)
+
+#endif // STACK_GUARD
+
+#endif // MEMMAP_H_
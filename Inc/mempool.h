@@ -0,0 +1,40 @@
+#ifndef MEMPOOL_H_
+#define MEMPOOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Clases de bloques: tamaño en bytes (potencia de 2, al menos 4) y número de bloques de cada una.
+// La memoria de todas las clases se reserva en la sección .mempool (ver el script del enlazador)
+#define MEMPOOL_SMALL_SIZE      16
+#define MEMPOOL_SMALL_COUNT     16
+#define MEMPOOL_MEDIUM_SIZE     64
+#define MEMPOOL_MEDIUM_COUNT    8
+#define MEMPOOL_LARGE_SIZE      256
+#define MEMPOOL_LARGE_COUNT     2
+
+// Clases de bloques, de menor a mayor tamaño
+typedef enum
+{
+    MEMPOOL_SMALL,
+    MEMPOOL_MEDIUM,
+    MEMPOOL_LARGE,
+    MEMPOOL_CLASS_COUNT
+} mempool_class_t;
+
+// Estadísticas de una clase
+typedef struct
+{
+    uint16_t block_size;    // Tamaño de cada bloque en bytes
+    uint16_t blocks;        // Bloques de la clase
+    uint16_t used;          // Bloques reservados ahora
+    uint16_t high_water;    // Mayor número de bloques reservados a la vez
+    uint32_t failures;      // Peticiones sin bloque libre en esta clase ni en las mayores
+} mempool_stats_t;
+
+void mempool_init(void);
+void *mempool_alloc(size_t size);
+void mempool_free(void *block);
+uint8_t mempool_stats(mempool_class_t cls, mempool_stats_t *stats);
+
+#endif // MEMPOOL_H_
@@ -4,6 +4,11 @@
  * @details Contiene las definiciones de direcciones de memoria, registros y valores de bits
  *          para el acceso directo a los periféricos del microcontrolador STM32F070RB.
  *          Incluye definiciones para SysTick, RCC, ADC, GPIO, USART y Timer.
+ *          Cada periférico es un puntero a su estructura de regs.h (RCC, GPIOA,
+ *          USART2...); los nombres de registro planos (RCC_CR, USART_CR1...) se
+ *          mantienen como alias de los miembros de esas estructuras.
+ *          Con HOST_SIM las instancias apuntan al modelo de periféricos de sim/ para
+ *          compilar los drivers en el host.
  *          Las direcciones y bits están basados en la documentación de referencia:
  *          "STM32F070x6/xB Reference Manual (RM0360)", "User Manual (UM1724)" y
  *          "STM32F0 series Cortex-M0 programming manual (PM0215)"
@@ -13,75 +18,298 @@
 #define NUCLEO_CONF_H_
 
 #include <stdint.h>
+#include "regs.h"
+
+// Instancias de los periféricos (estructuras de regs.h en su dirección base)
+#define SYSTICK_BASE        0xE000E010 // Dirección base del temporizador SysTick
+#define RCC_BASE            0x40021000 // Dirección base del periférico RCC
+#define FLASH_BASE          0x40022000 // Dirección base de la interfaz Flash
+#define ADC_BASE            0x40012400 // Dirección base del periférico ADC
+#define GPIOA_BASE          0x48000000 // Dirección base del periférico GPIOA
+#define GPIOB_BASE          0x48000400 // Dirección base del periférico GPIOB
+#define GPIOC_BASE          0x48000800 // Dirección base del periférico GPIOC
+#define USART2_BASE         0x40004400 // Dirección base del periférico USART2
+#define DMA1_BASE           0x40020000 // Dirección base del controlador DMA1
+#define TIM1_BASE           0x40012C00 // Dirección base del periférico Timer 1 (avanzado)
+#define TIM2_BASE           0x40000000 // Dirección base del periférico Timer 2
+#define TIM3_BASE           0x40000400 // Dirección base del periférico Timer 3
+
+#ifdef HOST_SIM
+// Compilación para el host: los periféricos son variables del modelo de sim/sim.c
+#include "sim.h"
+
+#define SYSTICK             (&sim_hw.systick)
+#define RCC                 (&sim_hw.rcc)
+#define FLASH               (&sim_hw.flash)
+#define ADC1                (&sim_hw.adc)
+#define ADC_COMMON          (&sim_hw.adc_common)
+#define GPIOA               (&sim_hw.gpioa)
+#define GPIOB               (&sim_hw.gpiob)
+#define GPIOC               (&sim_hw.gpioc)
+#define USART2              (&sim_hw.usart2)
+#define DMA1                (&sim_hw.dma1)
+#define TIM1                (&sim_hw.tim1)
+#define TIM2                (&sim_hw.tim2)
+#define TIM3                (&sim_hw.tim3)
+#else
+#define SYSTICK             ((systick_regs_t *) SYSTICK_BASE)
+#define RCC                 ((rcc_regs_t *) RCC_BASE)
+#define FLASH               ((flash_regs_t *) FLASH_BASE)
+#define ADC1                ((adc_regs_t *) ADC_BASE)
+#define ADC_COMMON          ((adc_common_regs_t *) (ADC_BASE + 0x308))
+#define GPIOA               ((gpio_regs_t *) GPIOA_BASE)
+#define GPIOB               ((gpio_regs_t *) GPIOB_BASE)
+#define GPIOC               ((gpio_regs_t *) GPIOC_BASE)
+#define USART2              ((usart_regs_t *) USART2_BASE)
+#define DMA1                ((dma_regs_t *) DMA1_BASE)
+#define TIM1                ((tim_regs_t *) TIM1_BASE)
+#define TIM2                ((tim_regs_t *) TIM2_BASE)
+#define TIM3                ((tim_regs_t *) TIM3_BASE)
+#endif // HOST_SIM
+
+// Espera activa a que el hardware o una ISR cambien cond. En HOST_SIM cada comprobación
+// deja avanzar antes el modelo de periféricos (tiempo virtual e ISR); en la placa
+// equivale a while (cond);
+#ifdef HOST_SIM
+#define HW_POLL()           sim_poll()
+#else
+#define HW_POLL()           ((void)0)
+#endif
+#define HW_WAIT_WHILE(cond) do { HW_POLL(); } while (cond)
 
 // Registros del SysTick - Temporizador interno de 24 bits
-#define SYST_CSR 			(*(volatile uint32_t *)0xE000E010) // Control and Status Register - Controla la habilitación, interrupciones y fuente de reloj
-#define SYST_RVR			(*(volatile uint32_t *)0xE000E014) // Reload Value Register - Valor de recarga para el contador (define el periodo)
-#define SYST_CVR			(*(volatile uint32_t *)0xE000E018) // Current Value Register - Valor actual del contador (lectura/escritura lo resetea a 0)
+#define SYST_CSR            (SYSTICK->CSR)  // Control and Status Register - Controla la habilitación, interrupciones y fuente de reloj
+#define SYST_RVR            (SYSTICK->RVR)  // Reload Value Register - Valor de recarga para el contador (define el periodo)
+#define SYST_CVR            (SYSTICK->CVR)  // Current Value Register - Valor actual del contador (lectura/escritura lo resetea a 0)
+
+// Registros del System Control Block
+#ifdef HOST_SIM
+#define SCB_ICSR            (sim_hw.scb_icsr)
+#define SCB_SCR             (sim_hw.scb_scr)
+#else
+#define SCB_ICSR            (*(volatile uint32_t *)0xE000ED04) // Interrupt Control and State Register - Excepciones pendientes (SysTick, PendSV)
+#define SCB_SCR             (*(volatile uint32_t *)0xE000ED10) // System Control Register - Selección de Sleep o Deep-sleep (Stop) con WFI
+#endif
 
 // Registros del RCC - Controla todos los relojes del sistema
-#define RCC_BASE 			0x40021000 // Dirección base del periférico RCC										
-#define RCC_CR				*(volatile uint32_t*) (RCC_BASE + 0x00) // Clock Control Register - Configura y habilita los osciladores
-#define RCC_CFGR			*(volatile uint32_t*) (RCC_BASE + 0x04) // Clock Configuration Register - Configura los divisores y multiplexores de reloj
-#define RCC_AHBENR			*(volatile uint32_t*) (RCC_BASE + 0x14) // AHB Peripheral Clock Enable Register - Habilita relojes de periféricos en bus AHB
-#define RCC_APB2ENR			*(volatile uint32_t*) (RCC_BASE + 0x18) // APB2 Peripheral Clock Enable Register - Habilita relojes de periféricos en bus APB2
-#define RCC_APB1ENR			*(volatile uint32_t*) (RCC_BASE + 0x1C) // APB1 Peripheral Clock Enable Register - Habilita relojes de periféricos en bus APB1
+#define RCC_CR              (RCC->CR)       // Clock Control Register - Configura y habilita los osciladores
+#define RCC_CFGR            (RCC->CFGR)     // Clock Configuration Register - Configura los divisores y multiplexores de reloj
+#define RCC_AHBENR          (RCC->AHBENR)   // AHB Peripheral Clock Enable Register - Habilita relojes de periféricos en bus AHB
+#define RCC_APB2ENR         (RCC->APB2ENR)  // APB2 Peripheral Clock Enable Register - Habilita relojes de periféricos en bus APB2
+#define RCC_APB1ENR         (RCC->APB1ENR)  // APB1 Peripheral Clock Enable Register - Habilita relojes de periféricos en bus APB1
+#define RCC_CFGR2           (RCC->CFGR2)    // Clock Configuration Register 2 - Predivisor PREDIV de la entrada del PLL
+
+// Registros FLASH - Interfaz de la memoria Flash
+#define FLASH_ACR           (FLASH->ACR)    // Access Control Register - Estados de espera y prefetch
 
 // Registros ADC - Conversión de señales analógicas a digitales
-#define ADC_BASE			0x40012400 // Dirección base del periférico ADC
-#define ADC_CHSELR			*(volatile uint32_t*) (ADC_BASE + 0x28) // Channel Selection Register - Selecciona los canales para conversión
-#define ADC_SMPR			*(volatile uint32_t*) (ADC_BASE + 0x14) // Sampling Time Register - Configura tiempo de muestreo para los canales
-#define ADC_CCR				*(volatile uint32_t*) (ADC_BASE + 0x308) // Common Configuration Register - Configuración común para todos los ADCs
-#define ADC_CR				*(volatile uint32_t*) (ADC_BASE + 0x08) // Control Register - Control principal del ADC (encendido, inicio conversión)
-#define ADC_CFGR1			*(volatile uint32_t*) (ADC_BASE + 0x0C) // Configuration Register 1 - Configura modo de conversión y resolución
-#define ADC_DR				*(volatile uint32_t*) (ADC_BASE + 0x40) // Data Register - Contiene el resultado de la última conversión
-
-// Registros GPIOA - Control de pines de entrada/salida del puerto A (LED, USART2)
-#define GPIOA_BASE			0x48000000 // Dirección base del periférico GPIOA
-#define GPIOA_MODER			*(volatile uint32_t*) (GPIOA_BASE + 0x00) // Mode Register - Configura modo de operación (entrada, salida, función alterna, analógico)
-#define GPIOA_AFRL			*(volatile uint32_t*) (GPIOA_BASE + 0x20) // Alternate Function Low Register - Selecciona función alterna para pines 0-7
+#define ADC_ISR             (ADC1->ISR)     // Interrupt and Status Register - Flags de fin de conversión, overrun...
+#define ADC_IER             (ADC1->IER)     // Interrupt Enable Register - Habilita las interrupciones del ADC
+#define ADC_TR              (ADC1->TR)      // Watchdog Threshold Register - Umbrales alto y bajo del watchdog analógico
+#define ADC_CHSELR          (ADC1->CHSELR)  // Channel Selection Register - Selecciona los canales para conversión
+#define ADC_SMPR            (ADC1->SMPR)    // Sampling Time Register - Configura tiempo de muestreo para los canales
+#define ADC_CCR             (ADC_COMMON->CCR) // Common Configuration Register - Configuración común para todos los ADCs
+#define ADC_CR              (ADC1->CR)      // Control Register - Control principal del ADC (encendido, inicio conversión)
+#define ADC_CFGR1           (ADC1->CFGR1)   // Configuration Register 1 - Configura modo de conversión y resolución
+#define ADC_DR              (ADC1->DR)      // Data Register - Contiene el resultado de la última conversión
+
+// Registros GPIO - Control de pines de entrada/salida (LED y USART2 en el puerto A, entradas analógicas en A, B y C)
+#define GPIOA_MODER         (GPIOA->MODER)  // Mode Register - Configura modo de operación (entrada, salida, función alterna, analógico)
+#define GPIOA_AFRL          (GPIOA->AFR[0]) // Alternate Function Low Register - Selecciona función alterna para pines 0-7
+#define GPIOB_MODER         (GPIOB->MODER)  // Mode Register - Configura modo de operación de los pines del puerto B
+#define GPIOC_MODER         (GPIOC->MODER)  // Mode Register - Configura modo de operación de los pines del puerto C
 
 // Registros USART2 (RX PA2, TX PA3) - Comunicación serie asíncrona
-#define USART2_BASE			0x40004400 // Dirección base del periférico USART2
-#define USART_CR1			*(volatile uint32_t*) (USART2_BASE + 0x00) // Control Register 1 - Habilita USART, configura bits de datos, paridad
-#define USART_CR2 			*(volatile uint32_t*) (USART2_BASE + 0x04) // Control Register 2 - Configura bits de parada y otras opciones
-#define USART_BRR			*(volatile uint32_t*) (USART2_BASE + 0x0C) // Baud Rate Register - Define la velocidad de comunicación
-#define USART_ISR			*(volatile uint32_t*) (USART2_BASE + 0x1C) // Interrupt and Status Register - Indica estado (TX completo, RX disponible)
-#define USART_RDR           *(volatile uint32_t*) (USART2_BASE + 0x24) // Receive Data Register - Contiene el byte recibido
-#define USART_TDR			*(volatile uint32_t*) (USART2_BASE + 0x28) // Transmit Data Register - Registro para enviar datos
+#define USART_CR1           (USART2->CR1)   // Control Register 1 - Habilita USART, configura bits de datos, paridad
+#define USART_CR2           (USART2->CR2)   // Control Register 2 - Configura bits de parada y otras opciones
+#define USART_CR3           (USART2->CR3)   // Control Register 3 - Habilita peticiones DMA e interrupción de error
+#define USART_BRR           (USART2->BRR)   // Baud Rate Register - Define la velocidad de comunicación
+#define USART_ISR           (USART2->ISR)   // Interrupt and Status Register - Indica estado (TX completo, RX disponible)
+#define USART_ICR           (USART2->ICR)   // Interrupt Flag Clear Register - Limpia los flags de estado del ISR
+#define USART_RDR           (USART2->RDR)   // Receive Data Register - Contiene el byte recibido
+#define USART_TDR           (USART2->TDR)   // Transmit Data Register - Registro para enviar datos
+
+// Registros DMA1 (canal 1 = ADC, canal 2 = TIM2_UP, canal 4 = USART2_TX, canal 5 = USART2_RX) - Transferencias sin intervención de la CPU
+#define DMA1_ISR            (DMA1->ISR)     // Interrupt Status Register - Flags GIF/TCIF/HTIF/TEIF de cada canal
+#define DMA1_IFCR           (DMA1->IFCR)    // Interrupt Flag Clear Register - Limpia los flags de cada canal
+#define DMA1_CCR(ch)        (DMA1->CH[(ch) - 1].CCR)   // Channel Configuration Register - Dirección, tamaños, modo circular
+#define DMA1_CNDTR(ch)      (DMA1->CH[(ch) - 1].CNDTR) // Number of Data Register - Datos restantes de la transferencia
+#define DMA1_CPAR(ch)       (DMA1->CH[(ch) - 1].CPAR)  // Peripheral Address Register - Dirección del registro del periférico
+#define DMA1_CMAR(ch)       (DMA1->CH[(ch) - 1].CMAR)  // Memory Address Register - Dirección del buffer en memoria
 
 // Registros TIM2 (Timer 2) - Temporizador de propósito general
-#define TIM2_BASE           0x40000000 // Dirección base del periférico Timer 2
-#define TIM2_CR1            *(volatile uint32_t*) (TIM2_BASE + 0x00) // Control Register 1 - Configuración básica del timer (habilitación, modo, etc.)
-#define TIM2_CCMR1          *(volatile uint32_t*) (TIM2_BASE + 0x18) // Capture/Compare Mode Register 1 - Configura el modo de canales 1 y 2
-#define TIM2_CCER           *(volatile uint32_t*) (TIM2_BASE + 0x20) // Capture/Compare Enable Register - Habilita salidas y polaridad
-#define TIM2_PSC            *(volatile uint32_t*) (TIM2_BASE + 0x28) // Prescaler Register - Divide el reloj de entrada al timer
-#define TIM2_ARR            *(volatile uint32_t*) (TIM2_BASE + 0x2C) // Auto-Reload Register - Determina el periodo del timer
-#define TIM2_CCR1           *(volatile uint32_t*) (TIM2_BASE + 0x34) // Capture/Compare Register 1 - Contiene valor de comparación para el canal 1
+#define TIM2_CR1            (TIM2->CR1)     // Control Register 1 - Configuración básica del timer (habilitación, modo, etc.)
+#define TIM2_DIER           (TIM2->DIER)    // DMA/Interrupt Enable Register - Peticiones DMA por evento de actualización
+#define TIM2_EGR            (TIM2->EGR)     // Event Generation Register - Fuerza un evento de actualización
+#define TIM2_CCMR1          (TIM2->CCMR[0]) // Capture/Compare Mode Register 1 - Configura el modo de canales 1 y 2
+#define TIM2_CCER           (TIM2->CCER)    // Capture/Compare Enable Register - Habilita salidas y polaridad
+#define TIM2_PSC            (TIM2->PSC)     // Prescaler Register - Divide el reloj de entrada al timer
+#define TIM2_ARR            (TIM2->ARR)     // Auto-Reload Register - Determina el periodo del timer
+#define TIM2_CCR1           (TIM2->CCR[0])  // Capture/Compare Register 1 - Contiene valor de comparación para el canal 1
+
+// Registros TIM3 (Timer 3) - Base de tiempos para disparar las conversiones del ADC (TRGO)
+#define TIM3_CR1            (TIM3->CR1)     // Control Register 1 - Habilitación del contador
+#define TIM3_CR2            (TIM3->CR2)     // Control Register 2 - Selección de la salida de disparo TRGO
+#define TIM3_EGR            (TIM3->EGR)     // Event Generation Register - Fuerza un evento de actualización
+#define TIM3_PSC            (TIM3->PSC)     // Prescaler Register - Divide el reloj de entrada al timer
+#define TIM3_ARR            (TIM3->ARR)     // Auto-Reload Register - Determina el periodo del timer
+
+// Registros NVIC - Controlador de interrupciones del Cortex-M0
+#ifdef HOST_SIM
+#define NVIC_ISER           (sim_hw.nvic_iser)
+#define NVIC_ICER           (sim_hw.nvic_icer)
+#else
+#define NVIC_ISER           (*(volatile uint32_t *)0xE000E100) // Interrupt Set-Enable Register - Habilita interrupciones externas (1 bit por IRQ)
+#define NVIC_ICER           (*(volatile uint32_t *)0xE000E180) // Interrupt Clear-Enable Register - Deshabilita interrupciones externas
+#endif
+
+// Números de interrupción (posición en la tabla de vectores tras las excepciones del núcleo)
+#define DMA1_CH1_IRQn       9               // DMA1 channel 1 interrupt (ADC)
+#define DMA1_CH2_3_IRQn     10              // DMA1 channel 2 and 3 interrupt (TIM2_UP)
+#define DMA1_CH4_5_IRQn     11              // DMA1 channel 4 and 5 interrupt
+#define ADC_IRQn            12              // ADC interrupt (watchdog analógico)
+#define USART2_IRQn         28              // USART2 global interrupt
 
 // Bits de control para registro SysTick CSR
 #define SYST_CSR_ENABLE     (0x1U << 0)     // Bit 0: Habilita el contador SysTick (1=activado, 0=desactivado)
 #define SYST_CSR_TICKINT    (0x1U << 1)     // Bit 1: Habilita la interrupción SysTick cuando el contador llega a 0
 #define SYST_CSR_CLKSOURCE  (0x1U << 2)     // Bit 2: Selecciona la fuente de reloj (1=reloj del procesador, 0=reloj externo)
+#define SYST_CSR_COUNTFLAG  (0x1U << 16)    // Bit 16: El contador ha llegado a 0 desde la última lectura de CSR
+
+// Bits del System Control Block
+#define SCB_ICSR_PENDSTSET  (0x1U << 26)    // Bit 26: Excepción SysTick pendiente
+#define SCB_SCR_SLEEPDEEP   (0x1U << 2)     // Bit 2: WFI entra en Deep-sleep (Stop) en lugar de Sleep
 
 // Bits de control para registros RCC
 #define RCC_CR_HSION		(0x1U << 0)     // Bit 0: Habilita el oscilador interno de alta velocidad (HSI)
 #define RCC_CR_HSIRDY		(0x1U << 1)     // Bit 1: Flag que indica si el HSI está estable y listo (1=listo)
+#define RCC_CR_HSEON        (0x1U << 16)    // Bit 16: Habilita el oscilador externo (HSE)
+#define RCC_CR_HSERDY       (0x1U << 17)    // Bit 17: Flag que indica que el HSE está estable (1=listo)
+#define RCC_CR_HSEBYP       (0x1U << 18)    // Bit 18: HSE en bypass, reloj externo en OSC_IN (MCO del ST-LINK)
+#define RCC_CR_PLLON        (0x1U << 24)    // Bit 24: Habilita el PLL
+#define RCC_CR_PLLRDY       (0x1U << 25)    // Bit 25: Flag que indica que el PLL está enganchado (1=listo)
 #define RCC_CFGR_SW			(0x3U << 0)     // Bits 0-1: Mascara de selección de la fuente de reloj del sistema
 #define RCC_CFGR_SW_HSI		(0x0U << 0)     // 00: Selecciona HSI como fuente de reloj del sistema
 #define RCC_CFGR_SWS        (0x3U << 2)    // Bits 2-3: Máscara de estado de la fuente de reloj del sistema
 #define RCC_CFGR_SWS_HSI    (0x0U << 2)    // 00: HSI está siendo usado como reloj del sistema
+#define RCC_CFGR_SW_PLL     (0x2U << 0)     // 10: Selecciona el PLL como reloj del sistema
+#define RCC_CFGR_SWS_PLL    (0x2U << 2)     // 10: El PLL está siendo usado como reloj del sistema
+#define RCC_CFGR_HPRE       (0xFU << 4)     // Bits 4-7: Preescalador AHB (0 = sin división)
+#define RCC_CFGR_PPRE       (0x7U << 8)     // Bits 8-10: Preescalador APB (0 = sin división)
+#define RCC_CFGR_PLLSRC     (0x1U << 16)    // Bit 16: Fuente del PLL (0=HSI/2, 1=HSE/PREDIV)
+#define RCC_CFGR_PLLMUL     (0xFU << 18)    // Bits 18-21: Mascara del multiplicador del PLL
+#define RCC_CFGR_PLLMUL6    (0x4U << 18)    // 0100: PLL x6 (HSE = 8MHz -> 48MHz)
+#define RCC_CFGR_PLLMUL12   (0xAU << 18)    // 1010: PLL x12 (HSI/2 = 4MHz -> 48MHz)
+#define RCC_CFGR2_PREDIV    (0xFU << 0)     // Bits 0-3: Predivisor de HSE (0 = sin división)
+#define RCC_AHBENR_DMAEN    (0x1U << 0)     // Bit 0: Habilita el reloj del DMA1
+#define RCC_AHBENR_GPIOAEN  (0x1U << 17)    // Bit 17: Habilita el reloj de GPIOA
+#define RCC_AHBENR_GPIOBEN  (0x1U << 18)    // Bit 18: Habilita el reloj de GPIOB
+#define RCC_AHBENR_GPIOCEN  (0x1U << 19)    // Bit 19: Habilita el reloj de GPIOC
+#define RCC_APB1ENR_TIM2EN  (0x1U << 0)     // Bit 0: Habilita el reloj de TIM2
+#define RCC_APB1ENR_TIM3EN  (0x1U << 1)     // Bit 1: Habilita el reloj de TIM3
+#define RCC_APB1ENR_USART2EN (0x1U << 17)   // Bit 17: Habilita el reloj de USART2
+#define RCC_APB2ENR_ADCEN   (0x1U << 9)     // Bit 9: Habilita el reloj del ADC
+#define RCC_APB2ENR_TIM1EN  (0x1U << 11)    // Bit 11: Habilita el reloj de TIM1
+
+// Campos de los registros GPIO (máscara y valor de cada pin, válidos también con pin variable)
+#define GPIO_MODER_MODE(pin) (0x3UL << (2 * (pin)))      // Modo del pin (2 bits por pin)
+#define GPIO_MODER_VAL(pin, mode) ((uint32_t)(mode) << (2 * (pin)))
+#define GPIO_AFR_AF(pin)    (0xFUL << (4 * ((pin) & 7))) // Función alternativa del pin en AFR[pin >> 3] (4 bits por pin)
+#define GPIO_AFR_VAL(pin, af) ((uint32_t)(af) << (4 * ((pin) & 7)))
+#define GPIO_MODE_INPUT     0x0U            // 00: Entrada
+#define GPIO_MODE_OUTPUT    0x1U            // 01: Salida de propósito general
+#define GPIO_MODE_AF        0x2U            // 10: Función alternativa
+#define GPIO_MODE_ANALOG    0x3U            // 11: Analógico (entradas del ADC)
+
+// Bits de control para registro FLASH ACR
+#define FLASH_ACR_LATENCY   (0x1U << 0)     // Bit 0: Un estado de espera (obligatorio con SYSCLK > 24MHz)
+#define FLASH_ACR_PRFTBE    (0x1U << 4)     // Bit 4: Habilita el buffer de prefetch
 
 // Bits de control para registros ADC
 #define ADC_CR_ADEN			(0x1U << 0)     // Bit 0: Habilita el ADC (1=activado)
 #define ADC_CR_ADDIS		(0x1U << 1)     // Bit 1: Deshabilita el ADC (1=deshabilitar)
 #define ADC_CR_ADSTART		(0x1U << 2)     // Bit 2: Inicia la conversión ADC (1=iniciar)
+#define ADC_CR_ADSTP        (0x1U << 4)     // Bit 4: Detiene la conversión en curso (1=detener)
 #define ADC_CR_ADCAL		(0x1U << 31)    // Bit 31: Inicia la calibración del ADC (1=calibrar)
+#define ADC_CCR_VREFEN      (0x1U << 22)    // Bit 22: Habilita la referencia interna VREFINT (canal 17)
+#define ADC_CCR_TSEN        (0x1U << 23)    // Bit 23: Habilita el sensor de temperatura (canal 16)
+#define ADC_CFGR1_DMAEN     (0x1U << 0)     // Bit 0: Peticiones DMA en cada fin de conversión
+#define ADC_CFGR1_DMACFG    (0x1U << 1)     // Bit 1: DMA en modo circular (peticiones continuas)
+#define ADC_CFGR1_EXTSEL    (0x7U << 6)     // Bits 6-8: Mascara de selección del disparo externo
+#define ADC_CFGR1_EXTSEL_TIM3 (0x3U << 6)   // 011: Disparo por TIM3_TRGO
+#define ADC_CFGR1_EXTEN     (0x3U << 10)    // Bits 10-11: Mascara de flanco del disparo externo (00=software)
+#define ADC_CFGR1_EXTEN_RISING (0x1U << 10) // 01: Disparo en flanco de subida
+#define ADC_CFGR1_OVRMOD    (0x1U << 12)    // Bit 12: Sobrescribir ADC_DR si no se ha leído
+#define ADC_CFGR1_CONT      (0x1U << 13)    // Bit 13: Modo de conversión continua
+#define ADC_CFGR1_AWDSGL    (0x1U << 22)    // Bit 22: El watchdog analógico vigila un único canal (AWDCH)
+#define ADC_CFGR1_AWDEN     (0x1U << 23)    // Bit 23: Habilita el watchdog analógico
+#define ADC_CFGR1_AWDCH     (0x1FU << 26)   // Bits 26-30: Canal vigilado por el watchdog analógico
+#define ADC_ISR_AWD         (0x1U << 7)     // Bit 7: Conversión fuera de la ventana del watchdog (se borra escribiendo 1)
+#define ADC_IER_AWDIE       (0x1U << 7)     // Bit 7: Interrupción del watchdog analógico
+#define ADC_TR_LT           (0xFFFU << 0)   // Bits 0-11: Umbral bajo del watchdog analógico
+#define ADC_TR_HT           (0xFFFU << 16)  // Bits 16-27: Umbral alto del watchdog analógico
+
+// Bits de control para registros TIM
+#define TIM_CR1_CEN         (0x1U << 0)     // Bit 0: Habilita el contador
+#define TIM_CR1_UDIS        (0x1U << 1)     // Bit 1: Bloquea los eventos de actualización (los registros precargados no se transfieren)
+#define TIM_CR1_ARPE        (0x1U << 7)     // Bit 7: Precarga de ARR
+#define TIM_CCMR_OCM_PWM1   (0x6U << 4)     // OCxM = 110: PWM modo 1 (activo mientras CNT < CCRx), desplazar 8 bits para canales pares
+#define TIM_CCMR_OCPE       (0x1U << 3)     // Bit 3: Precarga de CCRx (el valor nuevo se aplica en la siguiente actualización)
+#define TIM_CCMR_OC(ch)     (0xFFUL << (((ch) & 1) ? 0 : 8)) // Byte de configuración del canal en CCMR[(ch - 1) >> 1] (impares abajo, pares arriba)
+#define TIM_CCER_CCE(ch)    (0x1UL << (4 * ((ch) - 1)))      // CCxE: Habilita la salida del canal
+#define TIM_BDTR_MOE        (0x1U << 15)    // Bit 15: Habilitación general de salidas (timers avanzados)
+#define TIM_CR2_MMS_UPDATE  (0x2U << 4)     // MMS = 010: El evento de actualización genera TRGO
+#define TIM_DIER_UDE        (0x1U << 8)     // Bit 8: Petición DMA en cada evento de actualización
+#define TIM_EGR_UG          (0x1U << 0)     // Bit 0: Genera un evento de actualización (carga PSC y ARR)
+
+// Bits de control para registros USART
+#define USART_CR1_UE        (0x1U << 0)     // Bit 0: Habilita el USART
+#define USART_CR1_OVER8     (0x1U << 15)    // Bit 15: Sobremuestreo por 8 (1) o por 16 (0)
+#define USART_CR1_IDLEIE    (0x1U << 4)     // Bit 4: Interrupción al detectar la línea RX inactiva
+#define USART_CR1_RE        (0x1U << 2)     // Bit 2: Habilita el receptor
+#define USART_CR1_TE        (0x1U << 3)     // Bit 3: Habilita el transmisor
+#define USART_CR1_RXNEIE    (0x1U << 5)     // Bit 5: Interrupción cuando RDR contiene un dato
+#define USART_CR1_TCIE      (0x1U << 6)     // Bit 6: Interrupción cuando la transmisión se ha completado
+#define USART_CR1_TXEIE     (0x1U << 7)     // Bit 7: Interrupción cuando TDR está vacío
+#define USART_CR1_PCE       (0x1U << 10)    // Bit 10: Habilita el control de paridad
+#define USART_CR1_M0        (0x1U << 12)    // Bit 12: Longitud de palabra, bit 0 (M1:M0 = 00 -> 8 bits)
+#define USART_CR1_M1        (0x1U << 28)    // Bit 28: Longitud de palabra, bit 1
+#define USART_CR2_STOP      (0x3U << 12)    // Bits 12-13: Bits de parada (00 = 1 bit)
+#define USART_CR3_EIE       (0x1U << 0)     // Bit 0: Interrupción por error (overrun) con recepción por DMA
+#define USART_CR3_DMAR      (0x1U << 6)     // Bit 6: Peticiones DMA en recepción
+#define USART_CR3_DMAT      (0x1U << 7)     // Bit 7: Peticiones DMA en transmisión
+#define USART_ISR_ORE       (0x1U << 3)     // Bit 3: Error de overrun, llegó un byte con RDR lleno
+#define USART_ISR_IDLE      (0x1U << 4)     // Bit 4: Línea RX inactiva tras recibir datos
+#define USART_ISR_RXNE      (0x1U << 5)     // Bit 5: Dato recibido disponible en RDR
+#define USART_ISR_TC        (0x1U << 6)     // Bit 6: Transmisión completada (TDR y registro de desplazamiento vacíos)
+#define USART_ISR_TXE       (0x1U << 7)     // Bit 7: TDR vacío, se puede escribir el siguiente dato
+#define USART_ICR_ORECF     (0x1U << 3)     // Bit 3: Limpia el flag ORE
+#define USART_ICR_IDLECF    (0x1U << 4)     // Bit 4: Limpia el flag IDLE
+#define USART_ICR_TCCF      (0x1U << 6)     // Bit 6: Limpia el flag TC
+
+// Bits de control para registros DMA
+#define DMA_CCR_EN          (0x1U << 0)     // Bit 0: Habilita el canal
+#define DMA_CCR_TCIE        (0x1U << 1)     // Bit 1: Interrupción de transferencia completa
+#define DMA_CCR_HTIE        (0x1U << 2)     // Bit 2: Interrupción de media transferencia
+#define DMA_CCR_DIR         (0x1U << 4)     // Bit 4: Dirección (1=memoria a periférico, 0=periférico a memoria)
+#define DMA_CCR_CIRC        (0x1U << 5)     // Bit 5: Modo circular
+#define DMA_CCR_MINC        (0x1U << 7)     // Bit 7: Incremento de la dirección de memoria
+#define DMA_CCR_PSIZE_16    (0x1U << 8)     // Bits 8-9 = 01: Accesos de 16 bits al periférico
+#define DMA_CCR_MSIZE_16    (0x1U << 10)    // Bits 10-11 = 01: Accesos de 16 bits a memoria
+#define DMA_CCR_PL_HIGH     (0x2U << 12)    // Bits 12-13 = 10: Prioridad alta frente a los demás canales
+#define DMA_ISR_TCIF(ch)    (0x2U << (4 * ((ch) - 1))) // Transferencia completa en el canal
+#define DMA_ISR_HTIF(ch)    (0x4U << (4 * ((ch) - 1))) // Media transferencia en el canal
+#define DMA_IFCR_CGIF(ch)   (0x1U << (4 * ((ch) - 1))) // Limpia todos los flags del canal
 
 // Calibracion sensor de temperatura interno - Para conversión de valores ADC a temperatura en grados Celsius
+#ifdef HOST_SIM
+#define TEMP30_CAL_ADDR     (&sim_hw.ts_cal30)
+#define VREFINT_CAL_ADDR    (&sim_hw.vrefint_cal)
+#else
 #define TEMP30_CAL_ADDR     ((uint16_t*) ((uint32_t) 0x1FFFF7B8))       // Dirección de memoria para valor de calibración a 30°C (programado en fábrica)
+#define VREFINT_CAL_ADDR    ((uint16_t*) ((uint32_t) 0x1FFFF7BA))       // Dirección de memoria para valor de VREFINT a 3.3V (programado en fábrica)
+#endif
 #define VDD_CALIB           ((uint32_t) (3300))                         // Voltaje de calibración en mV utilizado por el fabricante
-#define VDD_APPLI           ((uint32_t) (3300))                         // Voltaje real de funcionamiento en mV
 #define AVG_SLOPE           ((uint32_t) (5336))                         // Pendiente promedio en μV/°C para sensor de temperatura
 
 #endif // NUCLEO_CONF_H_
@@ -0,0 +1,55 @@
+#ifndef PROF_H_
+#define PROF_H_
+
+#include <stdint.h>
+
+#define PROF_HIST_BINS      16  // Intervalos del histograma logarítmico de latencias
+#define PROF_HIST_MIN_LOG2  4   // El intervalo 0 acumula las medidas de menos de 2^(4+1) ciclos
+
+// Regiones instrumentadas
+typedef enum
+{
+    PROF_GET_TEMPERATURE,   // get_temperature()
+    PROF_UART_SEND_STRING,  // uart_send_string()
+    PROF_CMD_DISPATCH,      // Tarea de comandos de main.c
+    PROF_ISR_SYSTICK,       // SysTick_Handler (incluye la rueda de temporizadores)
+    PROF_ISR_USART2,        // USART2_IRQHandler
+    PROF_ISR_DMA1_CH1,      // DMA1_CH1_IRQHandler (ADC)
+    PROF_ISR_DMA1_CH2_3,    // DMA1_CH2_3_IRQHandler (forma de onda PWM)
+    PROF_ISR_DMA1_CH4_5,    // DMA1_CH4_5_IRQHandler (UART)
+    PROF_ISR_ADC,           // ADC_IRQHandler (alarma de temperatura)
+    PROF_REGION_COUNT
+} prof_region_t;
+
+#ifdef PROFILE_ENABLE
+
+#include "system.h"
+
+// Estadísticas de una región en ciclos del reloj del sistema
+typedef struct
+{
+    uint32_t count;                 // Medidas acumuladas
+    uint32_t min;                   // Menor duración
+    uint32_t max;                   // Mayor duración
+    uint64_t sum;                   // Suma de duraciones (media = sum / count)
+    uint16_t hist[PROF_HIST_BINS];  // Intervalo k: [2^(k+4), 2^(k+5)) ciclos (el 0 desde 0), saturado a 65535
+} prof_stats_t;
+
+// Marca el inicio de la región r en el bloque actual
+#define PROF_START(r)   uint32_t prof_t0_##r = timestamp_cycles()
+// Cierra la región r abierta con PROF_START en el mismo bloque
+#define PROF_END(r)     prof_record((r), timestamp_cycles() - prof_t0_##r)
+
+void prof_record(prof_region_t r, uint32_t cycles);
+void prof_reset(void);
+void prof_dump(void);
+const prof_stats_t *prof_stats(prof_region_t r);
+
+#else
+
+#define PROF_START(r)   ((void)0)
+#define PROF_END(r)     ((void)0)
+
+#endif // PROFILE_ENABLE
+
+#endif // PROF_H_
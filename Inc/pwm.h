@@ -2,8 +2,42 @@
 #define PWM_H_
 
 #include <stdint.h>
+#include "regs.h"
+
+#define PWM_CHANNELS        4       // Canales de salida por timer
+#define PWM_MAX_STEPS       65536   // Resolución máxima (ARR de 16 bits)
+#define PWM_DUTY_MAX        0xFFFF  // Ciclo de trabajo de pwm_set_duty() con la salida siempre activa
+#define PWM_LED_FREQ        1000    // Frecuencia PWM del LED en Hz (sin parpadeo visible en cámara)
+#define PWM_LED_STEPS       0       // Pasos del ciclo de trabajo del LED (0 = máxima resolución para PWM_LED_FREQ)
+
+// Timers con salidas PWM
+typedef enum
+{
+    PWM_TIM1,           // Timer avanzado (APB2)
+    PWM_TIM2,           // LED de la placa en el canal 1 (PA5)
+    PWM_TIM3,           // Compartido con el motor de muestreo del ADC (adc_sampling_start())
+    PWM_TIMER_COUNT
+} pwm_timer_t;
+
+// Pin de salida de un canal
+typedef struct
+{
+    gpio_regs_t *port;  // GPIOA, GPIOB...
+    uint8_t pin;        // Número de pin (0-15)
+    uint8_t af;         // Función alternativa del canal en ese pin (AF0-AF7)
+} pwm_pin_t;
+
+uint32_t pwm_timer_init(pwm_timer_t tim, uint32_t freq_hz, uint32_t steps);
+uint8_t pwm_channel_init(pwm_timer_t tim, uint8_t channel, const pwm_pin_t *pin);
+void pwm_set_duty(pwm_timer_t tim, uint8_t channel, uint16_t duty);
+void pwm_set_duties(pwm_timer_t tim, const uint16_t *duty, uint8_t mask);
+void pwm_set_compare(pwm_timer_t tim, uint8_t channel, uint32_t counts);
+uint32_t pwm_get_steps(pwm_timer_t tim);
+uint32_t pwm_get_freq(pwm_timer_t tim);
 
 void pwm_led_init(void);
 void set_led_brightness(uint8_t brightness);
+void set_led_limit(uint8_t max);
+void pwm_led_refresh(void);
 
 #endif // PWM_H_
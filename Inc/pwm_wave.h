@@ -0,0 +1,26 @@
+#ifndef PWM_WAVE_H_
+#define PWM_WAVE_H_
+
+#include <stdint.h>
+
+#define PWM_WAVE_MAX_RATE   100000  // Frecuencia máxima de actualización en Hz (con system_core_clock / steps como límite)
+#define PWM_WAVE_STEPS      480     // Resolución de tabla recomendada: PWM_WAVE_MAX_RATE a 48MHz
+
+// Reproducción de una tabla
+typedef enum
+{
+    PWM_WAVE_ONESHOT,   // Una pasada; al terminar sigue la tabla en cola o el LED vuelve a set_led_brightness()
+    PWM_WAVE_CIRCULAR   // Se repite hasta pwm_wave_stop() o hasta que haya una tabla en cola
+} pwm_wave_mode_t;
+
+// Aviso de que una tabla ha terminado y vuelve a ser del usuario (desde la ISR del DMA)
+typedef void (*pwm_wave_done_cb_t)(const uint16_t *table);
+
+uint32_t pwm_wave_start(const uint16_t *table, uint16_t len, uint32_t rate_hz, uint32_t steps,
+                        pwm_wave_mode_t mode);
+uint8_t pwm_wave_queue(const uint16_t *table, uint16_t len, pwm_wave_mode_t mode);
+void pwm_wave_stop(void);
+uint8_t pwm_wave_active(void);
+void pwm_wave_set_callback(pwm_wave_done_cb_t cb);
+
+#endif // PWM_WAVE_H_
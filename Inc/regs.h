@@ -0,0 +1,181 @@
+/**
+ * @file regs.h
+ * @brief Estructuras de registros de los periféricos y acceso a campos
+ * @details Cada bloque de periféricos se describe con una estructura cuyos miembros
+ *          siguen el orden y los nombres del manual de referencia (RM0360/RM0091), de
+ *          modo que un puntero a la estructura en su dirección base da acceso tipado
+ *          a todos sus registros (nucleo_conf.h define las instancias RCC, GPIOA,
+ *          USART2...). Los desplazamientos se comprueban en compilación.
+ *          FIELD() y REG_MODIFY() permiten componer varios campos de un registro en
+ *          una única escritura: con máscaras y valores constantes el compilador reduce
+ *          la expresión a una sola constante, sin coste en ejecución.
+ */
+
+#ifndef REGS_H_
+#define REGS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Valor v colocado en el campo de máscara m (p.ej. FIELD(USART_CR2_STOP, 0)). La máscara debe
+// ser constante: el Cortex-M0 no tiene CLZ/RBIT y __builtin_ctz en ejecución llama a libgcc
+#define FIELD(m, v)             ((((uint32_t)(v)) << __builtin_ctz(m)) & (m))
+// Valor del campo de máscara constante m leído de r
+#define FIELD_GET(r, m)         (((r) & (m)) >> __builtin_ctz(m))
+// Limpia los bits clear y activa los bits set de r con una única lectura-modificación-escritura
+#define REG_MODIFY(r, clear, set) ((r) = ((r) & ~(uint32_t)(clear)) | (uint32_t)(set))
+
+// SysTick (núcleo Cortex-M0)
+typedef struct
+{
+    volatile uint32_t CSR;      // 0x00 Control and Status
+    volatile uint32_t RVR;      // 0x04 Reload Value
+    volatile uint32_t CVR;      // 0x08 Current Value
+    volatile uint32_t CALIB;    // 0x0C Calibration Value
+} systick_regs_t;
+
+// Reset and Clock Control
+typedef struct
+{
+    volatile uint32_t CR;       // 0x00 Clock Control
+    volatile uint32_t CFGR;     // 0x04 Clock Configuration
+    volatile uint32_t CIR;      // 0x08 Clock Interrupt
+    volatile uint32_t APB2RSTR; // 0x0C APB2 Peripheral Reset
+    volatile uint32_t APB1RSTR; // 0x10 APB1 Peripheral Reset
+    volatile uint32_t AHBENR;   // 0x14 AHB Peripheral Clock Enable
+    volatile uint32_t APB2ENR;  // 0x18 APB2 Peripheral Clock Enable
+    volatile uint32_t APB1ENR;  // 0x1C APB1 Peripheral Clock Enable
+    volatile uint32_t BDCR;     // 0x20 Backup Domain Control
+    volatile uint32_t CSR;      // 0x24 Control/Status
+    volatile uint32_t AHBRSTR;  // 0x28 AHB Peripheral Reset
+    volatile uint32_t CFGR2;    // 0x2C Clock Configuration 2 (PREDIV)
+    volatile uint32_t CFGR3;    // 0x30 Clock Configuration 3
+    volatile uint32_t CR2;      // 0x34 Clock Control 2 (HSI14)
+} rcc_regs_t;
+
+// Interfaz de la memoria Flash
+typedef struct
+{
+    volatile uint32_t ACR;      // 0x00 Access Control
+    volatile uint32_t KEYR;     // 0x04 Key
+    volatile uint32_t OPTKEYR;  // 0x08 Option Key
+    volatile uint32_t SR;       // 0x0C Status
+    volatile uint32_t CR;       // 0x10 Control
+    volatile uint32_t AR;       // 0x14 Address
+    volatile uint32_t RESERVED; // 0x18
+    volatile uint32_t OBR;      // 0x1C Option Byte
+    volatile uint32_t WRPR;     // 0x20 Write Protection
+} flash_regs_t;
+
+// Puerto GPIO
+typedef struct
+{
+    volatile uint32_t MODER;    // 0x00 Mode
+    volatile uint32_t OTYPER;   // 0x04 Output Type
+    volatile uint32_t OSPEEDR;  // 0x08 Output Speed
+    volatile uint32_t PUPDR;    // 0x0C Pull-up/Pull-down
+    volatile uint32_t IDR;      // 0x10 Input Data
+    volatile uint32_t ODR;      // 0x14 Output Data
+    volatile uint32_t BSRR;     // 0x18 Bit Set/Reset
+    volatile uint32_t LCKR;     // 0x1C Configuration Lock
+    volatile uint32_t AFR[2];   // 0x20 Alternate Function Low (pines 0-7) y High (pines 8-15)
+    volatile uint32_t BRR;      // 0x28 Bit Reset
+} gpio_regs_t;
+
+// ADC
+typedef struct
+{
+    volatile uint32_t ISR;      // 0x00 Interrupt and Status
+    volatile uint32_t IER;      // 0x04 Interrupt Enable
+    volatile uint32_t CR;       // 0x08 Control
+    volatile uint32_t CFGR1;    // 0x0C Configuration 1
+    volatile uint32_t CFGR2;    // 0x10 Configuration 2
+    volatile uint32_t SMPR;     // 0x14 Sampling Time
+    volatile uint32_t RESERVED1[2];
+    volatile uint32_t TR;       // 0x20 Watchdog Threshold
+    volatile uint32_t RESERVED2;
+    volatile uint32_t CHSELR;   // 0x28 Channel Selection
+    volatile uint32_t RESERVED3[5];
+    volatile uint32_t DR;       // 0x40 Data
+} adc_regs_t;
+
+// Registros comunes del ADC (ADC_BASE + 0x308)
+typedef struct
+{
+    volatile uint32_t CCR;      // 0x00 Common Configuration
+} adc_common_regs_t;
+
+// USART
+typedef struct
+{
+    volatile uint32_t CR1;      // 0x00 Control 1
+    volatile uint32_t CR2;      // 0x04 Control 2
+    volatile uint32_t CR3;      // 0x08 Control 3
+    volatile uint32_t BRR;      // 0x0C Baud Rate
+    volatile uint32_t GTPR;     // 0x10 Guard Time and Prescaler
+    volatile uint32_t RTOR;     // 0x14 Receiver Timeout
+    volatile uint32_t RQR;      // 0x18 Request
+    volatile uint32_t ISR;      // 0x1C Interrupt and Status
+    volatile uint32_t ICR;      // 0x20 Interrupt Flag Clear
+    volatile uint32_t RDR;      // 0x24 Receive Data
+    volatile uint32_t TDR;      // 0x28 Transmit Data
+} usart_regs_t;
+
+// Canal del DMA
+typedef struct
+{
+    volatile uint32_t CCR;      // 0x00 Channel Configuration
+    volatile uint32_t CNDTR;    // 0x04 Number of Data
+    volatile uint32_t CPAR;     // 0x08 Peripheral Address
+    volatile uint32_t CMAR;     // 0x0C Memory Address
+    volatile uint32_t RESERVED;
+} dma_channel_regs_t;
+
+// Controlador DMA (canales 1 a 7 en CH[0] a CH[6])
+typedef struct
+{
+    volatile uint32_t ISR;      // 0x00 Interrupt Status
+    volatile uint32_t IFCR;     // 0x04 Interrupt Flag Clear
+    dma_channel_regs_t CH[7];   // 0x08 Canales, 0x14 bytes cada uno
+} dma_regs_t;
+
+// Timer (TIM1, TIM2, TIM3: los registros que un timer no tiene están reservados)
+typedef struct
+{
+    volatile uint32_t CR1;      // 0x00 Control 1
+    volatile uint32_t CR2;      // 0x04 Control 2
+    volatile uint32_t SMCR;     // 0x08 Slave Mode Control
+    volatile uint32_t DIER;     // 0x0C DMA/Interrupt Enable
+    volatile uint32_t SR;       // 0x10 Status
+    volatile uint32_t EGR;      // 0x14 Event Generation
+    volatile uint32_t CCMR[2];  // 0x18 Capture/Compare Mode 1 (canales 1-2) y 2 (canales 3-4)
+    volatile uint32_t CCER;     // 0x20 Capture/Compare Enable
+    volatile uint32_t CNT;      // 0x24 Counter
+    volatile uint32_t PSC;      // 0x28 Prescaler
+    volatile uint32_t ARR;      // 0x2C Auto-Reload
+    volatile uint32_t RCR;      // 0x30 Repetition Counter (solo TIM1)
+    volatile uint32_t CCR[4];   // 0x34 Capture/Compare de los canales 1 a 4
+    volatile uint32_t BDTR;     // 0x44 Break and Dead-Time (solo TIM1)
+    volatile uint32_t DCR;      // 0x48 DMA Control
+    volatile uint32_t DMAR;     // 0x4C DMA Address for Full Transfer
+} tim_regs_t;
+
+// Comprobación de la disposición frente al manual de referencia
+_Static_assert(offsetof(systick_regs_t, CALIB) == 0x0C, "systick_regs_t");
+_Static_assert(offsetof(rcc_regs_t, AHBENR) == 0x14, "rcc_regs_t");
+_Static_assert(offsetof(rcc_regs_t, CFGR2) == 0x2C, "rcc_regs_t");
+_Static_assert(offsetof(rcc_regs_t, CR2) == 0x34, "rcc_regs_t");
+_Static_assert(offsetof(flash_regs_t, WRPR) == 0x20, "flash_regs_t");
+_Static_assert(offsetof(gpio_regs_t, AFR) == 0x20, "gpio_regs_t");
+_Static_assert(offsetof(gpio_regs_t, BRR) == 0x28, "gpio_regs_t");
+_Static_assert(offsetof(adc_regs_t, TR) == 0x20, "adc_regs_t");
+_Static_assert(offsetof(adc_regs_t, CHSELR) == 0x28, "adc_regs_t");
+_Static_assert(offsetof(adc_regs_t, DR) == 0x40, "adc_regs_t");
+_Static_assert(offsetof(usart_regs_t, TDR) == 0x28, "usart_regs_t");
+_Static_assert(sizeof(dma_channel_regs_t) == 0x14, "dma_channel_regs_t");
+_Static_assert(offsetof(dma_regs_t, CH) == 0x08, "dma_regs_t");
+_Static_assert(offsetof(tim_regs_t, CCER) == 0x20, "tim_regs_t");
+_Static_assert(offsetof(tim_regs_t, CCR) == 0x34, "tim_regs_t");
+_Static_assert(offsetof(tim_regs_t, DMAR) == 0x4C, "tim_regs_t");
+
+#endif // REGS_H_
@@ -0,0 +1,25 @@
+#ifndef RING_BUFFER_H_
+#define RING_BUFFER_H_
+
+#include <stdint.h>
+
+// Buffer circular de bytes para un productor y un consumidor (p.ej. aplicación e ISR).
+// El tamaño debe ser potencia de 2; head y tail avanzan libremente y se enmascaran al
+// acceder, así head - tail es siempre el número de bytes almacenados.
+typedef struct
+{
+    uint8_t *buf;           // Memoria de almacenamiento
+    uint16_t mask;          // Tamaño del buffer - 1
+    volatile uint16_t head; // Índice de escritura, solo lo modifica el productor
+    volatile uint16_t tail; // Índice de lectura, solo lo modifica el consumidor
+} ring_buffer_t;
+
+void ring_init(ring_buffer_t *rb, uint8_t *storage, uint16_t size);
+uint8_t ring_push(ring_buffer_t *rb, uint8_t data);
+uint8_t ring_pop(ring_buffer_t *rb, uint8_t *data);
+uint16_t ring_count(const ring_buffer_t *rb);
+uint16_t ring_space(const ring_buffer_t *rb);
+uint16_t ring_linear_count(const ring_buffer_t *rb, const uint8_t **data);
+void ring_skip(ring_buffer_t *rb, uint16_t len);
+
+#endif // RING_BUFFER_H_
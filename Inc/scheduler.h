@@ -0,0 +1,34 @@
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS     8   // Número máximo de tareas registradas
+#define SCHED_NO_TASK       (-1) // Identificador devuelto cuando no quedan huecos
+
+// Función de una tarea: se ejecuta hasta terminar, sin bloquear
+typedef void (*sched_task_fn_t)(void);
+
+// Estado y estadísticas de una tarea
+typedef struct
+{
+    sched_task_fn_t fn;     // Función de la tarea (0 = hueco libre)
+    uint32_t period;        // Periodo en ms (0 = tarea de un disparo)
+    uint32_t deadline;      // Plazo en ms desde la activación para terminar
+    uint32_t release;       // msTicks de la próxima activación
+    uint32_t wcet;          // Peor tiempo de ejecución medido en us
+    uint32_t runs;          // Ejecuciones completadas
+    uint32_t misses;        // Ejecuciones terminadas fuera de plazo
+    uint8_t armed;          // 1 si la tarea tiene una activación pendiente
+} sched_task_t;
+
+int8_t sched_add_periodic(sched_task_fn_t fn, uint32_t period_ms, uint32_t offset_ms, uint32_t deadline_ms);
+int8_t sched_add_oneshot(sched_task_fn_t fn, uint32_t deadline_ms);
+void sched_start(int8_t id, uint32_t delay_ms);
+void sched_cancel(int8_t id);
+void sched_remove(int8_t id);
+uint32_t sched_dispatch(void);
+uint32_t sched_idle_ms(void);
+const sched_task_t *sched_task_info(int8_t id);
+
+#endif // SCHEDULER_H_
@@ -3,10 +3,78 @@
 
 #include <stdint.h>
 
+// Perfiles de reloj del sistema
+typedef enum
+{
+    CLK_PROFILE_HSI_8MHZ,       // HSI interno a 8MHz (por defecto)
+    CLK_PROFILE_HSI_PLL_48MHZ,  // HSI/2 x 12 con el PLL a 48MHz
+    CLK_PROFILE_HSE_BYPASS_48MHZ // MCO 8MHz del ST-LINK (HSE bypass) x 6 con el PLL a 48MHz
+} clk_profile_t;
+
+#define CLK_HSE_TIMEOUT     0x5000  // Iteraciones máximas esperando HSERDY
+#define CLK_BOOT_PROFILE    CLK_PROFILE_HSI_PLL_48MHZ // Perfil aplicado por SystemInit() antes de inicializar la RAM
+
+// Variable en .noinit: el arranque no la copia ni la pone a cero y conserva su valor tras un reset en caliente
+#define NOINIT              __attribute__((section(".noinit")))
+
+// Función en .ramfunc: Reset_Handler la copia a SRAM junto con .data y se ejecuta sin los
+// estados de espera de la Flash. Con -DRAMFUNC_DISABLE se queda en Flash (para comparar)
+#ifdef RAMFUNC_DISABLE
+#define RAMFUNC
+#else
+#define RAMFUNC             __attribute__((section(".ramfunc")))
+#endif
+
+#define SYST_RVR_MAX            0xFFFFFF    // Valor máximo de recarga del SysTick (24 bits)
+#define SYSTICK_SLEEP_MIN_MS    2           // Reposo mínimo para reprogramar el SysTick
+#define SYSTICK_SLEEP_GUARD     64          // Ciclos mínimos hasta un tick para poder reprogramarlo
+#define SYSTICK_RESTART_CYCLES  12          // Ciclos aproximados con el contador parado al reprogramarlo
+
 void systick_init(void);
 void delay_ms(uint32_t ms);
 void clk_conf(void);
+void SystemInit(void);
+uint8_t clk_set_profile(clk_profile_t profile);
+void system_sleep(uint32_t max_ms);
+uint32_t timestamp_cycles(void);
+uint32_t micros(void);
 
 extern volatile uint32_t msTicks;
+extern uint32_t system_core_clock;
+
+#ifdef HOST_SIM
+
+// PRIMASK e IPSR son estado del modelo de periféricos (sim/sim.c): irq_restore() ejecuta
+// las ISR que hayan quedado pendientes
+uint32_t irq_save(void);
+void irq_restore(uint32_t primask);
+uint32_t irq_blocked(void);
+
+#else
+
+// Deshabilita las interrupciones y devuelve el estado previo de PRIMASK
+static inline uint32_t irq_save(void)
+{
+    uint32_t primask;
+    __asm volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) :: "memory");
+    return primask;
+}
+
+// Restaura el estado de PRIMASK guardado por irq_save()
+static inline void irq_restore(uint32_t primask)
+{
+    __asm volatile ("msr primask, %0" :: "r" (primask) : "memory");
+}
+
+// Devuelve distinto de 0 si se ejecuta dentro de una ISR o con interrupciones deshabilitadas
+static inline uint32_t irq_blocked(void)
+{
+    uint32_t primask, ipsr;
+    __asm volatile ("mrs %0, primask" : "=r" (primask));
+    __asm volatile ("mrs %0, ipsr" : "=r" (ipsr));
+    return (primask & 1U) | ipsr;
+}
+
+#endif // HOST_SIM
 
 #endif // SYSTEM_H_
@@ -0,0 +1,25 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+#define TLM_SYNC0           0xAA    // Primer byte de sincronismo de cada trama
+#define TLM_SYNC1           0x55    // Segundo byte de sincronismo
+#define TLM_MAX_PAYLOAD     64      // Longitud máxima de la carga útil en bytes
+#define TLM_OVERHEAD        7       // Sincronismo (2) + longitud + tipo + secuencia + CRC16 (2)
+
+// Tipos de trama
+typedef enum
+{
+    TLM_TYPE_TEMPERATURE = 0x01,    // int32 temperatura en m°C + uint16 VDD en mV
+    TLM_TYPE_SAMPLES     = 0x02,    // Bloque de muestras uint16 del ADC
+    TLM_TYPE_TEXT        = 0x03     // Texto ASCII sin terminador
+} tlm_type_t;
+
+uint16_t tlm_crc16(uint16_t crc, const uint8_t *data, uint16_t len);
+uint8_t tlm_send(tlm_type_t type, const uint8_t *payload, uint8_t len);
+uint8_t tlm_send_temperature(int32_t mdeg, uint16_t vdd_mv);
+uint8_t tlm_send_samples(const uint16_t *samples, uint8_t count);
+uint32_t tlm_dropped(void);
+
+#endif // TELEMETRY_H_
@@ -0,0 +1,34 @@
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <stdint.h>
+
+#define TIMER_WHEEL_SLOTS   32  // Ranuras de la rueda, una por ms (potencia de 2)
+
+typedef struct soft_timer soft_timer_t;
+
+// Función llamada al vencer un temporizador (desde SysTick_Handler)
+typedef void (*timer_callback_t)(soft_timer_t *timer);
+
+// Temporizador software: la memoria la aporta el usuario y debe permanecer válida mientras esté armado
+struct soft_timer
+{
+    soft_timer_t *next;         // Siguiente temporizador de la misma ranura
+    soft_timer_t *prev;         // Anterior temporizador de la misma ranura
+    uint32_t expires;           // msTicks de vencimiento
+    uint32_t period;            // Periodo de rearme en ms (0 = un disparo)
+    timer_callback_t cb;        // Función al vencer (puede ser 0)
+    volatile uint32_t *events;  // Palabra de eventos a marcar al vencer (puede ser 0)
+    uint32_t event_mask;        // Bits a activar en *events
+    volatile uint8_t armed;     // 1 mientras el temporizador está en la rueda
+};
+
+void timer_init(soft_timer_t *t, timer_callback_t cb);
+void timer_set_event(soft_timer_t *t, volatile uint32_t *events, uint32_t mask);
+void timer_arm(soft_timer_t *t, uint32_t delay_ms, uint32_t period_ms);
+void timer_cancel(soft_timer_t *t);
+uint8_t timer_armed(const soft_timer_t *t);
+void timer_wheel_tick(uint32_t now);
+uint32_t timer_wheel_next_expiry(uint32_t limit);
+
+#endif // TIMER_WHEEL_H_
@@ -3,9 +3,47 @@
 
 #include <stdint.h>
 
+#define UART_BAUD_DEFAULT   9600    // Velocidad inicial en baudios
+#define UART_TX_BUF_SIZE    256 // Tamaño del buffer de transmisión (potencia de 2)
+#define UART_RX_BUF_SIZE    128 // Tamaño de la FIFO de recepción por interrupción (potencia de 2)
+#define UART_RX_DMA_SIZE    64  // Tamaño del buffer circular de recepción por DMA (potencia de 2)
+
+// Mecanismo de transferencia de USART2
+typedef enum
+{
+    UART_MODE_IRQ,      // TX byte a byte desde la ISR, RX por RXNE hacia la FIFO
+    UART_MODE_DMA       // TX por bloques y RX circular con el DMA1 (canales 4 y 5)
+} uart_mode_t;
+
+// Política cuando el buffer de transmisión está lleno
+typedef enum
+{
+    UART_TX_BLOCK,      // Esperar a que la ISR libere espacio
+    UART_TX_DROP,       // Descartar los bytes nuevos
+    UART_TX_OVERWRITE   // Descartar los bytes más antiguos pendientes de enviar
+} uart_tx_policy_t;
+
+// Aviso de que un buffer entregado con uart_send_buffer() vuelve a ser del usuario
+typedef void (*uart_tx_release_cb_t)(const uint8_t *buf);
+
 void uart_conf(void);
+uint8_t uart_set_baud(uint32_t baud);
+uint32_t uart_get_baud(void);
 void uart_send_string(const char *str);
+void uart_send_char(char c);
+void uart_write(const uint8_t *data, uint16_t len);
+void uart_set_tx_policy(uart_tx_policy_t policy);
+uint32_t uart_tx_dropped(void);
+uint16_t uart_tx_space(void);
+uint8_t uart_tx_busy(void);
+void uart_flush(void);
+void uart_set_mode(uart_mode_t mode);
+uint8_t uart_send_buffer(const uint8_t *buf, uint16_t len);
+uint8_t uart_tx_buffer_released(const uint8_t *buf);
+void uart_set_tx_release_callback(uart_tx_release_cb_t cb);
+uint8_t uart_rx_idle(void);
 char uart_receive_char(void);
-uint8_t uart_data_available(void);
+uint16_t uart_data_available(void);
+uint32_t uart_rx_overruns(void);
 
 #endif // UART_H_
@@ -3,75 +3,1210 @@
  * @brief Implementación de funciones para el manejo del ADC
  * @details Contiene funciones para la configuración del ADC y lectura del sensor de temperatura
  *          interno del microcontrolador STM32F070RB.
+ *          Incluye un motor de muestreo en el que TIM3 (TRGO) dispara las conversiones a
+ *          una frecuencia fija y el canal 1 del DMA1 las guarda en un buffer ping-pong,
+ *          y un modo de barrido que convierte una lista de canales en una sola secuencia
+ *          y devuelve los resultados agrupados en una tabla.
+ *          El ADC funciona en un único modo a la vez; al terminar el muestreo o el
+ *          barrido se vuelve al modo continuo sobre el sensor de temperatura.
+ *          En modo continuo las lecturas del sensor pueden pasar por un filtro de
+ *          sobremuestreo (filter.c) alimentado desde la ISR del DMA.
+ *          La puesta en marcha es asíncrona: adc_conf() calibra y devuelve el control,
+ *          y los tiempos de estabilización corren en la rueda de temporizadores
+ *          (timer_wheel.c) mientras la aplicación ya atiende la UART.
+ *          La alarma de temperatura usa el watchdog analógico sobre el canal 16: el
+ *          hardware compara cada conversión con la ventana y solo interrumpe al salir
+ *          de ella.
  */
 
 #include "adc.h"
 #include "nucleo_conf.h"
 #include "system.h"
+#include "filter.h"
+#include "timer_wheel.h"
+#include "prof.h"
+
+// Coeficientes de conversión a temperatura calculados en compilación a partir de AVG_SLOPE.
+// La diferencia respecto a TEMP30_CAL se expresa en cuentas Q5 (1/32 de cuenta), de forma
+// que incluso con lecturas extremas (0 o 4095 con VDD alto) los productos caben en 32 bits.
+#define TEMP_MDEG_PER_COUNT_Q5  ((1000000UL * 32 + AVG_SLOPE / 2) / AVG_SLOPE) // m°C por cuenta en Q5 (5997)
+#define TEMP_DEG_PER_COUNT_Q15  ((1000UL * 32768 + AVG_SLOPE / 2) / AVG_SLOPE) // °C por cuenta en Q15 (6141)
+
+#define ADC_CONT_PAIRS          16                  // Pares temperatura/VREFINT del buffer circular del modo continuo
+#define ADC_CONT_LEN            (2 * ADC_CONT_PAIRS)
+
+#define ADC_CACHE_MAGIC         0xADC0CA1BUL        // Marca de adc_cache válida (RAM conservada tras un reset en caliente)
+#define ADC_CALFACT_MASK        0x7FU               // Factor de calibración en ADC_DR[6:0] al terminar ADCAL
+
+#define ADC_SENSOR_MIN_SMP      ADC_SMP_71_5        // Muestreo mínimo de los canales 16 y 17 (4µs de la hoja de datos)
+
+// Watchdog analógico sobre el sensor de temperatura (bits de ADC_CFGR1)
+#define ADC_AWD_TEMP            (ADC_CFGR1_AWDEN | ADC_CFGR1_AWDSGL | FIELD(ADC_CFGR1_AWDCH, ADC_CH_TEMP))
+
+// Modo de funcionamiento del ADC (propietario del canal 1 del DMA1)
+typedef enum
+{
+    ADC_MODE_CONTINUOUS,    // Conversión continua del sensor de temperatura (adc_conf)
+    ADC_MODE_SAMPLING,      // Motor de muestreo disparado por TIM3
+    ADC_MODE_SCAN           // Barrido de una lista de canales
+} adc_mode_t;
+
+// Fase de la puesta en marcha asíncrona del ADC
+typedef enum
+{
+    ADC_BOOT_OFF,           // adc_conf() no llamado
+    ADC_BOOT_SENSOR,        // Calibrado, esperando a que se estabilicen el sensor y VREFINT
+    ADC_BOOT_ENABLE,        // ADC activado, esperando antes de la primera conversión
+    ADC_BOOT_READY          // Modo continuo en marcha
+} adc_boot_t;
+
+// Datos del ADC que sobreviven a un reset en caliente (watchdog, NVIC_SystemReset)
+typedef struct
+{
+    uint32_t magic;         // ADC_CACHE_MAGIC si el contenido es válido
+    uint32_t calfact;       // Último factor de calibración medido
+    uint32_t vref_raw;      // Última lectura de VREFINT usada para la compensación de VDD
+    uint32_t check;         // ~(calfact ^ vref_raw): protege frente a RAM parcialmente conservada
+} adc_cache_t;
+
+// Grupo de canales de un barrido que comparten tiempo de muestreo
+typedef struct
+{
+    uint32_t chselr;        // Máscara de canales para ADC_CHSELR
+    uint8_t smp;            // Valor de ADC_SMPR
+    uint8_t count;          // Número de canales del grupo
+} adc_scan_group_t;
+
+// Tiempo de muestreo de cada valor de ADC_SMPR en medios ciclos del ADC (1.5 ... 239.5)
+static const uint16_t adc_smp_half_cycles[] = { 3, 15, 27, 57, 83, 111, 143, 479 };
+
+static volatile adc_mode_t adc_mode = ADC_MODE_CONTINUOUS;
+static volatile adc_boot_t adc_boot = ADC_BOOT_OFF;
+static soft_timer_t adc_boot_timer;     // Tiempos de estabilización de la puesta en marcha
+static adc_cache_t adc_cache NOINIT;    // Calibración del arranque anterior
+static uint8_t adc_warm_boot = 0;       // 1 si adc_cache era válida al arrancar (reset en caliente)
+static uint16_t cont_raw[ADC_CONT_LEN]; // Modo continuo: pares [temperatura, VREFINT] escritos por DMA
+static uint16_t cont_hold[2];           // Últimas lecturas del modo continuo mientras se usa otro modo
+static uint16_t vdd_vref_raw = 0;       // Lectura de VREFINT con la que se calcularon vdd_scale_q16 y vdd_mv
+static uint32_t vdd_scale_q16 = 65536;  // VDD / VDD_CALIB en Q16 (cuentas a VDD real -> cuentas a 3.3V)
+static uint32_t vdd_mv = VDD_CALIB;     // Tensión de alimentación calculada en mV
+static uint32_t vrefint_cal = 0;        // VREFINT_CAL leído de fábrica
+static uint32_t ts_cal30_q19 = 0;       // TEMP30_CAL leído de fábrica, en Q19 (Q3 de cuentas * Q16 de VDD)
+
+static filter_t temp_filter;            // Filtro de las lecturas del sensor en modo continuo
+static uint16_t temp_window[1U << ADC_FILTER_MAX_WINDOW]; // Ventana de la media móvil del filtro
+static volatile uint8_t temp_filter_on = 0; // 1 si el modo continuo alimenta temp_filter
+
+static uint8_t sampling_channel = ADC_CH_TEMP; // Canal convertido por el motor de muestreo
+
+static uint16_t *sampling_buf = 0;      // Buffer ping-pong del motor de muestreo
+static uint16_t sampling_len = 0;       // Longitud total del buffer (dos mitades)
+static adc_block_cb_t sampling_cb = 0;  // Aviso de mitad de buffer lista
+
+static adc_scan_group_t scan_groups[8]; // Un grupo por cada tiempo de muestreo usado
+static uint8_t scan_ngroups = 0;        // Grupos configurados
+static uint8_t scan_total = 0;          // Canales configurados
+static uint8_t scan_order[ADC_SCAN_MAX_CHANNELS]; // Posición en la tabla de cada muestra en orden hardware
+static uint16_t scan_raw[ADC_SCAN_MAX_CHANNELS];  // Muestras en el orden en que las escribe el DMA
+static uint16_t *scan_results = 0;      // Tabla de resultados del barrido en curso
+static volatile uint8_t scan_group = 0; // Grupo en conversión
+static volatile uint8_t scan_busy = 0;  // 1 mientras hay un barrido en curso
+
+static volatile adc_alarm_t alarm_state = ADC_ALARM_OFF; // Estado de la alarma de temperatura
+static adc_alarm_cb_t alarm_cb = 0;     // Aviso de cambio de estado
+static uint16_t alarm_low = 0;          // Ventana normal: umbral bajo en cuentas
+static uint16_t alarm_high = 0xFFF;     // Ventana normal: umbral alto en cuentas
+static uint16_t alarm_low_clear = 0;    // Vuelta desde ADC_ALARM_LOW: umbral bajo + histéresis
+static uint16_t alarm_high_clear = 0xFFF; // Vuelta desde ADC_ALARM_HIGH: umbral alto - histéresis
+
+/**
+ * @brief Detiene la conversión en curso del ADC
+ *
+ * @details ADC_CFGR1 solo puede modificarse con ADSTART = 0.
+ *
+ * @return Ninguno
+ */
+static void adc_stop_conversion(void)
+{
+    if (ADC_CR & ADC_CR_ADSTART)
+    {
+        ADC_CR |= ADC_CR_ADSTP;       // Pedir la parada
+        HW_WAIT_WHILE(ADC_CR & ADC_CR_ADSTP); // Esperar a que se complete
+    }
+}
+
+/**
+ * @brief Prepara un canal para ser convertido
+ *
+ * @details Los canales externos necesitan el pin en modo analógico (MODER = 11); los
+ *          internos necesitan habilitar el sensor de temperatura o VREFINT en ADC_CCR.
+ *
+ * @param ch Canal del ADC (0-17)
+ *
+ * @return Ninguno
+ */
+static void adc_channel_setup(uint8_t ch)
+{
+    if (ch <= 7)
+    {
+        RCC_AHBENR |= RCC_AHBENR_GPIOAEN; // PA0-PA7
+        GPIOA->MODER |= GPIO_MODER_VAL(ch, GPIO_MODE_ANALOG);
+    }
+    else if (ch <= 9)
+    {
+        RCC_AHBENR |= RCC_AHBENR_GPIOBEN; // PB0-PB1
+        GPIOB->MODER |= GPIO_MODER_VAL(ch - 8, GPIO_MODE_ANALOG);
+    }
+    else if (ch <= 15)
+    {
+        RCC_AHBENR |= RCC_AHBENR_GPIOCEN; // PC0-PC5
+        GPIOC->MODER |= GPIO_MODER_VAL(ch - 10, GPIO_MODE_ANALOG);
+    }
+    else if (ch == ADC_CH_TEMP)
+    {
+        ADC_CCR |= ADC_CCR_TSEN;
+    }
+    else
+    {
+        ADC_CCR |= ADC_CCR_VREFEN;
+    }
+}
+
+/**
+ * @brief Vuelve al modo continuo sobre el sensor de temperatura y VREFINT
+ *
+ * @details Configuración por defecto de adc_conf(): canales 16 y 17 en la misma
+ *          secuencia, 239.5 ciclos de muestreo y conversión continua. El canal 1 del
+ *          DMA1 copia en modo circular los pares de resultados a cont_raw. Solo genera
+ *          interrupciones (en cada mitad del buffer) si el filtro de temperatura está
+ *          activo.
+ *
+ * @return Ninguno
+ */
+static void adc_resume_continuous(void)
+{
+    uint32_t ccr = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16 | DMA_CCR_EN;
+
+    if (temp_filter_on)
+    {
+        ccr |= DMA_CCR_HTIE | DMA_CCR_TCIE; // Entregar cada mitad del buffer al filtro
+        NVIC_ISER = (1U << DMA1_CH1_IRQn);
+    }
+
+    RCC_AHBENR |= RCC_AHBENR_DMAEN;
+    DMA1_CCR(1) = 0;
+    DMA1_IFCR = DMA_IFCR_CGIF(1);
+    DMA1_CPAR(1) = (uint32_t)&ADC_DR;
+    DMA1_CMAR(1) = (uint32_t)cont_raw;
+    DMA1_CNDTR(1) = ADC_CONT_LEN;
+    DMA1_CCR(1) = ccr;
+
+    ADC_CHSELR = (1 << ADC_CH_TEMP) | (1 << ADC_CH_VREFINT); // Temperatura y VREFINT en la misma secuencia
+    ADC_SMPR = 7;                     // Tiempo de muestreo 239.5
+    ADC_CFGR1 = (ADC_CFGR1 & ~(ADC_CFGR1_EXTSEL | ADC_CFGR1_EXTEN))
+              | ADC_CFGR1_CONT | ADC_CFGR1_DMAEN | ADC_CFGR1_DMACFG;
+
+    adc_mode = ADC_MODE_CONTINUOUS;
+    ADC_CR |= ADC_CR_ADSTART;
+}
+
+/**
+ * @brief Devuelve la última lectura del modo continuo de uno de sus dos canales
+ *
+ * @details La última posición escrita se obtiene de DMA1_CNDTR; si corresponde al otro
+ *          canal del par se toma la anterior. Fuera del modo continuo se devuelve la
+ *          copia guardada por adc_cont_hold().
+ *
+ * @param vref 0 para el sensor de temperatura, 1 para VREFINT
+ *
+ * @return Valor de 12 bits (0 antes de la primera conversión)
+ */
+static uint16_t adc_cont_sample(uint8_t vref)
+{
+    uint16_t last;
+
+    if (adc_mode != ADC_MODE_CONTINUOUS)
+    {
+        return cont_hold[vref];
+    }
+
+    last = ADC_CONT_LEN - DMA1_CNDTR(1);            // Siguiente posición que escribirá el DMA
+    last = (last == 0 ? ADC_CONT_LEN : last) - 1;   // Última posición escrita
+    if ((last & 1) != vref)
+    {
+        last = (last == 0 ? ADC_CONT_LEN : last) - 1;
+    }
+
+    return cont_raw[last];
+}
+
+/**
+ * @brief Guarda las últimas lecturas del modo continuo antes de cambiar de modo
+ *
+ * @note Debe llamarse con la conversión detenida y antes de reprogramar el DMA
+ * @return Ninguno
+ */
+static void adc_cont_hold(void)
+{
+    if (adc_mode == ADC_MODE_CONTINUOUS)
+    {
+        cont_hold[0] = adc_cont_sample(0);
+        cont_hold[1] = adc_cont_sample(1);
+    }
+}
+
+/**
+ * @brief Devuelve la última muestra del sensor de temperatura
+ *
+ * @details El DMA es el único que lee ADC_DR: una lectura de la CPU limpiaría EOC y
+ *          el DMA perdería la petición. Si el motor de muestreo convierte el sensor se
+ *          toma la última posición escrita de su buffer; en otro caso la última lectura
+ *          del modo continuo, que se conserva mientras se usa otro modo.
+ *
+ * @return Valor de 12 bits de la última conversión del canal 16
+ */
+static uint16_t adc_last_sample(void)
+{
+    if (adc_mode == ADC_MODE_SAMPLING && sampling_channel == ADC_CH_TEMP && sampling_buf)
+    {
+        uint16_t pos = sampling_len - DMA1_CNDTR(1); // Siguiente posición que escribirá el DMA
+
+        return sampling_buf[(pos == 0 ? sampling_len : pos) - 1];
+    }
+
+    return adc_cont_sample(0);
+}
+
+/**
+ * @brief Indica si adc_cache contiene la calibración de un arranque anterior
+ *
+ * @return 1 si la marca y la comprobación coinciden, 0 tras un arranque en frío
+ */
+static uint8_t adc_cache_valid(void)
+{
+    return adc_cache.magic == ADC_CACHE_MAGIC &&
+           adc_cache.check == ~(adc_cache.calfact ^ adc_cache.vref_raw);
+}
+
+/**
+ * @brief Guarda la calibración actual en adc_cache
+ *
+ * @return Ninguno
+ */
+static void adc_cache_store(uint32_t calfact, uint32_t vref_raw)
+{
+    adc_cache.calfact = calfact;
+    adc_cache.vref_raw = vref_raw;
+    adc_cache.check = ~(calfact ^ vref_raw);
+    adc_cache.magic = ADC_CACHE_MAGIC;
+}
+
+/**
+ * @brief Recalcula la compensación de VDD con una lectura de VREFINT
+ *
+ * @details VDD / VDD_CALIB = VREFINT_CAL / VREFINT_DATA. Es la única división del cálculo
+ *          de temperatura.
+ *
+ * @return Ninguno
+ */
+static void adc_set_vref(uint16_t vref)
+{
+    vdd_vref_raw = vref;
+    vdd_scale_q16 = (vrefint_cal << 16) / vref;
+    vdd_mv = (VDD_CALIB * vdd_scale_q16) >> 16;
+}
+
+/**
+ * @brief Avanza la puesta en marcha del ADC al vencer cada tiempo de estabilización
+ *
+ * @note Se ejecuta en SysTick_Handler; las esperas activas (ADEN) duran microsegundos
+ * @return Ninguno
+ */
+static void adc_boot_step(soft_timer_t *timer)
+{
+    if (adc_boot == ADC_BOOT_SENSOR)
+    {
+        ADC_CR |= ADC_CR_ADEN;            // Activar el ADC
+        HW_WAIT_WHILE(!(ADC_CR & ADC_CR_ADEN)); // Esperar hasta que se active
+
+        adc_boot = ADC_BOOT_ENABLE;
+        timer_arm(timer, adc_warm_boot ? ADC_WARM_SETTLE_MS : ADC_ENABLE_SETTLE_MS, 0);
+    }
+    else if (adc_boot == ADC_BOOT_ENABLE)
+    {
+        adc_resume_continuous();          // Canales 16 y 17 en modo continuo con DMA y empezar conversion
+        adc_boot = ADC_BOOT_READY;
+    }
+}
 
 /**
- * @brief Configura el ADC para la lectura del sensor de temperatura interno
+ * @brief Inicia la configuración del ADC para la lectura del sensor de temperatura interno
  *
- * @details Esta función realiza las siguientes operaciones:
+ * @details Esta función realiza las siguientes operaciones y devuelve el control:
  *          1. Habilita el reloj del ADC
  *          2. Verifica y desactiva el ADC si está activo
- *          3. Realiza la calibración del ADC
- *          4. Activa el sensor de temperatura interno
- *          5. Configura el ADC en modo continuo
- *          6. Selecciona el canal apropiado y comienza la conversión
+ *          3. Realiza la calibración del ADC (unos pocos microsegundos) y lee los valores
+ *             de calibración de fábrica
+ *          4. Activa el sensor de temperatura interno y VREFINT
+ *          Desde SysTick, al vencer ADC_SENSOR_SETTLE_MS se activa el ADC y al vencer
+ *          ADC_ENABLE_SETTLE_MS comienza la conversión continua de ambos canales con DMA
+ *          (adc_ready()).
+ *          Tras un reset en caliente la alimentación ya está estable: ambas esperas se
+ *          reducen a ADC_WARM_SETTLE_MS y la compensación de VDD parte de la última
+ *          lectura de VREFINT guardada en adc_cache.
  *
+ * @note El F070 no permite escribir el factor de calibración (no existe ADC_CALFACT), por
+ *       lo que ADCAL se repite en cada arranque; adc_cache solo conserva su valor y la
+ *       compensación de VDD. Requiere systick_init() antes.
  * @return Ninguno
  */
 void adc_conf()
 {
-    RCC_APB2ENR |= (1 << 9);          // Habilitar el reloj del ADC
+    uint32_t calfact;
+
+    RCC_APB2ENR |= RCC_APB2ENR_ADCEN; // Habilitar el reloj del ADC
     
     if (ADC_CR & ADC_CR_ADEN)         // Comprobar si el bit ADEN del registro ADC_CR esta activo
     {                                 
         ADC_CR |= ADC_CR_ADDIS;       // Si esta activo enviar el bit ADDIS para desactivar el ADC
-        while (ADC_CR & ADC_CR_ADEN); // Esperar mientras el ADC se desactive
+        HW_WAIT_WHILE(ADC_CR & ADC_CR_ADEN); // Esperar mientras el ADC se desactive
     }
     
     ADC_CR |= ADC_CR_ADCAL;           // Empezar la calibracion
-    while (ADC_CR & ADC_CR_ADCAL);    // Esperar a finalizar la calibracion
-    
-    ADC_CCR |= (1 << 23);             // Activar sensor de temperatura interno bit 23
-    ADC_SMPR |= (7 << 0);             // Seleccion tiempo muestreo 239.5
-    
-    delay_ms(100);                    // Delay de estabilizacion
-    
-    ADC_CFGR1 |= (1 << 13);           // ADC en modo continuo
-    
+    HW_WAIT_WHILE(ADC_CR & ADC_CR_ADCAL); // Esperar a finalizar la calibracion
+    calfact = ADC_DR & ADC_CALFACT_MASK;
 
-    ADC_CHSELR |= (1 << 16);          // Seleccionar canal de 16 bits
-    
+    // Leer una sola vez los valores de calibración de fábrica
+    ts_cal30_q19 = (uint32_t)*TEMP30_CAL_ADDR << 19;
+    vrefint_cal = *VREFINT_CAL_ADDR;
 
-    ADC_CR |= ADC_CR_ADEN;            // Activar el ADC
-    while (!(ADC_CR & ADC_CR_ADEN));  // Esperar hasta que se active
-    
-    delay_ms(20);                     // Delay de estabilizacion
+    adc_warm_boot = adc_cache_valid();
+    if (adc_warm_boot && adc_cache.vref_raw != 0 && adc_cache.vref_raw <= 0xFFF && vrefint_cal != 0)
+    {
+        adc_set_vref((uint16_t)adc_cache.vref_raw); // VDD compensado desde la primera lectura
+    }
     
-    ADC_CR |= ADC_CR_ADSTART;         // Empezar conversion
+    ADC_COMMON->CCR |= ADC_CCR_TSEN | ADC_CCR_VREFEN; // Activar sensor de temperatura (bit 23) y VREFINT (bit 22)
+
+    adc_boot = ADC_BOOT_SENSOR;
+    timer_init(&adc_boot_timer, adc_boot_step);
+    timer_arm(&adc_boot_timer, adc_warm_boot ? ADC_WARM_SETTLE_MS : ADC_SENSOR_SETTLE_MS, 0);
+    adc_cache_store(calfact, vdd_vref_raw);
+}
+
+/**
+ * @brief Indica si el ADC ha terminado su puesta en marcha
+ *
+ * @details Hasta entonces las lecturas de temperatura y VDD no son válidas y
+ *          adc_sampling_start() y adc_scan_start() no arrancan.
+ *
+ * @return 1 si el modo continuo está en marcha, 0 si no
+ */
+uint8_t adc_ready(void)
+{
+    return adc_boot == ADC_BOOT_READY;
+}
+
+/**
+ * @brief Actualiza el factor de compensación de VDD si ha cambiado la lectura de VREFINT
+ *
+ * @details La división de adc_set_vref() solo se ejecuta cuando cambia VREFINT_DATA; la
+ *          lectura nueva se guarda en adc_cache para el siguiente arranque.
+ *
+ * @return Ninguno
+ */
+static void adc_update_vdd(void)
+{
+    uint16_t vref;
+
+    if (adc_boot != ADC_BOOT_READY)
+    {
+        return; // Sin conversiones todavía: se mantiene el valor de adc_cache o VDD_CALIB
+    }
+
+    vref = adc_cont_sample(1);
+    if (vref != vdd_vref_raw && vref != 0 && vrefint_cal != 0)
+    {
+        adc_set_vref(vref);
+        adc_cache_store(adc_cache.calfact, vref);
+    }
+}
+
+/**
+ * @brief Diferencia entre una lectura compensada y TEMP30_CAL en cuentas Q5
+ *
+ * @details La lectura llega con 3 bits fraccionarios para conservar la resolución que
+ *          añade el sobremuestreo. El producto sin signo cabe en 32 bits (32767 * 1.1
+ *          en Q16) y la diferencia se interpreta con signo.
+ *
+ * @param raw_q3 Lectura del sensor de temperatura en cuentas Q3
+ *
+ * @return (raw * VDD / VDD_CALIB - TEMP30_CAL) * 32
+ */
+static int32_t adc_temp_diff_q5(uint32_t raw_q3)
+{
+    adc_update_vdd();
+    return (int32_t)(raw_q3 * vdd_scale_q16 - ts_cal30_q19) >> 14; // Q19 -> Q5
+}
+
+/**
+ * @brief Devuelve la lectura del sensor de temperatura que usan las conversiones
+ *
+ * @details Con el filtro activo y en modo continuo es la salida del filtro, cuyos
+ *          12 + os_bits bits se llevan a Q3. En otro caso es la última muestra.
+ *
+ * @return Lectura del sensor en cuentas Q3
+ */
+static uint32_t adc_temp_raw_q3(void)
+{
+    if (temp_filter_on && adc_mode == ADC_MODE_CONTINUOUS && filter_ready(&temp_filter))
+    {
+        return (uint32_t)filter_output(&temp_filter) << (3 - temp_filter.os_bits);
+    }
+
+    return (uint32_t)adc_last_sample() << 3;
+}
+
+/**
+ * @brief Configura el filtro de las lecturas del sensor de temperatura
+ *
+ * @details En modo continuo el ADC convierte unos 27000 pares temperatura/VREFINT por
+ *          segundo. Con el filtro activo, el DMA interrumpe en cada mitad del buffer
+ *          circular (ADC_CONT_PAIRS / 2 pares) y la ISR pasa cada lectura del sensor
+ *          al filtro, que la procesa en O(1). get_temperature() y
+ *          get_temperature_mdeg() usan entonces la salida filtrada. El filtro vuelve a
+ *          empezar desde cero, y sigue activo tras un muestreo o un barrido.
+ *
+ * @param os_bits Bits extra por sobremuestreo (0 a ADC_FILTER_MAX_OS_BITS)
+ * @param mode Etapa posterior: FILTER_NONE, FILTER_MOVING_AVG o FILTER_IIR
+ * @param shift log2 de la ventana de la media móvil (hasta ADC_FILTER_MAX_WINDOW) o
+ *              constante de tiempo del IIR (hasta FILTER_MAX_SHIFT)
+ *
+ * @note Con os_bits = 0 y FILTER_NONE el filtro se desactiva y el modo continuo deja de
+ *       generar interrupciones
+ * @return 1 si la configuración es válida, 0 si no
+ */
+uint8_t adc_temp_filter(uint8_t os_bits, filter_mode_t mode, uint8_t shift)
+{
+    uint8_t on = (os_bits != 0 || mode != FILTER_NONE);
+    uint32_t primask;
+
+    if (os_bits > ADC_FILTER_MAX_OS_BITS || (mode == FILTER_MOVING_AVG && shift > ADC_FILTER_MAX_WINDOW))
+    {
+        return 0;
+    }
+
+    primask = irq_save();  // La ISR del DMA no debe ver el filtro a medio configurar
+    if (!filter_init(&temp_filter, os_bits, mode, shift, temp_window))
+    {
+        irq_restore(primask);
+        return 0;
+    }
+    temp_filter_on = on;
+    irq_restore(primask);
+
+    if (adc_mode == ADC_MODE_CONTINUOUS && adc_boot == ADC_BOOT_READY)
+    {
+        adc_stop_conversion();
+        adc_cont_hold();
+        adc_resume_continuous(); // Activar o quitar las interrupciones del DMA
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Convierte una lectura del sensor de temperatura a milésimas de grado
+ *
+ * @details Misma fórmula que get_temperature() con todas las divisiones sustituidas
+ *          por multiplicaciones y desplazamientos:
+ *          mTemp = ((ADC_Value * VDD_APPLI / VDD_CALIB - TEMP30_CAL_VALUE) * 10^6 / AVG_SLOPE) + 30000
+ *          El factor VDD_APPLI / VDD_CALIB se guarda en Q16 y 10^6 / AVG_SLOPE es una
+ *          constante Q5 calculada en compilación.
+ *
+ * @param raw Lectura de 12 bits del sensor de temperatura (p.ej. del motor de muestreo)
+ *
+ * @return Temperatura en milésimas de grado Celsius
+ */
+int32_t adc_temp_mdeg_from_raw(uint16_t raw)
+{
+    return ((adc_temp_diff_q5((uint32_t)raw << 3) * (int32_t)TEMP_MDEG_PER_COUNT_Q5) >> 10) + 30000;
 }
 
 /**
  * @brief Calcula la temperatura actual basándose en los valores del ADC
  *
- * @details Obtiene el valor actual del registro de datos del ADC y lo convierte
+ * @details Obtiene la última conversión del sensor de temperatura y la convierte
  *          a grados Celsius utilizando la siguiente fórmula:
  *          Temp = ((ADC_Value * VDD_APPLI / VDD_CALIB - TEMP30_CAL_VALUE) * 1000 / AVG_SLOPE) + 30
  *          
  *          Donde:
  *          - ADC_Value: Valor leído del registro de datos del ADC
- *          - VDD_APPLI: Voltaje de aplicación (mV)
+ *          - VDD_APPLI: Voltaje de aplicación (mV), medido con VREFINT (adc_get_vdd)
  *          - VDD_CALIB: Voltaje de calibración (mV)
  *          - TEMP30_CAL_VALUE: Valor de calibración a 30°C (almacenado en memoria)
  *          - AVG_SLOPE: Pendiente promedio (μV/°C)
  *
+ *          El Cortex-M0 no tiene divisor hardware, por lo que las divisiones se sustituyen
+ *          por coeficientes en punto fijo calculados al calibrar y en compilación. El
+ *          resultado se redondea al grado más cercano. Con adc_temp_filter() activo se
+ *          usa la lectura filtrada en lugar de una única muestra.
+ *
  * @return int32_t Temperatura en grados Celsius
  */
 int32_t get_temperature(void)
 {
-    uint32_t adc_value = ADC_DR; // Leer el valor del registro de datos
-    return (((int32_t)adc_value * VDD_APPLI / VDD_CALIB - (int32_t)*TEMP30_CAL_ADDR) * 1000 / AVG_SLOPE) + 30;
+    PROF_START(PROF_GET_TEMPERATURE);
+    int32_t diff_q5 = adc_temp_diff_q5(adc_temp_raw_q3()); // Última lectura del sensor (filtrada si procede)
+    int32_t temp = ((diff_q5 * (int32_t)TEMP_DEG_PER_COUNT_Q15 + (1 << 19)) >> 20) + 30;
+    PROF_END(PROF_GET_TEMPERATURE);
+
+    return temp;
+}
+
+/**
+ * @brief Calcula la temperatura actual en milésimas de grado
+ *
+ * @return int32_t Temperatura en milésimas de grado Celsius
+ */
+int32_t get_temperature_mdeg(void)
+{
+    return ((adc_temp_diff_q5(adc_temp_raw_q3()) * (int32_t)TEMP_MDEG_PER_COUNT_Q5) >> 10) + 30000;
+}
+
+/**
+ * @brief Devuelve la tensión de alimentación real medida con VREFINT
+ *
+ * @details VDD = VDD_CALIB * VREFINT_CAL / VREFINT_DATA, donde VREFINT_CAL es la lectura
+ *          de fábrica de VREFINT a 3.3V. El resultado se guarda junto a la lectura de
+ *          VREFINT que lo generó y la división solo se repite cuando esa lectura cambia.
+ *
+ * @return Tensión de alimentación en mV (VDD_CALIB hasta la primera conversión)
+ */
+uint32_t adc_get_vdd(void)
+{
+    adc_update_vdd();
+    return vdd_mv;
+}
+
+/**
+ * @brief Arranca el muestreo periódico disparado por TIM3 con DMA a un buffer ping-pong
+ *
+ * @details TIM3 genera TRGO en cada desbordamiento y cada flanco dispara una conversión
+ *          del canal indicado. El canal 1 del DMA1 escribe los resultados en
+ *          modo circular y genera una interrupción al llenar cada mitad del buffer, de
+ *          forma que la aplicación procesa una mitad mientras el DMA escribe la otra.
+ *          El periodo se calcula a partir de system_core_clock con el menor preescalador
+ *          que permita que ARR quepa en 16 bits, y ADC_SMPR toma el mayor tiempo de
+ *          muestreo con el que la conversión (muestreo + 12.5 ciclos a ADC_CLOCK_HZ)
+ *          termina antes del siguiente disparo: un disparo durante una conversión se
+ *          perdería sin aviso.
+ *
+ * @param channel Canal a convertir (0-15 externos, ADC_CH_TEMP o ADC_CH_VREFINT)
+ * @param rate_hz Frecuencia de muestreo deseada en Hz, hasta ADC_SAMPLING_MAX_RATE
+ *                (166000 para los canales internos, que necesitan ADC_SENSOR_MIN_SMP)
+ * @param buf Buffer de muestras (debe permanecer válido hasta adc_sampling_stop())
+ * @param len Número de muestras del buffer, par (cada mitad tiene len / 2)
+ * @param cb Función llamada desde la ISR del DMA con cada mitad lista (puede ser 0)
+ *
+ * @note Con 239.5 ciclos de muestreo el máximo son unas 55000 muestras/s; por encima
+ *       el tiempo de muestreo baja hasta 1.5 ciclos (1Msps), con más error para fuentes
+ *       de alta impedancia.
+ * @note Con la alarma de temperatura activa (adc_temp_alarm()) solo se admite el
+ *       canal ADC_CH_TEMP: con otro canal el watchdog no vería ninguna conversión del sensor
+ * @return Frecuencia de muestreo real en Hz, o 0 si los parámetros no son válidos, la
+ *         conversión no cabe en el periodo, hay un barrido en curso, la alarma de
+ *         temperatura impide el canal o el ADC no ha terminado de arrancar
+ */
+uint32_t adc_sampling_start(uint8_t channel, uint32_t rate_hz, uint16_t *buf, uint16_t len, adc_block_cb_t cb)
+{
+    uint32_t ticks, psc, arr, rate, period;
+    uint8_t smp;
+
+    if (channel >= ADC_SCAN_MAX_CHANNELS || rate_hz == 0 || rate_hz > ADC_SAMPLING_MAX_RATE ||
+        buf == 0 || len < 2 || (len & 1))
+    {
+        return 0;
+    }
+
+    ticks = system_core_clock / rate_hz;    // Ciclos de reloj por muestra
+    if (ticks < 2)
+    {
+        return 0;
+    }
+    psc = (ticks - 1) >> 16;                // Preescalador mínimo para que ARR quepa en 16 bits
+    arr = ticks / (psc + 1) - 1;
+    rate = system_core_clock / ((psc + 1) * (arr + 1));
+
+    // Mayor tiempo de muestreo cuya conversión (+ 12.5 ciclos) cabe en el periodo real
+    period = (2 * ADC_CLOCK_HZ) / rate;     // Medios ciclos del ADC por muestra
+    smp = ADC_SMP_239_5;
+    while (adc_smp_half_cycles[smp] + 25U > period && smp > ADC_SMP_1_5)
+    {
+        smp--;
+    }
+    if (adc_smp_half_cycles[smp] + 25U > period || (channel >= ADC_CH_TEMP && smp < ADC_SENSOR_MIN_SMP))
+    {
+        return 0; // El ADC no termina a tiempo: se perderían disparos
+    }
+
+    if (scan_busy || adc_boot != ADC_BOOT_READY || (alarm_state != ADC_ALARM_OFF && channel != ADC_CH_TEMP))
+    {
+        return 0;
+    }
+
+    adc_stop_conversion();
+    TIM3_CR1 &= ~TIM_CR1_CEN;
+    adc_cont_hold();
+
+    // DMA1 canal 1: ADC_DR -> buffer, 16 bits, circular, interrupción en cada mitad
+    RCC_AHBENR |= RCC_AHBENR_DMAEN;
+    DMA1_CCR(1) = 0;
+    DMA1_IFCR = DMA_IFCR_CGIF(1);
+    DMA1_CPAR(1) = (uint32_t)&ADC_DR;
+    DMA1_CMAR(1) = (uint32_t)buf;
+    DMA1_CNDTR(1) = len;
+    sampling_buf = buf;
+    sampling_len = len;
+    sampling_cb = cb;
+    DMA1_CCR(1) = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16
+                | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+    NVIC_ISER = (1U << DMA1_CH1_IRQn);
+
+    // ADC: una conversión del canal por flanco de TIM3_TRGO, peticiones DMA circulares
+    adc_channel_setup(channel);
+    sampling_channel = channel;
+    ADC_CHSELR = (1UL << channel);
+    ADC_SMPR = smp;
+    ADC_CFGR1 = (ADC_CFGR1 & ~(ADC_CFGR1_CONT | ADC_CFGR1_EXTSEL | ADC_CFGR1_EXTEN))
+              | ADC_CFGR1_DMAEN | ADC_CFGR1_DMACFG | ADC_CFGR1_EXTSEL_TIM3 | ADC_CFGR1_EXTEN_RISING;
+
+    // TIM3: base de tiempos, el evento de actualización se envía como TRGO
+    RCC_APB1ENR |= RCC_APB1ENR_TIM3EN;
+    TIM3_PSC = psc;
+    TIM3_ARR = arr;
+    TIM3_CR2 = TIM_CR2_MMS_UPDATE;
+    TIM3_EGR = TIM_EGR_UG;      // Cargar PSC y ARR (el ADC aún no atiende disparos)
+
+    adc_mode = ADC_MODE_SAMPLING; // Al final: adc_last_sample() puede ejecutarse en una ISR
+    ADC_CR |= ADC_CR_ADSTART;   // El ADC queda esperando los disparos
+    TIM3_CR1 |= TIM_CR1_CEN;    // Empezar a disparar
+
+    return rate;
+}
+
+/**
+ * @brief Detiene el motor de muestreo y vuelve al modo continuo de adc_conf()
+ *
+ * @return Ninguno
+ */
+void adc_sampling_stop(void)
+{
+    if (adc_mode != ADC_MODE_SAMPLING)
+    {
+        return;
+    }
+
+    TIM3_CR1 &= ~TIM_CR1_CEN;
+    adc_stop_conversion();
+    sampling_buf = 0;
+
+    adc_resume_continuous();
+}
+
+/**
+ * @brief Configura la lista de canales de un barrido
+ *
+ * @details En el STM32F0 ADC_SMPR es común a todos los canales y la secuencia se
+ *          convierte siempre en orden ascendente de canal. Para respetar el tiempo de
+ *          muestreo de cada canal, los canales se agrupan por tiempo de muestreo y cada
+ *          grupo se convierte como una secuencia DMA; el barrido completo encadena los
+ *          grupos desde la ISR sin intervención de la aplicación. Los pines de los canales
+ *          externos se configuran en modo analógico y se habilitan VREFINT y el sensor de
+ *          temperatura si están en la lista.
+ *
+ * @param channels Lista de canales y tiempos de muestreo, en el orden de la tabla de resultados
+ * @param count Número de canales (1 a ADC_SCAN_MAX_CHANNELS, sin repetir)
+ *
+ * @return 1 si la configuración es válida, 0 si no (o hay un barrido en curso)
+ */
+uint8_t adc_scan_config(const adc_scan_channel_t *channels, uint8_t count)
+{
+    uint32_t used = 0;
+    uint8_t k = 0;
+
+    if (scan_busy || count == 0 || count > ADC_SCAN_MAX_CHANNELS)
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        uint8_t ch = channels[i].channel;
+
+        if (ch >= ADC_SCAN_MAX_CHANNELS || (used & (1UL << ch)) || channels[i].smp > ADC_SMP_239_5)
+        {
+            return 0; // Canal inexistente o repetido
+        }
+        used |= (1UL << ch);
+
+        adc_channel_setup(ch);
+    }
+
+    // Agrupar por tiempo de muestreo; dentro de cada grupo el hardware convierte en orden ascendente
+    scan_ngroups = 0;
+    for (uint8_t smp = 0; smp <= ADC_SMP_239_5; smp++)
+    {
+        adc_scan_group_t *g = &scan_groups[scan_ngroups];
+
+        g->chselr = 0;
+        g->count = 0;
+        for (uint8_t ch = 0; ch < ADC_SCAN_MAX_CHANNELS; ch++)
+        {
+            for (uint8_t i = 0; i < count; i++)
+            {
+                if (channels[i].channel == ch && channels[i].smp == smp)
+                {
+                    g->chselr |= (1UL << ch);
+                    g->count++;
+                    scan_order[k++] = i;
+                }
+            }
+        }
+
+        if (g->count)
+        {
+            g->smp = smp;
+            scan_ngroups++;
+        }
+    }
+    scan_total = count;
+
+    return 1;
+}
+
+/**
+ * @brief Programa la conversión DMA de un grupo del barrido
+ *
+ * @param group Índice del grupo
+ * @param offset Posición en scan_raw de la primera muestra del grupo
+ *
+ * @return Ninguno
+ */
+static void adc_scan_run_group(uint8_t group, uint8_t offset)
+{
+    const adc_scan_group_t *g = &scan_groups[group];
+
+    DMA1_CCR(1) = 0;
+    DMA1_IFCR = DMA_IFCR_CGIF(1);
+    DMA1_CMAR(1) = (uint32_t)&scan_raw[offset];
+    DMA1_CNDTR(1) = g->count;
+    DMA1_CCR(1) = DMA_CCR_MINC | DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16 | DMA_CCR_TCIE | DMA_CCR_EN;
+
+    ADC_CHSELR = g->chselr;
+    ADC_SMPR = g->smp;
+    ADC_CR |= ADC_CR_ADSTART;         // Una única secuencia (CONT = 0)
+}
+
+/**
+ * @brief Inicia un barrido de los canales configurados sin bloquear
+ *
+ * @details Detiene el modo continuo y lanza el primer grupo. Al terminar el último
+ *          grupo la ISR copia los resultados a la tabla y vuelve al modo continuo.
+ *
+ * @param results Tabla donde se escribirá el resultado de cada canal, en el orden de
+ *                la lista pasada a adc_scan_config()
+ *
+ * @return 1 si se ha iniciado, 0 si no hay canales configurados o el ADC está ocupado
+ */
+uint8_t adc_scan_start(uint16_t *results)
+{
+    if (scan_total == 0 || scan_busy || adc_mode == ADC_MODE_SAMPLING || adc_boot != ADC_BOOT_READY)
+    {
+        return 0;
+    }
+
+    adc_stop_conversion();
+    adc_cont_hold();
+    adc_mode = ADC_MODE_SCAN;
+    scan_results = results;
+    scan_group = 0;
+    scan_busy = 1;
+
+    RCC_AHBENR |= RCC_AHBENR_DMAEN;
+    DMA1_CPAR(1) = (uint32_t)&ADC_DR;
+    NVIC_ISER = (1U << DMA1_CH1_IRQn);
+
+    // Conversión única por software con DMA en modo de un solo disparo
+    ADC_CFGR1 &= ~(ADC_CFGR1_CONT | ADC_CFGR1_DMACFG | ADC_CFGR1_EXTSEL | ADC_CFGR1_EXTEN);
+    ADC_CFGR1 |= ADC_CFGR1_DMAEN;
+
+    adc_scan_run_group(0, 0);
+    return 1;
+}
+
+/**
+ * @brief Indica si hay un barrido en curso
+ *
+ * @return 1 mientras no se hayan escrito los resultados, 0 si no
+ */
+uint8_t adc_scan_busy(void)
+{
+    return scan_busy;
+}
+
+/**
+ * @brief Realiza un barrido completo y espera los resultados
+ *
+ * @param results Tabla de resultados (un valor por canal configurado)
+ *
+ * @note No debe llamarse desde una ISR: el barrido termina en la ISR del DMA
+ * @return 1 si se han obtenido los resultados, 0 si no se pudo iniciar
+ */
+uint8_t adc_scan_read(uint16_t *results)
+{
+    if (!adc_scan_start(results))
+    {
+        return 0;
+    }
+
+    HW_WAIT_WHILE(scan_busy);
+    return 1;
+}
+
+/**
+ * @brief Avanza el barrido al terminar la transferencia DMA de un grupo
+ *
+ * @return Ninguno
+ */
+static void adc_scan_group_done(void)
+{
+    uint8_t offset = 0;
+
+    HW_WAIT_WHILE(ADC_CR & ADC_CR_ADSTART); // El hardware la limpia al final de la secuencia
+
+    for (uint8_t g = 0; g <= scan_group; g++)
+    {
+        offset += scan_groups[g].count;
+    }
+
+    if (++scan_group < scan_ngroups)
+    {
+        adc_scan_run_group(scan_group, offset);
+        return;
+    }
+
+    for (uint8_t k = 0; k < scan_total; k++)
+    {
+        scan_results[scan_order[k]] = scan_raw[k]; // Reordenar al orden de la lista
+    }
+
+    adc_resume_continuous();
+    scan_busy = 0;
+}
+
+/**
+ * @brief Pasa al filtro las lecturas del sensor de una mitad del buffer del modo continuo
+ *
+ * @param pairs Primer par [temperatura, VREFINT] de la mitad completada
+ *
+ * @return Ninguno
+ */
+static void adc_filter_feed(const uint16_t *pairs)
+{
+    for (uint8_t i = 0; i < ADC_CONT_PAIRS / 2; i++)
+    {
+        filter_push(&temp_filter, pairs[2 * i]); // Posiciones pares: sensor de temperatura
+    }
+}
+
+/**
+ * @brief Atiende la interrupción del canal 1 del DMA1 según el modo del ADC
+ *
+ * @details Con el motor de muestreo entrega al callback la primera mitad del buffer
+ *          en la media transferencia y la segunda en la transferencia completa.
+ *          Durante un barrido, cada transferencia completa cierra un grupo. En modo
+ *          continuo pasa al filtro las lecturas del sensor de la mitad completada.
+ *
+ * @return Ninguno
+ */
+RAMFUNC static void adc_dma_irq(void)
+{
+    uint32_t isr = DMA1_ISR;
+    uint16_t half = sampling_len / 2;
+
+    if (adc_mode == ADC_MODE_SCAN)
+    {
+        if (isr & DMA_ISR_TCIF(1))
+        {
+            DMA1_IFCR = DMA_IFCR_CGIF(1);
+            adc_scan_group_done();
+        }
+        return;
+    }
+
+    if (adc_mode == ADC_MODE_CONTINUOUS)
+    {
+        DMA1_IFCR = isr & (DMA_ISR_HTIF(1) | DMA_ISR_TCIF(1));
+        if (temp_filter_on)
+        {
+            if (isr & DMA_ISR_HTIF(1))
+            {
+                adc_filter_feed(&cont_raw[0]);
+            }
+            if (isr & DMA_ISR_TCIF(1))
+            {
+                adc_filter_feed(&cont_raw[ADC_CONT_LEN / 2]);
+            }
+        }
+        return;
+    }
+
+    // Los bits de DMA1_IFCR ocupan las mismas posiciones que los de DMA1_ISR
+    if (isr & DMA_ISR_HTIF(1))
+    {
+        DMA1_IFCR = DMA_ISR_HTIF(1);
+        if (sampling_cb)
+        {
+            sampling_cb(&sampling_buf[0], half);
+        }
+    }
+
+    if (isr & DMA_ISR_TCIF(1))
+    {
+        DMA1_IFCR = DMA_ISR_TCIF(1);
+        if (sampling_cb)
+        {
+            sampling_cb(&sampling_buf[half], half);
+        }
+    }
+}
+
+/**
+ * @brief Manejador de interrupciones del canal 1 del DMA1
+ *
+ * @note Definida en el startup del microcontrolador
+ * @return Ninguno
+ */
+RAMFUNC void DMA1_CH1_IRQHandler(void)
+{
+    PROF_START(PROF_ISR_DMA1_CH1);
+    adc_dma_irq();
+    PROF_END(PROF_ISR_DMA1_CH1);
+}
+
+/**
+ * @brief Convierte una temperatura en la lectura del sensor que la produce
+ *
+ * @details Inversa de adc_temp_mdeg_from_raw() con la compensación de VDD actual. Usa
+ *          divisiones, por lo que solo se llama al configurar la alarma.
+ *
+ * @param mdeg Temperatura en milésimas de grado (hasta ±ADC_ALARM_MAX_MDEG)
+ *
+ * @return Lectura de 12 bits, saturada a 0-4095
+ */
+static uint16_t adc_temp_raw_from_mdeg(int32_t mdeg)
+{
+    int32_t counts = (int32_t)(ts_cal30_q19 >> 19) + ((mdeg - 30000) * (int32_t)AVG_SLOPE) / 1000000; // Cuentas a VDD_CALIB
+    uint32_t raw;
+
+    if (counts <= 0)
+    {
+        return 0;
+    }
+
+    raw = (((uint32_t)counts << 16) + vdd_scale_q16 / 2) / vdd_scale_q16;
+    return (raw > 0xFFF) ? 0xFFF : (uint16_t)raw;
+}
+
+/**
+ * @brief Programa el watchdog analógico
+ *
+ * @details ADC_CFGR1 y ADC_TR solo pueden modificarse con ADSTART = 0: la conversión
+ *          se detiene y se reanuda en el mismo modo. En modo continuo se reprograma
+ *          también el DMA para que los pares temperatura/VREFINT sigan alineados.
+ *
+ * @param awd Bits AWDEN, AWDSGL y AWDCH de ADC_CFGR1
+ * @param low Umbral bajo: aviso con lecturas menores
+ * @param high Umbral alto: aviso con lecturas mayores
+ *
+ * @note No debe llamarse durante un barrido
+ * @return Ninguno
+ */
+static void adc_alarm_window(uint32_t awd, uint16_t low, uint16_t high)
+{
+    uint8_t running = (ADC_CR & ADC_CR_ADSTART) ? 1 : 0;
+
+    adc_stop_conversion();
+    ADC_TR = FIELD(ADC_TR_HT, high) | FIELD(ADC_TR_LT, low);
+    REG_MODIFY(ADC1->CFGR1, ADC_CFGR1_AWDEN | ADC_CFGR1_AWDSGL | ADC_CFGR1_AWDCH, awd);
+    ADC_ISR = ADC_ISR_AWD;              // Descartar un aviso de la ventana anterior
+
+    if (!running)
+    {
+        return; // Puesta en marcha: el modo continuo arranca con la ventana ya programada
+    }
+
+    if (adc_mode == ADC_MODE_CONTINUOUS)
+    {
+        adc_resume_continuous();
+    }
+    else
+    {
+        ADC_CR |= ADC_CR_ADSTART;       // Motor de muestreo: vuelve a esperar los disparos de TIM3
+    }
+}
+
+/**
+ * @brief Activa la alarma de temperatura sobre el watchdog analógico
+ *
+ * @details Los umbrales se convierten a cuentas del ADC una sola vez, con la
+ *          compensación de VDD del momento, y el hardware compara cada conversión del
+ *          sensor sin intervención de la CPU. Al salir de la ventana la ISR del ADC
+ *          avisa con cb y reprograma el watchdog con la ventana de vuelta (el umbral
+ *          superado menos/más la histéresis), de forma que solo hay una interrupción
+ *          por cambio de estado aunque la temperatura siga fuera de la ventana. La
+ *          histéresis absorbe también el ruido de las conversiones, que el watchdog ve
+ *          sin filtrar.
+ *          La latencia es de una conversión del sensor (unos 36 µs en modo continuo,
+ *          un par temperatura/VREFINT, o el periodo del motor de muestreo). Durante
+ *          un barrido los avisos se posponen hasta volver al modo continuo. Con la
+ *          alarma activa el motor de muestreo solo admite el canal ADC_CH_TEMP, y la
+ *          alarma no se activa mientras muestrea otro canal.
+ *
+ * @param low_mdeg Umbral bajo en milésimas de grado (-ADC_ALARM_MAX_MDEG para no vigilarlo)
+ * @param high_mdeg Umbral alto en milésimas de grado
+ * @param hyst_mdeg Histéresis para volver a ADC_ALARM_NORMAL, hasta high_mdeg - low_mdeg
+ * @param cb Función llamada desde la ISR del ADC con cada nuevo estado (puede ser 0)
+ *
+ * @note Requiere adc_conf() antes. Un cambio posterior de VDD no mueve los umbrales:
+ *       para recalcularlos basta con volver a llamar a la función
+ * @return 1 si se ha activado, 0 si los parámetros no son válidos, hay un barrido en
+ *         curso o el motor de muestreo convierte otro canal
+ */
+uint8_t adc_temp_alarm(int32_t low_mdeg, int32_t high_mdeg, int32_t hyst_mdeg, adc_alarm_cb_t cb)
+{
+    uint32_t primask;
+
+    if (low_mdeg < -(int32_t)ADC_ALARM_MAX_MDEG || high_mdeg > (int32_t)ADC_ALARM_MAX_MDEG ||
+        low_mdeg >= high_mdeg || hyst_mdeg < 0 || hyst_mdeg > high_mdeg - low_mdeg ||
+        adc_boot == ADC_BOOT_OFF || scan_busy ||
+        (adc_mode == ADC_MODE_SAMPLING && sampling_channel != ADC_CH_TEMP))
+    {
+        return 0;
+    }
+
+    adc_update_vdd();
+
+    primask = irq_save(); // La ISR del ADC no debe ver la alarma a medio configurar
+    alarm_low = adc_temp_raw_from_mdeg(low_mdeg);
+    alarm_high = adc_temp_raw_from_mdeg(high_mdeg);
+    alarm_low_clear = adc_temp_raw_from_mdeg(low_mdeg + hyst_mdeg);
+    alarm_high_clear = adc_temp_raw_from_mdeg(high_mdeg - hyst_mdeg);
+    alarm_cb = cb;
+    alarm_state = ADC_ALARM_NORMAL; // Si ya está fuera, la siguiente conversión lo avisa
+
+    adc_alarm_window(ADC_AWD_TEMP, alarm_low, alarm_high);
+    ADC_IER |= ADC_IER_AWDIE;
+    NVIC_ISER = (1U << ADC_IRQn);
+    irq_restore(primask);
+
+    return 1;
+}
+
+/**
+ * @brief Desactiva la alarma de temperatura
+ *
+ * @return Ninguno
+ */
+void adc_temp_alarm_off(void)
+{
+    uint32_t primask = irq_save();
+
+    ADC_IER &= ~ADC_IER_AWDIE;
+    NVIC_ICER = (1U << ADC_IRQn);
+    if (!scan_busy)
+    {
+        adc_alarm_window(0, 0, 0xFFF); // Con un barrido en curso AWDEN queda activo, sin interrupción
+    }
+    alarm_state = ADC_ALARM_OFF;
+    alarm_cb = 0;
+    irq_restore(primask);
+}
+
+/**
+ * @brief Devuelve el estado de la alarma de temperatura
+ *
+ * @return ADC_ALARM_OFF si no está activa, o el último estado avisado
+ */
+adc_alarm_t adc_temp_alarm_state(void)
+{
+    return alarm_state;
+}
+
+/**
+ * @brief Atiende el aviso del watchdog analógico
+ *
+ * @details Desde ADC_ALARM_NORMAL la última muestra del sensor (ya copiada por el DMA)
+ *          indica qué umbral se ha cruzado; desde ADC_ALARM_HIGH o ADC_ALARM_LOW el
+ *          aviso significa que se ha vuelto dentro de la histéresis. Si desde la
+ *          ventana de vuelta la temperatura cae directamente fuera del otro umbral, la
+ *          conversión siguiente lo avisa de nuevo.
+ *
+ * @return Ninguno
+ */
+static void adc_alarm_irq(void)
+{
+    uint16_t raw;
+    adc_alarm_t next;
+
+    ADC_ISR = ADC_ISR_AWD;
+
+    if (alarm_state == ADC_ALARM_OFF || adc_mode == ADC_MODE_SCAN)
+    {
+        return; // Durante un barrido la muestra no está disponible: se repite en modo continuo
+    }
+
+    if (alarm_state != ADC_ALARM_NORMAL)
+    {
+        next = ADC_ALARM_NORMAL;
+        adc_alarm_window(ADC_AWD_TEMP, alarm_low, alarm_high);
+    }
+    else
+    {
+        raw = adc_last_sample();
+        if (raw > alarm_high)
+        {
+            next = ADC_ALARM_HIGH;
+            adc_alarm_window(ADC_AWD_TEMP, alarm_high_clear, 0xFFF);
+        }
+        else if (raw < alarm_low)
+        {
+            next = ADC_ALARM_LOW;
+            adc_alarm_window(ADC_AWD_TEMP, 0, alarm_low_clear);
+        }
+        else
+        {
+            return; // Muestra ya dentro de la ventana: nada que avisar
+        }
+    }
+
+    alarm_state = next;
+    if (alarm_cb)
+    {
+        alarm_cb(next);
+    }
+}
+
+/**
+ * @brief Manejador de interrupciones del ADC (watchdog analógico)
+ *
+ * @note Definida en el startup del microcontrolador
+ * @return Ninguno
+ */
+RAMFUNC void ADC_IRQHandler(void)
+{
+    PROF_START(PROF_ISR_ADC);
+    adc_alarm_irq();
+    PROF_END(PROF_ISR_ADC);
 }
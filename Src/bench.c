@@ -0,0 +1,336 @@
+/**
+ * @file bench.c
+ * @brief Batería fija de micro-benchmarks en la placa
+ * @details Solo se compila con BENCH_BUILD definido: es una configuración de compilación
+ *          aparte de la del firmware, en la que main() ejecuta bench_run() una vez tras
+ *          la inicialización y continúa después con normalidad.
+ *          Cada benchmark repite su operación 2^ops_log2 veces por medida (así el paso a
+ *          ciclos por operación es un desplazamiento: el Cortex-M0 no divide) y toma
+ *          BENCH_RUNS medidas con timestamp_cycles(). A cada medida se le resta el coste
+ *          del bucle, de la llamada indirecta y de las dos lecturas del contador, medido
+ *          con una operación vacía y el mismo ops_log2 (con pocas operaciones por medida
+ *          las lecturas pesan más por operación), y se informa del mínimo, la mediana y
+ *          el máximo en ciclos por operación.
+ *          La UART se vacía antes de cada medida para que su ISR no interfiera; la del
+ *          SysTick sigue activa, por lo que el máximo puede incluir algún tick.
+ *          Formato de salida (una línea CSV por resultado, prefijo BENCH):
+ *              BENCH,clock,<Hz>
+ *              BENCH,baud,<baudios>
+ *              BENCH,overhead,<ops_log2>,<ciclos>     (una por cada ops_log2 de 0 a 4)
+ *              BENCH,name,min,median,max
+ *              BENCH,<nombre>,<min>,<mediana>,<max>
+ *              ...
+ *              BENCH,end
+ */
+
+#include "bench.h"
+
+#ifdef BENCH_BUILD
+
+#include <stdio.h>
+#include "system.h"
+#include "adc.h"
+#include "fmt.h"
+#include "pwm.h"
+#include "ring_buffer.h"
+#include "scheduler.h"
+#include "uart.h"
+
+#define BENCH_RING_SIZE     16  // Tamaño del buffer circular del benchmark (potencia de 2)
+#define BENCH_OPS_LOG2_MAX  4   // Mayor ops_log2 de bench_table
+
+// Benchmark: operación a medir y preparación y limpieza fuera de la medida
+typedef struct
+{
+    const char *name;
+    void (*setup)(void);        // Antes de las medidas (opcional)
+    void (*op)(void);           // Operación medida
+    void (*teardown)(void);     // Después de las medidas (opcional)
+    uint8_t ops_log2;           // Operaciones por medida: 2^ops_log2 (hasta BENCH_OPS_LOG2_MAX)
+} bench_t;
+
+// Los resultados se escriben en variables volátiles para que el compilador no elimine las llamadas
+static volatile int32_t bench_sink;
+static volatile int32_t bench_value = -12345;
+static volatile uint16_t bench_raw = 1750;
+static volatile uint16_t bench_duty;
+
+static char bench_buf[16];
+static char bench_str[BENCH_UART_LEN + 1];
+static uint8_t bench_ring_storage[BENCH_RING_SIZE];
+static ring_buffer_t bench_ring;
+static int8_t bench_task = SCHED_NO_TASK;
+
+static void bench_nop(void)
+{
+}
+
+static void bench_get_temperature(void)
+{
+    bench_sink = get_temperature();
+}
+
+static void bench_get_temperature_mdeg(void)
+{
+    bench_sink = get_temperature_mdeg();
+}
+
+static void bench_temp_from_raw(void)
+{
+    bench_sink = adc_temp_mdeg_from_raw(bench_raw);
+}
+
+static void bench_fmt_format(void)
+{
+    bench_sink = fmt_format(bench_buf, sizeof(bench_buf), "%d", bench_value);
+}
+
+static void bench_fmt_i32(void)
+{
+    bench_sink = fmt_i32(bench_buf, bench_value);
+}
+
+#ifndef HEAP_DISABLE
+// snprintf de newlib puede reservar memoria con _sbrk, que no existe con HEAP_DISABLE
+static void bench_snprintf(void)
+{
+    bench_sink = snprintf(bench_buf, sizeof(bench_buf), "%d", (int)bench_value);
+}
+#endif // HEAP_DISABLE
+
+static void bench_ring_setup(void)
+{
+    ring_init(&bench_ring, bench_ring_storage, BENCH_RING_SIZE);
+}
+
+static void bench_ring_push_pop(void)
+{
+    uint8_t data;
+
+    ring_push(&bench_ring, (uint8_t)bench_value);
+    ring_pop(&bench_ring, &data);
+    bench_sink = data;
+}
+
+static void bench_uart_irq_setup(void)
+{
+    uart_flush();
+    uart_set_mode(UART_MODE_IRQ);
+}
+
+static void bench_uart_dma_setup(void)
+{
+    uart_flush();
+    uart_set_mode(UART_MODE_DMA);
+}
+
+static void bench_uart_teardown(void)
+{
+    uart_flush();
+    uart_set_mode(UART_MODE_IRQ);
+}
+
+// Solo la copia al buffer de transmisión: dos cadenas por medida caben en UART_TX_BUF_SIZE
+static void bench_uart_enqueue(void)
+{
+    uart_send_string(bench_str);
+}
+
+// Copia y envío completo a la velocidad actual
+static void bench_uart_send(void)
+{
+    uart_send_string(bench_str);
+    uart_flush();
+}
+
+static void bench_pwm_set_duty(void)
+{
+    pwm_set_duty(PWM_TIM2, 1, bench_duty++);
+}
+
+static void bench_pwm_set_duties(void)
+{
+    uint16_t duty[PWM_CHANNELS];
+
+    for (uint8_t ch = 0; ch < PWM_CHANNELS; ch++)
+    {
+        duty[ch] = bench_duty;
+    }
+    bench_duty++;
+    pwm_set_duties(PWM_TIM2, duty, (1U << PWM_CHANNELS) - 1U);
+}
+
+static void bench_sched_setup(void)
+{
+    bench_task = sched_add_oneshot(bench_nop, 1000);
+}
+
+// Activación y despacho de una tarea vacía
+static void bench_sched_dispatch(void)
+{
+    sched_start(bench_task, 0);
+    bench_sink = (int32_t)sched_dispatch();
+}
+
+static void bench_sched_teardown(void)
+{
+    sched_remove(bench_task);
+    bench_task = SCHED_NO_TASK;
+}
+
+static const bench_t bench_table[] =
+{
+    { "get_temperature",        0,                      bench_get_temperature,      0,                      2 },
+    { "get_temperature_mdeg",   0,                      bench_get_temperature_mdeg, 0,                      2 },
+    { "temp_mdeg_from_raw",     0,                      bench_temp_from_raw,        0,                      4 },
+    { "fmt_format_d",           0,                      bench_fmt_format,           0,                      4 },
+    { "fmt_i32",                0,                      bench_fmt_i32,              0,                      4 },
+#ifndef HEAP_DISABLE
+    { "snprintf_d",             0,                      bench_snprintf,             0,                      4 },
+#endif
+    { "ring_push_pop",          bench_ring_setup,       bench_ring_push_pop,        0,                      4 },
+    { "uart_enqueue_irq",       bench_uart_irq_setup,   bench_uart_enqueue,         bench_uart_teardown,    1 },
+    { "uart_enqueue_dma",       bench_uart_dma_setup,   bench_uart_enqueue,         bench_uart_teardown,    1 },
+    { "uart_send_irq",          bench_uart_irq_setup,   bench_uart_send,            bench_uart_teardown,    0 },
+    { "uart_send_dma",          bench_uart_dma_setup,   bench_uart_send,            bench_uart_teardown,    0 },
+    { "pwm_set_duty",           0,                      bench_pwm_set_duty,         0,                      4 },
+    { "pwm_set_duties",         0,                      bench_pwm_set_duties,       0,                      4 },
+    { "sched_dispatch",         bench_sched_setup,      bench_sched_dispatch,       bench_sched_teardown,   4 },
+};
+
+#define BENCH_COUNT     (sizeof(bench_table) / sizeof(bench_table[0]))
+
+/**
+ * @brief Toma una medida de un benchmark
+ *
+ * @param op Operación
+ * @param ops_log2 Operaciones por medida: 2^ops_log2
+ *
+ * @return Ciclos por operación, incluido el coste del bucle
+ */
+static uint32_t bench_sample(void (*op)(void), uint8_t ops_log2)
+{
+    uint32_t n = 1UL << ops_log2;
+    uint32_t t0;
+
+    uart_flush();
+
+    t0 = timestamp_cycles();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        op();
+    }
+
+    return (timestamp_cycles() - t0) >> ops_log2;
+}
+
+/**
+ * @brief Ordena las medidas de menor a mayor
+ *
+ * @details Inserción: BENCH_RUNS es pequeño.
+ *
+ * @return Ninguno
+ */
+static void bench_sort(uint32_t *v, uint8_t n)
+{
+    for (uint8_t i = 1; i < n; i++)
+    {
+        uint32_t x = v[i];
+        uint8_t j = i;
+
+        while (j > 0 && v[j - 1] > x)
+        {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = x;
+    }
+}
+
+/**
+ * @brief Mide un benchmark y ordena sus medidas
+ *
+ * @param b Benchmark
+ * @param overhead Ciclos por operación a descontar de cada medida
+ * @param samples Destino de las BENCH_RUNS medidas, ordenadas
+ *
+ * @return Ninguno
+ */
+static void bench_measure(const bench_t *b, uint32_t overhead, uint32_t *samples)
+{
+    if (b->setup)
+    {
+        b->setup();
+    }
+
+    for (uint8_t r = 0; r < BENCH_RUNS; r++)
+    {
+        uint32_t cycles = bench_sample(b->op, b->ops_log2);
+
+        samples[r] = (cycles > overhead) ? cycles - overhead : 0;
+    }
+
+    if (b->teardown)
+    {
+        b->teardown();
+    }
+
+    bench_sort(samples, BENCH_RUNS);
+}
+
+/**
+ * @brief Ejecuta la batería de benchmarks y envía los resultados por la UART
+ *
+ * @details Espera a que el ADC termine su arranque para que los benchmarks de
+ *          temperatura midan conversiones reales. Deja la UART en modo IRQ.
+ *
+ * @return Ninguno
+ */
+void bench_run(void)
+{
+    char line[64]; // Buffer para formatear mensajes de salida
+    uint32_t samples[BENCH_RUNS];
+    uint32_t overhead[BENCH_OPS_LOG2_MAX + 1]; // Coste del bucle por operación según ops_log2
+
+    for (uint8_t i = 0; i < BENCH_UART_LEN; i++)
+    {
+        bench_str[i] = 'a' + (i & 0x0F);
+    }
+    bench_str[BENCH_UART_LEN] = '\0';
+
+    while (!adc_ready())
+    {
+    }
+
+    fmt_format(line, sizeof(line), "BENCH,clock,%u\r\nBENCH,baud,%u\r\n", system_core_clock, uart_get_baud());
+    uart_send_string(line);
+
+    // El coste del bucle y de la llamada se mide igual que el resto y se toma su mínimo
+    for (uint8_t k = 0; k <= BENCH_OPS_LOG2_MAX; k++)
+    {
+        for (uint8_t r = 0; r < BENCH_RUNS; r++)
+        {
+            samples[r] = bench_sample(bench_nop, k);
+        }
+        bench_sort(samples, BENCH_RUNS);
+        overhead[k] = samples[0];
+
+        fmt_format(line, sizeof(line), "BENCH,overhead,%u,%u\r\n", k, overhead[k]);
+        uart_send_string(line);
+    }
+    uart_send_string("BENCH,name,min,median,max\r\n");
+
+    for (uint8_t i = 0; i < BENCH_COUNT; i++)
+    {
+        bench_measure(&bench_table[i], overhead[bench_table[i].ops_log2], samples);
+
+        fmt_format(line, sizeof(line), "BENCH,%s,%u,%u,%u\r\n", bench_table[i].name,
+                   samples[0], samples[BENCH_RUNS / 2], samples[BENCH_RUNS - 1]);
+        uart_send_string(line);
+    }
+
+    uart_send_string("BENCH,end\r\n");
+    uart_flush();
+}
+
+#endif // BENCH_BUILD
@@ -0,0 +1,293 @@
+/**
+ * @file cmd.c
+ * @brief Intérprete de comandos por líneas guiado por tabla
+ * @details Los caracteres recibidos se acumulan (con eco y borrado) en un buffer de
+ *          línea; al recibir CR o LF la línea se divide en comandos separados por
+ *          CMD_SEPARATOR y cada uno se busca en la tabla registrada con cmd_init().
+ *          Un comando es un nombre de letras seguido de hasta CMD_MAX_ARGS números
+ *          decimales separados por espacios o comas; el primero puede ir pegado al
+ *          nombre ("L50", "L 50" y "l50" son equivalentes). Los argumentos se validan
+ *          contra la especificación de la entrada antes de llamar a su función.
+ *          cmd_poll() solo consume los caracteres ya recibidos, por lo que nunca
+ *          bloquea el bucle principal esperando a que lleguen más.
+ */
+
+#include "cmd.h"
+#include "uart.h"
+#include "fmt.h"
+
+static const cmd_entry_t *cmd_table = 0;    // Tabla de comandos registrada
+static uint8_t cmd_count = 0;               // Número de entradas de la tabla
+static char cmd_line[CMD_LINE_MAX];         // Línea en edición
+static uint8_t cmd_len = 0;                 // Caracteres en cmd_line
+static uint8_t cmd_overflow = 0;            // La línea actual superó CMD_LINE_MAX
+static char cmd_last = 0;                   // Último carácter recibido (para CR+LF)
+
+static uint8_t cmd_is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static uint8_t cmd_is_alpha(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+}
+
+static char cmd_upper(char c)
+{
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+/**
+ * @brief Busca un comando en la tabla
+ *
+ * @param name Nombre recibido (sin terminador)
+ * @param len Longitud del nombre
+ *
+ * @return Entrada de la tabla o 0 si no existe
+ */
+static const cmd_entry_t *cmd_lookup(const char *name, uint8_t len)
+{
+    for (uint8_t i = 0; i < cmd_count; i++)
+    {
+        const char *n = cmd_table[i].name;
+        uint8_t k = 0;
+
+        while (k < len && n[k] == cmd_upper(name[k]))
+        {
+            k++;
+        }
+
+        if (k == len && n[k] == '\0')
+        {
+            return &cmd_table[i];
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Informa de argumentos no válidos para un comando
+ *
+ * @param cmd Comando
+ *
+ * @return Ninguno
+ */
+static void cmd_usage_error(const cmd_entry_t *cmd)
+{
+    char buffer[48]; // Buffer para formatear mensajes de salida
+
+    fmt_format(buffer, sizeof(buffer), "Usage: %s%s\r\n", cmd->name, cmd->usage);
+    uart_send_string(buffer);
+}
+
+/**
+ * @brief Analiza y ejecuta un comando de la línea
+ *
+ * @param s Comienzo del comando dentro de la línea
+ * @param len Longitud hasta el separador o el final de la línea
+ *
+ * @return Ninguno
+ */
+static void cmd_execute(const char *s, uint8_t len)
+{
+    uint32_t argv[CMD_MAX_ARGS];
+    uint8_t argc = 0;
+    uint8_t i = 0;
+    uint8_t name_start;
+    const cmd_entry_t *cmd;
+
+    while (i < len && s[i] == ' ')
+    {
+        i++;
+    }
+    if (i == len)
+    {
+        return; // Comando vacío (p.ej. ";;" o una línea en blanco)
+    }
+
+    name_start = i;
+    while (i < len && cmd_is_alpha(s[i]))
+    {
+        i++;
+    }
+
+    cmd = (i > name_start) ? cmd_lookup(&s[name_start], i - name_start) : 0;
+    if (cmd == 0)
+    {
+        uart_send_string("Unknown command, H for help\r\n");
+        return;
+    }
+
+    while (i < len)
+    {
+        uint32_t value = 0;
+        uint8_t digits = 0;
+
+        if (s[i] == ' ' || s[i] == ',')
+        {
+            i++;
+            continue;
+        }
+
+        if (!cmd_is_digit(s[i]) || argc == cmd->max_args)
+        {
+            cmd_usage_error(cmd);
+            return;
+        }
+
+        // Sin división: el número de dígitos acota el valor por debajo de 2^32
+        while (i < len && cmd_is_digit(s[i]))
+        {
+            if (++digits > CMD_MAX_DIGITS)
+            {
+                cmd_usage_error(cmd);
+                return;
+            }
+            value = value * 10 + (uint32_t)(s[i++] - '0');
+        }
+
+        if (value > cmd->max_value)
+        {
+            cmd_usage_error(cmd);
+            return;
+        }
+        argv[argc++] = value;
+    }
+
+    if (argc < cmd->min_args)
+    {
+        cmd_usage_error(cmd);
+        return;
+    }
+
+    cmd->handler(argc, argv);
+}
+
+/**
+ * @brief Ejecuta en orden los comandos de la línea completa
+ *
+ * @return Ninguno
+ */
+static void cmd_run_line(void)
+{
+    uint8_t start = 0;
+
+    for (uint8_t i = 0; i <= cmd_len; i++)
+    {
+        if (i == cmd_len || cmd_line[i] == CMD_SEPARATOR)
+        {
+            cmd_execute(&cmd_line[start], i - start);
+            start = i + 1;
+        }
+    }
+}
+
+/**
+ * @brief Registra la tabla de comandos
+ *
+ * @param table Tabla de comandos (debe permanecer válida, normalmente const en Flash)
+ * @param count Número de entradas
+ *
+ * @return Ninguno
+ */
+void cmd_init(const cmd_entry_t *table, uint8_t count)
+{
+    cmd_table = table;
+    cmd_count = count;
+    cmd_len = 0;
+    cmd_overflow = 0;
+    cmd_last = 0;
+}
+
+/**
+ * @brief Procesa un carácter recibido
+ *
+ * @details Los caracteres imprimibles se añaden a la línea con eco; retroceso (BS o
+ *          DEL) borra el último. CR, LF o CR+LF terminan la línea y ejecutan sus
+ *          comandos. Una línea de más de CMD_LINE_MAX caracteres se descarta entera.
+ *
+ * @param c Carácter recibido
+ *
+ * @return Ninguno
+ */
+void cmd_feed(char c)
+{
+    char prev = cmd_last;
+
+    cmd_last = c;
+
+    if (c == '\r' || c == '\n')
+    {
+        if (c == '\n' && prev == '\r')
+        {
+            return; // LF de un final de línea CR+LF
+        }
+
+        uart_send_string("\r\n");
+        if (cmd_overflow)
+        {
+            uart_send_string("Line too long\r\n");
+        }
+        else
+        {
+            cmd_run_line();
+        }
+
+        cmd_len = 0;
+        cmd_overflow = 0;
+    }
+    else if (c == '\b' || c == 0x7F)
+    {
+        if (cmd_len > 0 && !cmd_overflow)
+        {
+            cmd_len--;
+            uart_send_string("\b \b");
+        }
+    }
+    else if (c >= ' ' && c <= '~')
+    {
+        if (cmd_len == CMD_LINE_MAX)
+        {
+            cmd_overflow = 1;
+            return;
+        }
+
+        cmd_line[cmd_len++] = c;
+        uart_send_char(c);
+    }
+}
+
+/**
+ * @brief Consume los caracteres recibidos por la UART
+ *
+ * @details No espera a que lleguen más: si la línea no está completa se conserva
+ *          hasta la siguiente llamada.
+ *
+ * @return Ninguno
+ */
+void cmd_poll(void)
+{
+    while (uart_data_available())
+    {
+        cmd_feed(uart_receive_char());
+    }
+}
+
+/**
+ * @brief Envía por UART la lista de comandos de la tabla
+ *
+ * @return Ninguno
+ */
+void cmd_print_help(void)
+{
+    char buffer[64]; // Buffer para formatear mensajes de salida
+
+    for (uint8_t i = 0; i < cmd_count; i++)
+    {
+        fmt_format(buffer, sizeof(buffer), "%s%s - %s\r\n",
+                   cmd_table[i].name, cmd_table[i].usage, cmd_table[i].help);
+        uart_send_string(buffer);
+    }
+}
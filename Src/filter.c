@@ -0,0 +1,161 @@
+/**
+ * @file filter.c
+ * @brief Implementación de filtros incrementales para muestras del ADC
+ * @details Cada filtro sobremuestrea y diezma: acumula 4^k muestras y entrega su suma
+ *          desplazada k bits, lo que añade k bits efectivos de resolución sin alargar
+ *          el tiempo de muestreo del ADC. La salida diezmada puede pasar además por una
+ *          media móvil de 2^n salidas o por un paso bajo IIR de un polo.
+ *          Todas las etapas se actualizan en O(1) por muestra (sumas acumuladas y
+ *          desplazamientos, sin divisiones ni bucles de re-suma), por lo que pueden
+ *          alimentarse desde la ISR del DMA.
+ */
+
+#include "filter.h"
+
+/**
+ * @brief Configura un filtro y descarta su estado anterior
+ *
+ * @param f Filtro a configurar
+ * @param os_bits Bits extra por sobremuestreo (0 a FILTER_OS_MAX_BITS): 4^os_bits
+ *                muestras por salida
+ * @param mode Etapa posterior al diezmado
+ * @param shift Media móvil: log2 del tamaño de la ventana. IIR: constante de tiempo en
+ *              salidas (2^shift). Se ignora con FILTER_NONE
+ * @param window Memoria de 2^shift posiciones para la media móvil (0 en otro caso)
+ *
+ * @return 1 si la configuración es válida, 0 si no
+ */
+uint8_t filter_init(filter_t *f, uint8_t os_bits, filter_mode_t mode, uint8_t shift, uint16_t *window)
+{
+    if (os_bits > FILTER_OS_MAX_BITS || mode > FILTER_IIR || shift > FILTER_MAX_SHIFT
+        || (mode == FILTER_MOVING_AVG && window == 0))
+    {
+        return 0;
+    }
+
+    f->os_bits = os_bits;
+    f->os_len = (uint16_t)(1U << (2 * os_bits));
+    f->mode = mode;
+    f->shift = (mode == FILTER_NONE) ? 0 : shift;
+    f->window = window;
+    filter_reset(f);
+
+    return 1;
+}
+
+/**
+ * @brief Vacía el filtro manteniendo su configuración
+ *
+ * @return Ninguno
+ */
+void filter_reset(filter_t *f)
+{
+    f->ready = 0;
+    f->os_acc = 0;
+    f->os_count = 0;
+    f->index = 0;
+    f->acc = 0;
+    f->out = 0;
+}
+
+/**
+ * @brief Arranca la etapa posterior con la primera salida diezmada
+ *
+ * @details Rellenar la ventana con el primer valor evita dividir por el número de
+ *          salidas acumuladas mientras se llena. Es el único bucle del filtro y se
+ *          ejecuta una sola vez tras filter_init() o filter_reset().
+ *
+ * @param f Filtro
+ * @param x Primera salida del sobremuestreo
+ *
+ * @return Ninguno
+ */
+static void filter_prime(filter_t *f, uint16_t x)
+{
+    if (f->mode == FILTER_MOVING_AVG)
+    {
+        for (uint16_t i = 0; i < (1U << f->shift); i++)
+        {
+            f->window[i] = x;
+        }
+    }
+
+    f->acc = (uint32_t)x << f->shift;
+    f->out = x;
+    f->ready = 1;
+}
+
+/**
+ * @brief Añade una muestra al filtro
+ *
+ * @details Coste constante: una suma por muestra y, al cerrar cada bloque de
+ *          sobremuestreo, una suma y una resta (media móvil) o una resta y un
+ *          desplazamiento (IIR).
+ *
+ * @param f Filtro
+ * @param sample Muestra de 12 bits del ADC
+ *
+ * @return 1 si se ha generado una nueva salida, 0 si el bloque de sobremuestreo
+ *         aún no está completo
+ */
+uint8_t filter_push(filter_t *f, uint16_t sample)
+{
+    uint16_t x;
+
+    f->os_acc += sample;
+    if (++f->os_count < f->os_len)
+    {
+        return 0;
+    }
+
+    x = (uint16_t)(f->os_acc >> f->os_bits); // Suma de 4^k muestras / 2^k = 12 + k bits
+    f->os_acc = 0;
+    f->os_count = 0;
+
+    if (!f->ready)
+    {
+        filter_prime(f, x);
+        return 1;
+    }
+
+    switch (f->mode)
+    {
+        case FILTER_MOVING_AVG:
+            f->acc += (uint32_t)x - f->window[f->index]; // Entra la nueva, sale la más antigua
+            f->window[f->index] = x;
+            f->index = (f->index + 1) & ((1U << f->shift) - 1);
+            f->out = (uint16_t)(f->acc >> f->shift);
+            break;
+
+        case FILTER_IIR:
+            f->acc = f->acc - (f->acc >> f->shift) + x;  // acc = y * 2^shift
+            f->out = (uint16_t)(f->acc >> f->shift);
+            break;
+
+        default:
+            f->out = x;
+            break;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Devuelve la última salida del filtro
+ *
+ * @return Valor filtrado en cuentas de 12 + os_bits bits (0 hasta la primera salida)
+ */
+uint16_t filter_output(const filter_t *f)
+{
+    return f->out;
+}
+
+/**
+ * @brief Indica si el filtro ha generado ya alguna salida
+ *
+ * @return 1 si filter_output() es válido, 0 si no
+ */
+uint8_t filter_ready(const filter_t *f)
+{
+    return f->ready;
+}
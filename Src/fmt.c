@@ -0,0 +1,257 @@
+/**
+ * @file fmt.c
+ * @brief Formateo ligero de enteros y cadenas sin newlib
+ * @details Sustituye a sprintf para los mensajes de la aplicación: convierte enteros
+ *          a decimal, hexadecimal o punto fijo en un buffer del llamador, sin memoria
+ *          dinámica ni soporte de coma flotante. La conversión a decimal resta
+ *          potencias de 10 de una tabla en lugar de dividir, ya que el Cortex-M0 no
+ *          tiene divisor hardware.
+ *          Ninguna función escribe el terminador nulo salvo fmt_format().
+ */
+
+#include <stdarg.h>
+#include "fmt.h"
+
+// Potencias de 10 representables en 32 bits, de mayor a menor
+static const uint32_t fmt_pow10[FMT_U32_MAX_LEN] =
+{
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+static const char fmt_hex_digits[] = "0123456789abcdef";
+
+/**
+ * @brief Escribe un entero sin signo en decimal
+ *
+ * @details Cada dígito se obtiene restando la potencia de 10 correspondiente
+ *          (como máximo 9 restas por dígito).
+ *
+ * @param buf Destino (al menos FMT_U32_MAX_LEN bytes)
+ * @param value Valor a convertir
+ *
+ * @return Número de caracteres escritos
+ */
+uint8_t fmt_u32(char *buf, uint32_t value)
+{
+    uint8_t len = 0;
+
+    for (uint8_t i = 0; i < FMT_U32_MAX_LEN; i++)
+    {
+        uint32_t p = fmt_pow10[i];
+        char digit = '0';
+
+        while (value >= p)
+        {
+            value -= p;
+            digit++;
+        }
+
+        if (digit != '0' || len || i == FMT_U32_MAX_LEN - 1) // Sin ceros a la izquierda
+        {
+            buf[len++] = digit;
+        }
+    }
+
+    return len;
+}
+
+/**
+ * @brief Escribe un entero con signo en decimal
+ *
+ * @param buf Destino (al menos FMT_I32_MAX_LEN bytes)
+ * @param value Valor a convertir
+ *
+ * @return Número de caracteres escritos
+ */
+uint8_t fmt_i32(char *buf, int32_t value)
+{
+    if (value < 0)
+    {
+        buf[0] = '-';
+        return 1 + fmt_u32(buf + 1, 0U - (uint32_t)value); // Válido también para INT32_MIN
+    }
+
+    return fmt_u32(buf, (uint32_t)value);
+}
+
+/**
+ * @brief Escribe un entero en hexadecimal (minúsculas, sin prefijo)
+ *
+ * @param buf Destino (al menos 8 bytes)
+ * @param value Valor a convertir
+ * @param digits Número mínimo de dígitos, rellenando con ceros (0 = solo los necesarios)
+ *
+ * @return Número de caracteres escritos
+ */
+uint8_t fmt_hex(char *buf, uint32_t value, uint8_t digits)
+{
+    uint8_t len = 0;
+
+    for (int8_t shift = 28; shift >= 0; shift -= 4)
+    {
+        uint8_t nibble = (value >> shift) & 0x0F;
+
+        if (nibble || len || shift == 0 || (shift / 4) < digits)
+        {
+            buf[len++] = fmt_hex_digits[nibble];
+        }
+    }
+
+    return len;
+}
+
+/**
+ * @brief Escribe un valor en punto fijo decimal
+ *
+ * @details p.ej. value = -1250 con decimals = 3 escribe "-1.250". Útil para
+ *          mostrar milésimas de grado o milivoltios sin coma flotante.
+ *
+ * @param buf Destino (al menos FMT_I32_MAX_LEN + 2 bytes)
+ * @param value Valor escalado por 10^decimals
+ * @param decimals Número de decimales (0 a 9)
+ *
+ * @return Número de caracteres escritos
+ */
+uint8_t fmt_fixed(char *buf, int32_t value, uint8_t decimals)
+{
+    char digits[FMT_U32_MAX_LEN];
+    uint8_t ndigits, len = 0;
+    uint32_t mag = (value < 0) ? 0U - (uint32_t)value : (uint32_t)value;
+
+    if (decimals == 0 || decimals >= FMT_U32_MAX_LEN)
+    {
+        return fmt_i32(buf, value);
+    }
+
+    if (value < 0)
+    {
+        buf[len++] = '-';
+    }
+
+    ndigits = fmt_u32(digits, mag);
+
+    // Parte entera (al menos un 0)
+    if (ndigits > decimals)
+    {
+        for (uint8_t i = 0; i < ndigits - decimals; i++)
+        {
+            buf[len++] = digits[i];
+        }
+    }
+    else
+    {
+        buf[len++] = '0';
+    }
+
+    buf[len++] = '.';
+
+    // Parte decimal con ceros a la izquierda
+    for (uint8_t i = decimals; i > 0; i--)
+    {
+        buf[len++] = (i > ndigits) ? '0' : digits[ndigits - i];
+    }
+
+    return len;
+}
+
+/**
+ * @brief Formateador mínimo compatible con un subconjunto de printf
+ *
+ * @details Especificadores admitidos: %d, %i, %u, %x, %s, %c y %%, con un ancho
+ *          opcional de un dígito y relleno con ceros ("%02u", "%08x"). El
+ *          modificador 'l' se acepta y se ignora (int y long son de 32 bits).
+ *          La salida se trunca a size - 1 caracteres y siempre termina en nulo.
+ *
+ * @param buf Destino
+ * @param size Tamaño del destino en bytes (mayor que 0)
+ * @param fmt Cadena de formato
+ *
+ * @return Número de caracteres escritos (sin el terminador)
+ */
+uint16_t fmt_format(char *buf, uint16_t size, const char *fmt, ...)
+{
+    va_list args;
+    uint16_t len = 0;
+
+    va_start(args, fmt);
+
+    while (*fmt && len < size - 1)
+    {
+        char tmp[FMT_I32_MAX_LEN];
+        const char *src = tmp;
+        uint16_t n = 0;
+        uint8_t width = 0;
+        char pad = ' ';
+
+        if (*fmt != '%')
+        {
+            buf[len++] = *fmt++;
+            continue;
+        }
+
+        fmt++;
+        if (*fmt == '0')
+        {
+            pad = '0';
+            fmt++;
+        }
+        if (*fmt >= '1' && *fmt <= '9')
+        {
+            width = (uint8_t)(*fmt++ - '0');
+        }
+        if (*fmt == 'l')
+        {
+            fmt++;
+        }
+
+        switch (*fmt)
+        {
+            case 'd':
+            case 'i':
+                n = fmt_i32(tmp, va_arg(args, int32_t));
+                break;
+            case 'u':
+                n = fmt_u32(tmp, va_arg(args, uint32_t));
+                break;
+            case 'x':
+                n = fmt_hex(tmp, va_arg(args, uint32_t), 0);
+                break;
+            case 'c':
+                tmp[0] = (char)va_arg(args, int);
+                n = 1;
+                break;
+            case 's':
+                src = va_arg(args, const char *);
+                while (src[n])
+                {
+                    n++;
+                }
+                break;
+            case '%':
+                tmp[0] = '%';
+                n = 1;
+                break;
+            default:
+                va_end(args);
+                buf[len] = '\0';
+                return len;     // Especificador no admitido o fin de cadena
+        }
+        fmt++;
+
+        while (width > n && len < size - 1)
+        {
+            buf[len++] = pad;
+            width--;
+        }
+        for (uint16_t i = 0; i < n && len < size - 1; i++)
+        {
+            buf[len++] = src[i];
+        }
+    }
+
+    va_end(args);
+    buf[len] = '\0';
+
+    return len;
+}
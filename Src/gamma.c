@@ -0,0 +1,23 @@
+/**
+ * @file gamma.c
+ * @brief Tabla de corrección de brillo del LED (luminosidad CIE 1976 L*)
+ * @details Generado por tools/gen_gamma.py: no editar a mano.
+ *          gamma_table[n] es el ciclo de trabajo de 16 bits (pwm_set_duty()) que
+ *          corresponde al nivel de brillo percibido n.
+ */
+
+#include "gamma.h"
+
+const uint16_t gamma_table[GAMMA_LEVELS] =
+{
+        0,    73,   147,   220,   293,   366,   440,   513,   586,   663,   // 0-9
+      747,   837,   934,  1038,  1150,  1269,  1397,  1533,  1677,  1830,   // 10-19
+     1992,  2163,  2344,  2535,  2736,  2947,  3169,  3402,  3646,  3901,   // 20-29
+     4168,  4447,  4738,  5041,  5357,  5686,  6028,  6384,  6753,  7137,   // 30-39
+     7534,  7946,  8373,  8815,  9272,  9745, 10233, 10737, 11258, 11796,   // 40-49
+    12350, 12921, 13510, 14116, 14740, 15383, 16043, 16723, 17421, 18138,   // 50-59
+    18875, 19632, 20408, 21205, 22022, 22860, 23719, 24599, 25500, 26424,   // 60-69
+    27369, 28337, 29327, 30340, 31376, 32436, 33519, 34626, 35757, 36912,   // 70-79
+    38092, 39297, 40527, 41782, 43063, 44370, 45703, 47063, 48449, 49863,   // 80-89
+    51303, 52771, 54267, 55790, 57342, 58923, 60532, 62170, 63838, 65535    // 90-99
+};
@@ -0,0 +1,153 @@
+/**
+ * @file led_seq.c
+ * @brief Reproducción de secuencias de brillo del LED desde RAM
+ * @details El host carga de una vez una lista de valores de brillo y el periodo
+ *          entre pasos; un temporizador periódico de la rueda (timer_wheel.c) aplica
+ *          un valor en cada vencimiento sin intervención del bucle principal. Así
+ *          una rampa de N pasos cuesta un único intercambio con el host en lugar de
+ *          N comandos L con su respuesta.
+ *          La carga se hace desde el bucle principal con el temporizador parado, por
+ *          lo que el buffer no necesita protección frente a la ISR.
+ */
+
+#include "led_seq.h"
+#include "pwm.h"
+#include "timer_wheel.h"
+
+static uint8_t seq_duty[LED_SEQ_MAX_STEPS];                 // Valores de brillo (0-99)
+static uint8_t seq_count = 0;                               // Valores cargados
+static volatile uint8_t seq_index = 0;                      // Próximo valor a aplicar
+static uint8_t seq_repeat = 0;                              // Volver al principio al terminar
+static volatile led_seq_state_t seq_state = LED_SEQ_DONE;
+static soft_timer_t seq_timer;                              // Marca el ritmo de los pasos
+
+/**
+ * @brief Aplica el siguiente paso de la secuencia
+ *
+ * @note Se ejecuta desde SysTick_Handler
+ * @return Ninguno
+ */
+static void led_seq_step(soft_timer_t *timer)
+{
+    set_led_brightness(seq_duty[seq_index]);
+
+    if (++seq_index < seq_count)
+    {
+        return;
+    }
+
+    if (seq_repeat)
+    {
+        seq_index = 0;
+    }
+    else
+    {
+        timer_cancel(timer); // Último paso aplicado: el brillo se mantiene
+        seq_state = LED_SEQ_DONE;
+    }
+}
+
+/**
+ * @brief Inicializa el reproductor de secuencias
+ *
+ * @return Ninguno
+ */
+void led_seq_init(void)
+{
+    timer_init(&seq_timer, led_seq_step);
+    seq_count = 0;
+    seq_index = 0;
+    seq_state = LED_SEQ_DONE;
+}
+
+/**
+ * @brief Añade valores de brillo a la secuencia en carga
+ *
+ * @details La primera llamada tras led_seq_start() o led_seq_stop() detiene la
+ *          reproducción y empieza una secuencia nueva, de forma que una carga puede
+ *          repartirse entre varios comandos antes de arrancarla.
+ *
+ * @param duty Valores de brillo de 0 a 99 (los mayores se limitan a 99)
+ * @param count Número de valores
+ *
+ * @return 1 si se han añadido todos, 0 si no caben (no se añade ninguno)
+ */
+uint8_t led_seq_append(const uint32_t *duty, uint8_t count)
+{
+    if (seq_state != LED_SEQ_LOADING)
+    {
+        led_seq_stop();
+        seq_count = 0;
+        seq_state = LED_SEQ_LOADING;
+    }
+
+    if (count > LED_SEQ_MAX_STEPS - seq_count)
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        seq_duty[seq_count++] = (duty[i] > 99) ? 99 : (uint8_t)duty[i];
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Arranca la reproducción de la secuencia cargada
+ *
+ * @details El primer paso se aplica al cabo de period_ms y los siguientes cada
+ *          period_ms. Al terminar (sin repetición) el LED conserva el último valor.
+ *
+ * @param period_ms Tiempo entre pasos en ms (1 a LED_SEQ_MAX_PERIOD)
+ * @param repeat 1 para repetir la secuencia indefinidamente
+ *
+ * @return 1 si ha arrancado, 0 si la secuencia está vacía o el periodo no es válido
+ */
+uint8_t led_seq_start(uint32_t period_ms, uint8_t repeat)
+{
+    if (seq_count == 0 || period_ms == 0 || period_ms > LED_SEQ_MAX_PERIOD)
+    {
+        return 0;
+    }
+
+    timer_cancel(&seq_timer);
+    seq_index = 0;
+    seq_repeat = repeat;
+    seq_state = LED_SEQ_PLAYING;
+    timer_arm(&seq_timer, period_ms, period_ms);
+
+    return 1;
+}
+
+/**
+ * @brief Detiene la reproducción, manteniendo el brillo actual
+ *
+ * @return Ninguno
+ */
+void led_seq_stop(void)
+{
+    timer_cancel(&seq_timer);
+    seq_state = LED_SEQ_DONE;
+}
+
+/**
+ * @brief Devuelve el número de valores de la secuencia
+ *
+ * @return Valores cargados
+ */
+uint8_t led_seq_length(void)
+{
+    return seq_count;
+}
+
+/**
+ * @brief Devuelve el estado de la secuencia
+ *
+ * @return Estado actual
+ */
+led_seq_state_t led_seq_state(void)
+{
+    return seq_state;
+}
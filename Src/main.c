@@ -4,140 +4,394 @@
  * @details Esta aplicación implementa un sistema de monitoreo de temperatura y control
  *          de brillo de LED mediante comunicación UART. Soporta comandos interactivos
  *          para activar/desactivar la lectura de temperatura y ajustar el brillo del LED.
+ *          Cada funcionalidad es una tarea independiente del planificador (scheduler.c),
+ *          por lo que ninguna espera bloquea a las demás.
  */
 
 #include <stdint.h>
-#include <stdio.h>
 #include "nucleo_conf.h"
 #include "system.h"
 #include "adc.h"
+#include "mempool.h"
+#include "memmap.h"
 #include "uart.h"
 #include "pwm.h"
+#include "scheduler.h"
+#include "prof.h"
+#include "fmt.h"
+#include "telemetry.h"
+#include "cmd.h"
+#include "led_seq.h"
+#include "bench.h"
+
+#define CMD_DEADLINE_MS     1       // Plazo para atender los caracteres recibidos
+#define TEMP_PERIOD_MS      1000    // Periodo del informe de temperatura
+#define ALARM_DEADLINE_MS   1       // Plazo para informar de un cambio de la alarma de temperatura
+#define ALARM_HYST_MDEG     2000    // Histéresis de la alarma de temperatura en m°C
+#define ALARM_LED_LIMIT     10      // Brillo máximo del LED mientras la temperatura supera la alarma
+#define TEMP_FILTER_OS_BITS 3       // Filtro del informe: 64 muestras por salida (+3 bits)...
+#define TEMP_FILTER_SHIFT   4       // ...y paso bajo IIR de 16 salidas
+
+static uint8_t temp_reading_active = 0; // Estado del monitoreo de temperatura (0=OFF, 1=ON)
+static uint8_t telemetry_binary = 0;    // Formato del informe de temperatura (0=texto, 1=tramas binarias)
+static int8_t cmd_task = SCHED_NO_TASK; // Tarea que procesa los caracteres recibidos
+static int8_t alarm_task = SCHED_NO_TASK; // Tarea que informa de los cambios de la alarma
+static volatile adc_alarm_t alarm_event = ADC_ALARM_OFF; // Último estado avisado por la ISR del ADC
+
+/**
+ * @brief Comando T: alterna el informe de temperatura
+ *
+ * @details El filtro del sensor solo funciona mientras hay informe: sus interrupciones
+ *          del DMA (unas 3500 por segundo) impedirían el reposo largo de system_sleep().
+ *
+ * @return Ninguno
+ */
+static void cmd_temperature(uint8_t argc, const uint32_t *argv)
+{
+    (void)argc;
+    (void)argv;
+
+    temp_reading_active = !temp_reading_active; // Conmutar el estado anterior ON-> OFF -> ON
+
+    if (temp_reading_active) // Motrar el mensaje segun el estado del flag
+    {
+        adc_temp_filter(TEMP_FILTER_OS_BITS, FILTER_IIR, TEMP_FILTER_SHIFT);
+        uart_send_string("Temperature reading ON\r\n");
+    }
+    else
+    {
+        adc_temp_filter(0, FILTER_NONE, 0); // Sin interrupciones del DMA en modo continuo
+        uart_send_string("Temperature reading OFF\r\n");
+    }
+}
+
+/**
+ * @brief Comando L: ajusta el brillo del LED
+ *
+ * @param argv argv[0] es el brillo de 0 a 99 (validado por el intérprete)
+ *
+ * @return Ninguno
+ */
+static void cmd_led(uint8_t argc, const uint32_t *argv)
+{
+    char buffer[32]; // Buffer para formatear mensajes de salida
+
+    (void)argc;
+
+    led_seq_stop(); // Un valor explícito sustituye a la secuencia en curso
+    set_led_brightness((uint8_t)argv[0]);
+
+    fmt_format(buffer, sizeof(buffer), "LED brightness set to %u%%\r\n", argv[0]);
+    uart_send_string(buffer);
+}
+
+/**
+ * @brief Comando Q: añade valores de brillo a la secuencia en carga (led_seq.c)
+ *
+ * @details No responde si los valores caben, para que una secuencia repartida en
+ *          varios comandos Q se confirme con una única respuesta del comando S.
+ *
+ * @param argc Número de valores
+ * @param argv Valores de brillo de 0 a 99
+ *
+ * @return Ninguno
+ */
+static void cmd_seq_queue(uint8_t argc, const uint32_t *argv)
+{
+    if (!led_seq_append(argv, argc))
+    {
+        uart_send_string("Sequence full\r\n");
+    }
+}
+
+/**
+ * @brief Comando S: reproduce la secuencia cargada o la detiene
+ *
+ * @param argc 1 o 2
+ * @param argv argv[0] es el periodo entre pasos en ms (0 = detener); argv[1], si
+ *             existe y no es 0, repite la secuencia indefinidamente
+ *
+ * @return Ninguno
+ */
+static void cmd_seq_start(uint8_t argc, const uint32_t *argv)
+{
+    char buffer[48]; // Buffer para formatear mensajes de salida
+    uint8_t repeat = (argc > 1 && argv[1]) ? 1 : 0;
+
+    if (argv[0] == 0)
+    {
+        led_seq_stop();
+        uart_send_string("Sequence stopped\r\n");
+    }
+    else if (led_seq_start(argv[0], repeat))
+    {
+        fmt_format(buffer, sizeof(buffer), "Sequence: %u steps every %u ms%s\r\n",
+                   (uint32_t)led_seq_length(), argv[0], repeat ? ", repeating" : "");
+        uart_send_string(buffer);
+    }
+    else
+    {
+        uart_send_string("Sequence empty, load it with Q\r\n");
+    }
+}
+
+/**
+ * @brief Comando B: alterna el informe entre texto y tramas binarias (telemetry.c)
+ *
+ * @return Ninguno
+ */
+static void cmd_binary(uint8_t argc, const uint32_t *argv)
+{
+    (void)argc;
+    (void)argv;
+
+    telemetry_binary = !telemetry_binary;
+
+    if (telemetry_binary)
+    {
+        uart_send_string("Binary telemetry ON\r\n");
+    }
+    else
+    {
+        uart_send_string("Binary telemetry OFF\r\n");
+    }
+}
+
+/**
+ * @brief Aviso de la alarma de temperatura
+ *
+ * @details Por encima del umbral el brillo del LED se limita a ALARM_LED_LIMIT en la
+ *          propia ISR, sin esperar al bucle principal; el mensaje lo envía task_alarm().
+ *
+ * @note Se ejecuta en la ISR del ADC
+ * @return Ninguno
+ */
+static void temp_alarm(adc_alarm_t state)
+{
+    alarm_event = state;
+    set_led_limit((state == ADC_ALARM_HIGH) ? ALARM_LED_LIMIT : 99);
+    sched_start(alarm_task, 0);
+}
+
+/**
+ * @brief Comando A: umbral de la alarma por temperatura alta
+ *
+ * @param argv argv[0] es el umbral en °C (0 = desactivar la alarma)
+ *
+ * @return Ninguno
+ */
+static void cmd_alarm(uint8_t argc, const uint32_t *argv)
+{
+    char buffer[40]; // Buffer para formatear mensajes de salida
+
+    (void)argc;
+
+    if (argv[0] == 0)
+    {
+        adc_temp_alarm_off();
+        set_led_limit(99);
+        uart_send_string("Temperature alarm OFF\r\n");
+    }
+    else if (adc_temp_alarm(-(int32_t)ADC_ALARM_MAX_MDEG, (int32_t)argv[0] * 1000, ALARM_HYST_MDEG, temp_alarm))
+    {
+        fmt_format(buffer, sizeof(buffer), "Temperature alarm at %u degC\r\n", argv[0]);
+        uart_send_string(buffer);
+    }
+    else
+    {
+        uart_send_string("ADC busy, try again\r\n");
+    }
+}
+
+#ifdef PROFILE_ENABLE
+/**
+ * @brief Comando P: vuelca las estadísticas de perfilado
+ *
+ * @return Ninguno
+ */
+static void cmd_profile(uint8_t argc, const uint32_t *argv)
+{
+    (void)argc;
+    (void)argv;
+
+    prof_dump();
+}
+#endif
+
+/**
+ * @brief Comando M: muestra el mapa de la RAM y el uso de la pila
+ *
+ * @return Ninguno
+ */
+static void cmd_memmap(uint8_t argc, const uint32_t *argv)
+{
+    (void)argc;
+    (void)argv;
+
+    memmap_dump();
+}
+
+/**
+ * @brief Comando H: muestra la lista de comandos
+ *
+ * @return Ninguno
+ */
+static void cmd_help(uint8_t argc, const uint32_t *argv)
+{
+    (void)argc;
+    (void)argv;
+
+    cmd_print_help();
+}
+
+// Tabla de comandos: nombre, sintaxis, ayuda, argumentos mínimo y máximo, valor máximo y función
+static const cmd_entry_t cmd_table[] =
+{
+    { "T", "",              "to toggle temperature reading",        0, 0,            0,                  cmd_temperature },
+    { "L", "<0-99>",        "to set LED brightness",                1, 1,            99,                 cmd_led },
+    { "Q", "<0-99>...",     "to queue LED sequence values",         1, CMD_MAX_ARGS, 99,                 cmd_seq_queue },
+    { "S", "<ms> [repeat]", "to play the LED sequence (0 stops)",   1, 2,            LED_SEQ_MAX_PERIOD, cmd_seq_start },
+    { "B", "",              "to toggle binary telemetry",           0, 0,            0,                  cmd_binary },
+    { "A", "<0-125>",       "to set the temp alarm (0 disables)",   1, 1,            125,                cmd_alarm },
+#ifdef PROFILE_ENABLE
+    { "P", "",              "to dump profiling statistics",         0, 0,            0,                  cmd_profile },
+#endif
+    { "M", "",              "to show the RAM map",                  0, 0,            0,                  cmd_memmap },
+    { "H", "",              "to show this help",                    0, 0,            0,                  cmd_help },
+};
+
+/**
+ * @brief Tarea de procesamiento de comandos recibidos por UART
+ *
+ * @details Se activa desde el bucle principal cuando hay datos recibidos y consume
+ *          todos los caracteres disponibles sin esperar a que lleguen más (cmd.c).
+ *          Cada línea puede contener varios comandos separados por ';', p.ej.
+ *          "T;L50;B".
+ *
+ * @return Ninguno
+ */
+static void task_commands(void)
+{
+    PROF_START(PROF_CMD_DISPATCH);
+
+    cmd_poll();
+
+    PROF_END(PROF_CMD_DISPATCH);
+}
+
+/**
+ * @brief Tarea periódica de informe de temperatura
+ *
+ * @details En modo binario envía una trama TLM_TYPE_TEMPERATURE (13 bytes con la
+ *          temperatura en m°C y VDD); en modo texto, la línea legible de depuración.
+ *
+ * @return Ninguno
+ */
+static void task_temperature(void)
+{
+    char buffer[32]; // Buffer para formatear mensajes de salida
+
+    if (!adc_ready())
+    {
+        return; // Primeros ms tras el arranque: sin lecturas válidas todavía
+    }
+
+    if (temp_reading_active && telemetry_binary)
+    {
+        tlm_send_temperature(get_temperature_mdeg(), (uint16_t)adc_get_vdd());
+    }
+    // Si la lectura de temperatura está activa, mostrar valor cada segundo
+    else if (temp_reading_active)
+    {
+        int32_t temperature = get_temperature(); // Valor de temperatura medido
+
+        fmt_format(buffer, sizeof(buffer), "Temp: %d degC\r\n", temperature);
+        uart_send_string(buffer);
+    }
+}
+
+/**
+ * @brief Tarea de aviso de la alarma de temperatura
+ *
+ * @details La activa temp_alarm() desde la ISR del ADC en cada cambio de estado.
+ *
+ * @return Ninguno
+ */
+static void task_alarm(void)
+{
+    if (alarm_event == ADC_ALARM_HIGH)
+    {
+        uart_send_string("Temperature alarm HIGH\r\n");
+    }
+    else if (alarm_event == ADC_ALARM_NORMAL)
+    {
+        uart_send_string("Temperature alarm cleared\r\n");
+    }
+}
 
 /**
  * @brief Función principal de la aplicación
- * 
- * @details Inicializa los periféricos necesarios (reloj, systick, ADC, UART, PWM),
- *          configura la interfaz de usuario y maneja los comandos recibidos a través
- *          de la comunicación UART. Implementa dos funcionalidades principales:
- *          1. Monitoreo de temperatura (activado/desactivado con comando 'T')
- *          2. Control del brillo del LED (ajustado con comando 'L' seguido de un número de 0-99)
+ *
+ * @details Inicializa los periféricos necesarios (systick, UART, PWM y, en segundo plano,
+ *          el ADC; el reloj lo configura SystemInit() desde el arranque),
+ *          configura la interfaz de usuario y registra las tareas del planificador:
+ *          1. Procesamiento de comandos UART en cuanto llegan datos (tabla cmd_table)
+ *          2. Monitoreo de temperatura (activado/desactivado con comando 'T') cada segundo
+ *          3. Aviso de la alarma de temperatura (comando 'A'), activado desde la ISR del ADC
+ *
+ *          Cuando no hay ninguna tarea activada el núcleo duerme hasta la próxima
+ *          activación o hasta que una interrupción (p.ej. la recepción UART) lo despierte.
  *
  * @return int Nunca retorna (bucle infinito)
  */
 int main(void)
 {
-    // Inicialización de periféricos
-    clk_conf();
+    // Inicialización de periféricos (SystemInit() ya ha configurado el reloj: el resto
+    // deriva sus divisores de él). La UART primero para que el mensaje de inicio salga
+    // sin esperar al ADC, cuya estabilización termina en segundo plano (adc_ready())
+    mempool_init();
     systick_init();
-    adc_conf();
-    pwm_led_init();
     uart_conf();
+    pwm_led_init();
 
     // Limpiar posibles datos residuales en el buffer
     while (uart_data_available()) {
         uart_receive_char();
     }
-    delay_ms(50); // Delay de estabilizacion
-    
-    char buffer[32];                 // Buffer para formatear mensajes de salida
-    char received_char;              // Carácter recibido por UART desde el puerto serie
-    int32_t temperature;             // Valor de temperatura medido
-    uint8_t temp_reading_active = 0; // Estado del monitoreo de temperatura (0=OFF, 1=ON)
 
     // Mostrar de mensajes de inicio y menú de opciones
     uart_send_string("STM32F0xx Demo\r\n");
-    uart_send_string("T - to toggle temperature reading\r\n");
-    uart_send_string("L<0-99> - to set LED brightness\r\n");
+    led_seq_init();
+    cmd_init(cmd_table, sizeof(cmd_table) / sizeof(cmd_table[0]));
+    cmd_print_help();
+
+    adc_conf(); // Sin filtro hasta el comando T: el modo continuo no interrumpe
+
+#ifdef BENCH_BUILD
+    bench_run(); // Batería de benchmarks antes de arrancar las tareas
+#endif
+
+    cmd_task = sched_add_oneshot(task_commands, CMD_DEADLINE_MS);
+    alarm_task = sched_add_oneshot(task_alarm, ALARM_DEADLINE_MS);
+    sched_add_periodic(task_temperature, TEMP_PERIOD_MS, 0, 0);
 
     // Bucle principal de la aplicación
     while (1)
     {
-        // Procesamiento de comandos cuando hay datos disponibles
+        uint32_t primask;
+
         if (uart_data_available())
         {
-            received_char = uart_receive_char();
-
-            // Comando T: Alternar estado de lectura de temperatura
-            if (received_char == 'T' || received_char == 't')
-            {
-                temp_reading_active = !temp_reading_active; // Conmutar el estado anterior ON-> OFF -> ON
-
-                if (temp_reading_active) // Motrar el mensaje segun el estado del flag
-                {
-                    uart_send_string("Temperature reading ON\r\n");
-                }
-                else
-                {
-                    uart_send_string("Temperature reading OFF\r\n");
-                }
-            }
-            // Comando L: Configurar brillo del LED con PWM
-            else if (received_char == 'L' || received_char == 'l')
-            {
-                // Mostrar mensaje de confirmación
-                uart_send_string("LED command received, waiting for digits...\r\n");
-                
-                char brightness_str[3] = {0}; // Almacena los dígitos recibidos (2 dígitos + null)
-                int idx = 0;                  // Índice de control para el array de brillo
-                                
-                // Esperar dígitos con un timeout no bloqueante
-                uint32_t start_time = msTicks;
-                while (idx < 2 && (msTicks - start_time) < 5000) // 5 segundos de timeout
-                {
-                    if (uart_data_available())
-                    {
-                        char c = uart_receive_char();
-                        
-                        USART_TDR = c; // Imprimir el caracter recibido por puerto serie
-                        while (!(USART_ISR & (1 << 7))); // Esperar hasta que se complete la transmisión
-                        
-                        // Si es un dígito, almacenarlo
-                        if (c >= '0' && c <= '9')
-                        {
-                            brightness_str[idx++] = c;
-                            delay_ms(5);
-                        }
-                        else
-                        {
-                            break; // Salir si no es un dígito
-                        }
-                    }
-                }
-                
-                // Procesar los dígitos recibidos si hay alguno
-                if (idx > 0)
-                {
-                    uint8_t brightness = 0;
-                    // Convertir string a valor numérico
-                    for (uint8_t i = 0; i < idx; ++i)
-                    {
-                        brightness = brightness * 10 + (brightness_str[i] - '0');
-                    }
-                    
-                    // Aplicar el brillo al LED
-                    set_led_brightness(brightness);
-                    
-                    // Informar del nuevo valor de brillo
-                    sprintf(buffer, "\r\nLED brightness set to %d%%\r\n", brightness);
-                    uart_send_string(buffer);
-                }
-                else
-                {
-                    uart_send_string("No digits received after L command\r\n"); // No hay digitos
-                }
-            }
+            sched_start(cmd_task, 0);
         }
+        sched_dispatch();
 
-        // Si la lectura de temperatura está activa, mostrar valor cada segundo
-        if (temp_reading_active)
+        // Dormir solo si, con las interrupciones deshabilitadas, sigue sin haber trabajo
+        primask = irq_save();
+        if (!uart_data_available())
         {
-            temperature = get_temperature();
-            
-            sprintf(buffer, "Temp: %ld degC\r\n", temperature);
-            uart_send_string(buffer);
-            
-            delay_ms(1000);
+            system_sleep(sched_idle_ms());
         }
+        irq_restore(primask);
     }
 }
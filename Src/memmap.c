@@ -0,0 +1,178 @@
+/**
+ * @file memmap.c
+ * @brief Uso de la pila y mapa de la RAM
+ * @details Reset_Handler pinta la pila reservada (_sstack a _estack, _Min_Stack_Size
+ *          bytes) con MEMMAP_STACK_PAINT; la profundidad máxima alcanzada es la
+ *          distancia desde _estack hasta la palabra más baja que ya no conserva el
+ *          patrón. Con STACK_GUARD definido, SysTick comprueba además en cada tick las
+ *          MEMMAP_GUARD_WORDS palabras del fondo de la pila (un canario sin MPU, que el
+ *          Cortex-M0 no tiene) y llama a stack_overflow_hook() si alguna ha cambiado.
+ *          memmap_dump() envía por la UART el tamaño de cada sección a partir de los
+ *          símbolos del script del enlazador, el uso del heap y de la pila y la
+ *          ocupación de los pools de mempool.c.
+ */
+
+#include "memmap.h"
+#include "mempool.h"
+#include "fmt.h"
+#include "uart.h"
+
+// Símbolos del script del enlazador (STM32F070RBTX_FLASH.ld)
+extern uint32_t _sdata[], _edata[];
+extern uint32_t _sramfunc[], _eramfunc[];
+extern uint32_t _sbss[], _ebss[];
+extern uint32_t _snoinit[], _enoinit[];
+extern uint32_t _smempool[], _emempool[];
+extern uint32_t _end[];
+extern uint32_t _sstack[], _estack[];
+
+#define MEMMAP_RAM_START    0x20000000UL
+
+/**
+ * @brief Devuelve el tamaño de la pila reservada
+ *
+ * @return Bytes entre _sstack y _estack (_Min_Stack_Size)
+ */
+uint32_t memmap_stack_size(void)
+{
+    return (uint32_t)_estack - (uint32_t)_sstack;
+}
+
+/**
+ * @brief Devuelve la mayor profundidad alcanzada por la pila desde el arranque
+ *
+ * @details Busca desde el fondo de la pila la primera palabra distinta del patrón de
+ *          pintado. Cuesta O(tamaño de la pila), por lo que solo debe usarse para
+ *          diagnóstico.
+ *
+ * @return Bytes usados como máximo; memmap_stack_size() si se ha llegado al fondo
+ */
+uint32_t memmap_stack_high_water(void)
+{
+    const uint32_t *p = _sstack;
+
+    while (p < _estack && *p == MEMMAP_STACK_PAINT)
+    {
+        p++;
+    }
+
+    return (uint32_t)_estack - (uint32_t)p;
+}
+
+/**
+ * @brief Indica si el canario del fondo de la pila está intacto
+ *
+ * @return 1 si las MEMMAP_GUARD_WORDS palabras conservan el patrón, 0 si no
+ */
+uint8_t memmap_stack_guard_ok(void)
+{
+    for (uint8_t i = 0; i < MEMMAP_GUARD_WORDS; i++)
+    {
+        if (_sstack[i] != MEMMAP_STACK_PAINT)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+#ifdef STACK_GUARD
+
+static volatile uint8_t stack_guard_tripped = 0; // 1 si el canario se ha encontrado modificado
+
+/**
+ * @brief Comprueba el canario de la pila
+ *
+ * @details Se llama desde SysTick_Handler mediante STACK_GUARD_CHECK(). El aviso se da
+ *          una sola vez.
+ *
+ * @return Ninguno
+ */
+void memmap_stack_guard_check(void)
+{
+    if (!stack_guard_tripped && !memmap_stack_guard_ok())
+    {
+        stack_guard_tripped = 1;
+        stack_overflow_hook();
+    }
+}
+
+/**
+ * @brief Acción ante un desbordamiento de pila detectado por el canario
+ *
+ * @details La pila ya ha invadido la memoria que hay debajo, por lo que por defecto se
+ *          detiene la ejecución (BKPT, que sin depurador escala a HardFault). La
+ *          aplicación puede redefinirla, p.ej. para forzar un reset del sistema.
+ *
+ * @note Se ejecuta en contexto de interrupción
+ * @return Ninguno
+ */
+__attribute__((weak)) void stack_overflow_hook(void)
+{
+    for (;;)
+    {
+        __asm volatile ("bkpt #0");
+    }
+}
+
+#endif // STACK_GUARD
+
+/**
+ * @brief Envía una línea del mapa de memoria
+ *
+ * @return Ninguno
+ */
+static void memmap_line(const char *name, const void *start, uint32_t used, uint32_t size)
+{
+    char buffer[48]; // Buffer para formatear mensajes de salida
+
+    fmt_format(buffer, sizeof(buffer), "%s 0x%08x %u %u\r\n", name, (uint32_t)start, used, size);
+    uart_send_string(buffer);
+}
+
+/**
+ * @brief Envía por la UART el mapa de la RAM
+ *
+ * @details Una línea por región con su dirección, bytes usados y bytes reservados:
+ *          .data (y el código .ramfunc que contiene), .bss, .noinit, .mempool, el heap (usado por _sbrk frente al hueco
+ *          hasta la pila) y la pila (profundidad máxima frente a _Min_Stack_Size),
+ *          seguidas de la ocupación de cada clase de mempool.c.
+ *
+ * @return Ninguno
+ */
+void memmap_dump(void)
+{
+    char buffer[48]; // Buffer para formatear mensajes de salida
+    uint32_t data = (uint32_t)_edata - (uint32_t)_sdata;
+    uint32_t ramfunc = (uint32_t)_eramfunc - (uint32_t)_sramfunc;
+    uint32_t bss = (uint32_t)_ebss - (uint32_t)_sbss;
+    uint32_t noinit = (uint32_t)_enoinit - (uint32_t)_snoinit;
+    uint32_t pool = (uint32_t)_emempool - (uint32_t)_smempool;
+    uint32_t heap_room = (uint32_t)_sstack - (uint32_t)_end;
+    uint32_t stack = memmap_stack_size();
+    mempool_stats_t s;
+
+    uart_send_string("region start used size\r\n");
+    memmap_line("data", _sdata, data, data);
+    memmap_line("ramfunc", _sramfunc, ramfunc, ramfunc); // Dentro de .data
+    memmap_line("bss", _sbss, bss, bss);
+    memmap_line("noinit", _snoinit, noinit, noinit);
+    memmap_line("mempool", _smempool, pool, pool);
+    memmap_line("heap", _end, sysmem_heap_used(), heap_room);
+    memmap_line("stack", _sstack, memmap_stack_high_water(), stack);
+
+    fmt_format(buffer, sizeof(buffer), "ram %u total, %u free, guard %s\r\n",
+               (uint32_t)_estack - MEMMAP_RAM_START, heap_room - sysmem_heap_used(),
+               memmap_stack_guard_ok() ? "ok" : "TRIPPED");
+    uart_send_string(buffer);
+
+    uart_send_string("pool size blocks used max fail\r\n");
+    for (uint8_t c = 0; c < MEMPOOL_CLASS_COUNT; c++)
+    {
+        mempool_stats((mempool_class_t)c, &s);
+        fmt_format(buffer, sizeof(buffer), "%u %u %u %u %u %u\r\n", (uint32_t)c, (uint32_t)s.block_size,
+                   (uint32_t)s.blocks, (uint32_t)s.used, (uint32_t)s.high_water, s.failures);
+        uart_send_string(buffer);
+    }
+}
@@ -0,0 +1,249 @@
+/**
+ * @file mempool.c
+ * @brief Reserva de memoria en bloques de tamaño fijo
+ * @details Sustituye al heap de newlib (_sbrk, sysmem.c) para la memoria dinámica: cada
+ *          clase tiene un número fijo de bloques de un mismo tamaño encadenados en una
+ *          lista de libres, por lo que reservar y liberar cuestan O(1) (a lo sumo
+ *          MEMPOOL_CLASS_COUNT comparaciones) y no hay fragmentación. La memoria vive en
+ *          la sección .mempool del enlazador, de modo que su tamaño aparece en el mapa
+ *          de memoria y no compite con el heap ni con la pila.
+ *          Un mapa de bits por clase marca los bloques reservados: mempool_free()
+ *          ignora las liberaciones dobles y los bloques nunca reservados, que de otro
+ *          modo cerrarían un ciclo en la lista de libres y falsearían las estadísticas.
+ *          Las listas se modifican con las interrupciones deshabilitadas, así que se
+ *          puede reservar y liberar desde las ISR.
+ */
+
+#include "mempool.h"
+#include "system.h"
+
+#define MEMPOOL_SECTION __attribute__((section(".mempool"), aligned(4)))
+
+#define MEMPOOL_POW2(n)  ((n) >= 4 && ((n) & ((n) - 1)) == 0)
+#define MEMPOOL_WORDS(n) (((n) + 31) / 32) // Palabras del mapa de bits para n bloques
+
+// Potencias de 2: la alineación y el índice de un bloque salen de una máscara y un
+// desplazamiento (el Cortex-M0 no divide)
+_Static_assert(MEMPOOL_POW2(MEMPOOL_SMALL_SIZE) && MEMPOOL_POW2(MEMPOOL_MEDIUM_SIZE) &&
+               MEMPOOL_POW2(MEMPOOL_LARGE_SIZE), "Los bloques deben ser potencias de 2 de al menos 4 bytes");
+_Static_assert(MEMPOOL_SMALL_SIZE < MEMPOOL_MEDIUM_SIZE && MEMPOOL_MEDIUM_SIZE < MEMPOOL_LARGE_SIZE,
+               "Las clases deben estar ordenadas de menor a mayor tamaño");
+
+// Bloque libre: la primera palabra enlaza con el siguiente libre de la clase
+typedef struct mempool_block
+{
+    struct mempool_block *next;
+} mempool_block_t;
+
+// Estado de una clase
+typedef struct
+{
+    uint8_t *base;              // Primer bloque
+    uint8_t *end;               // Fin de la memoria de la clase
+    mempool_block_t *free;      // Lista de bloques libres
+    uint32_t *in_use;           // Mapa de bits de bloques reservados (bit n = bloque n)
+    uint8_t shift;              // log2(block_size)
+    mempool_stats_t stats;
+} mempool_pool_t;
+
+static uint32_t small_storage[MEMPOOL_SMALL_SIZE * MEMPOOL_SMALL_COUNT / 4] MEMPOOL_SECTION;
+static uint32_t medium_storage[MEMPOOL_MEDIUM_SIZE * MEMPOOL_MEDIUM_COUNT / 4] MEMPOOL_SECTION;
+static uint32_t large_storage[MEMPOOL_LARGE_SIZE * MEMPOOL_LARGE_COUNT / 4] MEMPOOL_SECTION;
+
+static uint32_t small_in_use[MEMPOOL_WORDS(MEMPOOL_SMALL_COUNT)];
+static uint32_t medium_in_use[MEMPOOL_WORDS(MEMPOOL_MEDIUM_COUNT)];
+static uint32_t large_in_use[MEMPOOL_WORDS(MEMPOOL_LARGE_COUNT)];
+
+static mempool_pool_t pools[MEMPOOL_CLASS_COUNT] =
+{
+    { (uint8_t *)small_storage,  (uint8_t *)small_storage + sizeof(small_storage),   0, small_in_use,  0,
+      { MEMPOOL_SMALL_SIZE,  MEMPOOL_SMALL_COUNT,  0, 0, 0 } },
+    { (uint8_t *)medium_storage, (uint8_t *)medium_storage + sizeof(medium_storage), 0, medium_in_use, 0,
+      { MEMPOOL_MEDIUM_SIZE, MEMPOOL_MEDIUM_COUNT, 0, 0, 0 } },
+    { (uint8_t *)large_storage,  (uint8_t *)large_storage + sizeof(large_storage),   0, large_in_use,  0,
+      { MEMPOOL_LARGE_SIZE,  MEMPOOL_LARGE_COUNT,  0, 0, 0 } },
+};
+
+/**
+ * @brief Devuelve el índice de un bloque dentro de su clase
+ *
+ * @return Número de bloque desde p->base
+ */
+static uint32_t mempool_index(const mempool_pool_t *p, const uint8_t *block)
+{
+    return (uint32_t)(block - p->base) >> p->shift;
+}
+
+/**
+ * @brief Encadena todos los bloques de cada clase en su lista de libres
+ *
+ * @details La sección .mempool no se inicializa en el arranque; esta función debe
+ *          llamarse antes de la primera reserva. Vuelve a dejar todos los bloques libres
+ *          y a cero las estadísticas.
+ *
+ * @return Ninguno
+ */
+void mempool_init(void)
+{
+    uint32_t primask = irq_save();
+
+    for (uint8_t c = 0; c < MEMPOOL_CLASS_COUNT; c++)
+    {
+        mempool_pool_t *p = &pools[c];
+        uint8_t *block = p->end;
+
+        p->free = 0;
+        p->shift = 0;
+        while ((1U << p->shift) < p->stats.block_size)
+        {
+            p->shift++;
+        }
+        for (uint16_t w = 0; w < MEMPOOL_WORDS(p->stats.blocks); w++)
+        {
+            p->in_use[w] = 0;
+        }
+        while (block > p->base)   // De atrás a delante: la lista queda en orden de direcciones
+        {
+            block -= p->stats.block_size;
+            ((mempool_block_t *)block)->next = p->free;
+            p->free = (mempool_block_t *)block;
+        }
+
+        p->stats.used = 0;
+        p->stats.high_water = 0;
+        p->stats.failures = 0;
+    }
+
+    irq_restore(primask);
+}
+
+/**
+ * @brief Reserva un bloque de al menos size bytes
+ *
+ * @details Se usa la menor clase en la que cabe size; si está agotada se prueba con las
+ *          mayores. El contenido del bloque no se inicializa.
+ *
+ * @param size Bytes necesarios
+ *
+ * @note Puede llamarse desde una ISR
+ * @return Bloque alineado a 4 bytes, o 0 si size es 0 o mayor que la clase mayor, o si
+ *         no quedan bloques libres
+ */
+void *mempool_alloc(size_t size)
+{
+    mempool_pool_t *fit = 0;
+    void *block = 0;
+    uint32_t primask;
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    primask = irq_save();
+
+    for (uint8_t c = 0; c < MEMPOOL_CLASS_COUNT; c++)
+    {
+        mempool_pool_t *p = &pools[c];
+
+        if (size > p->stats.block_size)
+        {
+            continue;
+        }
+        if (fit == 0)
+        {
+            fit = p; // Clase a la que se atribuye un fallo
+        }
+        if (p->free)
+        {
+            uint32_t n = mempool_index(p, (uint8_t *)p->free);
+
+            block = p->free;
+            p->free = p->free->next;
+            p->in_use[n >> 5] |= 1UL << (n & 31);
+            if (++p->stats.used > p->stats.high_water)
+            {
+                p->stats.high_water = p->stats.used;
+            }
+            break;
+        }
+    }
+
+    if (block == 0 && fit)
+    {
+        fit->stats.failures++;
+    }
+
+    irq_restore(primask);
+
+    return block;
+}
+
+/**
+ * @brief Devuelve un bloque a su clase
+ *
+ * @details La clase se deduce de la dirección. Los punteros que no son el comienzo de
+ *          un bloque reservado de algún pool se ignoran, incluida la segunda liberación
+ *          de un mismo bloque.
+ *
+ * @param block Bloque obtenido con mempool_alloc() (0 se ignora)
+ *
+ * @note Puede llamarse desde una ISR
+ * @return Ninguno
+ */
+void mempool_free(void *block)
+{
+    uint8_t *b = block;
+
+    for (uint8_t c = 0; c < MEMPOOL_CLASS_COUNT; c++)
+    {
+        mempool_pool_t *p = &pools[c];
+
+        if (b >= p->base && b < p->end)
+        {
+            uint32_t n = mempool_index(p, b);
+            uint32_t bit = 1UL << (n & 31);
+            uint32_t primask;
+
+            if ((uint32_t)(b - p->base) & (p->stats.block_size - 1U))
+            {
+                return; // Puntero dentro de un bloque
+            }
+
+            primask = irq_save();
+            if (p->in_use[n >> 5] & bit) // Un bloque libre no se vuelve a encadenar
+            {
+                p->in_use[n >> 5] &= ~bit;
+                ((mempool_block_t *)b)->next = p->free;
+                p->free = (mempool_block_t *)b;
+                p->stats.used--;
+            }
+            irq_restore(primask);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Copia las estadísticas de una clase
+ *
+ * @param cls Clase
+ * @param stats Destino de la copia
+ *
+ * @return 1 si cls es válida, 0 si no
+ */
+uint8_t mempool_stats(mempool_class_t cls, mempool_stats_t *stats)
+{
+    uint32_t primask;
+
+    if (cls >= MEMPOOL_CLASS_COUNT || stats == 0)
+    {
+        return 0;
+    }
+
+    primask = irq_save();
+    *stats = pools[cls].stats;
+    irq_restore(primask);
+
+    return 1;
+}
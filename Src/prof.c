@@ -0,0 +1,171 @@
+/**
+ * @file prof.c
+ * @brief Instrumentación de regiones críticas con histogramas de latencia
+ * @details Cada región marcada con PROF_START/PROF_END acumula en RAM el número de
+ *          medidas, el mínimo, el máximo, la suma (para la media) y un histograma
+ *          logarítmico de su duración en ciclos, medida con timestamp_cycles().
+ *          Solo se compila con PROFILE_ENABLE definido; en otro caso las macros no
+ *          generan código y este fichero queda vacío.
+ *          Cada región debe medirse desde un único contexto (una ISR o el bucle
+ *          principal), por lo que el registro no necesita deshabilitar interrupciones.
+ */
+
+#include "prof.h"
+
+#ifdef PROFILE_ENABLE
+
+#include "fmt.h"
+#include "uart.h"
+
+static prof_stats_t prof_table[PROF_REGION_COUNT];
+
+static const char *const prof_names[PROF_REGION_COUNT] =
+{
+    "get_temperature",
+    "uart_send_string",
+    "cmd_dispatch",
+    "isr_systick",
+    "isr_usart2",
+    "isr_dma1_ch1",
+    "isr_dma1_ch2_3",
+    "isr_dma1_ch4_5",
+    "isr_adc"
+};
+
+/**
+ * @brief Calcula el intervalo del histograma de una duración
+ *
+ * @details Búsqueda binaria del bit más significativo: el Cortex-M0 no tiene CLZ.
+ *
+ * @param cycles Duración en ciclos
+ *
+ * @return Intervalo entre 0 y PROF_HIST_BINS - 1
+ */
+static uint8_t prof_bin(uint32_t cycles)
+{
+    uint8_t log2 = 0;
+
+    if (cycles >= (1UL << 16)) { cycles >>= 16; log2 += 16; }
+    if (cycles >= (1UL << 8))  { cycles >>= 8;  log2 += 8; }
+    if (cycles >= (1UL << 4))  { cycles >>= 4;  log2 += 4; }
+    if (cycles >= (1UL << 2))  { cycles >>= 2;  log2 += 2; }
+    if (cycles >= (1UL << 1))  { log2 += 1; }
+
+    if (log2 <= PROF_HIST_MIN_LOG2)
+    {
+        return 0;
+    }
+    log2 -= PROF_HIST_MIN_LOG2;
+
+    return (log2 < PROF_HIST_BINS) ? log2 : PROF_HIST_BINS - 1;
+}
+
+/**
+ * @brief Registra una medida de una región
+ *
+ * @param r Región
+ * @param cycles Duración en ciclos del reloj del sistema
+ *
+ * @return Ninguno
+ */
+void prof_record(prof_region_t r, uint32_t cycles)
+{
+    prof_stats_t *s = &prof_table[r];
+    uint8_t bin = prof_bin(cycles);
+
+    if (s->count == 0 || cycles < s->min)
+    {
+        s->min = cycles;
+    }
+    if (cycles > s->max)
+    {
+        s->max = cycles;
+    }
+    s->sum += cycles;
+    s->count++;
+
+    if (s->hist[bin] != UINT16_MAX)
+    {
+        s->hist[bin]++;
+    }
+}
+
+/**
+ * @brief Borra las estadísticas de todas las regiones
+ *
+ * @return Ninguno
+ */
+void prof_reset(void)
+{
+    uint32_t primask = irq_save();
+
+    for (uint8_t r = 0; r < PROF_REGION_COUNT; r++)
+    {
+        prof_stats_t *s = &prof_table[r];
+
+        s->count = 0;
+        s->min = 0;
+        s->max = 0;
+        s->sum = 0;
+        for (uint8_t b = 0; b < PROF_HIST_BINS; b++)
+        {
+            s->hist[b] = 0;
+        }
+    }
+
+    irq_restore(primask);
+}
+
+/**
+ * @brief Devuelve las estadísticas de una región
+ *
+ * @return Puntero a las estadísticas (válido mientras no se llame a prof_reset)
+ */
+const prof_stats_t *prof_stats(prof_region_t r)
+{
+    return &prof_table[r];
+}
+
+/**
+ * @brief Envía por UART la tabla de estadísticas
+ *
+ * @details Una línea por región con número de medidas, mínimo, máximo y media en
+ *          ciclos, seguida de los intervalos no vacíos del histograma como "k:n"
+ *          (n medidas de entre 2^k y 2^(k+1) ciclos; "0:n" son las de menos de
+ *          2^(PROF_HIST_MIN_LOG2 + 1) ciclos).
+ *
+ * @note La división de la media solo se hace aquí, nunca al registrar
+ * @return Ninguno
+ */
+void prof_dump(void)
+{
+    char buffer[48]; // Buffer para formatear mensajes de salida
+
+    uart_send_string("region count min max mean [k:n]\r\n");
+
+    for (uint8_t r = 0; r < PROF_REGION_COUNT; r++)
+    {
+        prof_stats_t s;
+        uint32_t primask = irq_save();
+
+        s = prof_table[r]; // Copia coherente: la ISR puede seguir registrando
+        irq_restore(primask);
+
+        fmt_format(buffer, sizeof(buffer), "%s %u %u %u %u", prof_names[r], s.count,
+                   s.min, s.max, (uint32_t)(s.count ? s.sum / s.count : 0));
+        uart_send_string(buffer);
+
+        for (uint8_t b = 0; b < PROF_HIST_BINS; b++)
+        {
+            if (s.hist[b])
+            {
+                fmt_format(buffer, sizeof(buffer), " %u:%u", (uint32_t)(b ? b + PROF_HIST_MIN_LOG2 : 0),
+                           (uint32_t)s.hist[b]);
+                uart_send_string(buffer);
+            }
+        }
+        uart_send_string("\r\n");
+    }
+}
+
+#endif // PROFILE_ENABLE
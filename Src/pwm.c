@@ -1,70 +1,377 @@
 /**
  * @file pwm.c
- * @brief Implementación de funciones para control PWM de LED
- * @details Contiene funciones para inicializar y controlar la salida PWM
- *          utilizando el timer TIM2 del microcontrolador STM32F070RB.
- *          Permite el control de brillo del LED conectado al pin PA5.
+ * @brief Implementación de funciones para control PWM
+ * @details Driver PWM genérico para TIM1, TIM2 y TIM3 (hasta 4 canales por timer):
+ *          el preescalador y el periodo se calculan a partir de system_core_clock para
+ *          la frecuencia y resolución pedidas, y el ciclo de trabajo se expresa en 16
+ *          bits independientemente de la resolución. CCRx y ARR usan precarga, de modo
+ *          que cada cambio se aplica al comienzo del siguiente periodo; con
+ *          pwm_set_duties() varios canales cambian en el mismo periodo.
+ *          pwm_led_init() y set_led_brightness() configuran y controlan el LED
+ *          conectado al pin PA5 (TIM2 canal 1).
  */
 
 #include "pwm.h"
 #include "nucleo_conf.h"
+#include "system.h"
+#include "gamma.h"
+
+// Recursos de cada timer
+typedef struct
+{
+    tim_regs_t *regs;   // Registros del timer
+    uint32_t apb1_en;   // Bit de RCC_APB1ENR (0 si el timer está en APB2)
+} pwm_timer_hw_t;
+
+static const pwm_timer_hw_t pwm_hw[PWM_TIMER_COUNT] =
+{
+    { TIM1, 0 },
+    { TIM2, RCC_APB1ENR_TIM2EN },
+    { TIM3, RCC_APB1ENR_TIM3EN }
+};
+
+static uint32_t pwm_steps[PWM_TIMER_COUNT];    // Pasos por periodo (ARR + 1) de cada timer
+static uint32_t pwm_freq[PWM_TIMER_COUNT];     // Frecuencia PWM real de cada timer
+
+// Pin del LED de la placa: PA5, AF2 = TIM2_CH1
+static const pwm_pin_t led_pin = { GPIOA, 5, 2 };
+static uint8_t led_level = 0;                   // Último brillo pedido con set_led_brightness()
+static uint8_t led_limit = 99;                  // Brillo máximo aplicado (set_led_limit())
+
+/**
+ * @brief Configura la base de tiempos de un timer para PWM
+ *
+ * @details Con steps = 0 se elige la mayor resolución posible (hasta PWM_MAX_STEPS)
+ *          para la frecuencia pedida. En otro caso el preescalador se redondea al
+ *          entero más cercano y la frecuencia real puede diferir ligeramente
+ *          (pwm_get_freq()). Los canales configurados conservan su ciclo de trabajo
+ *          en cuentas, por lo que tras cambiar la resolución hay que volver a fijarlo.
+ *
+ * @param tim Timer
+ * @param freq_hz Frecuencia PWM deseada en Hz
+ * @param steps Pasos del ciclo de trabajo (2 a PWM_MAX_STEPS, 0 = máximo posible)
+ *
+ * @note Llamar de nuevo si cambia system_core_clock (clk_set_profile())
+ * @return Pasos conseguidos o 0 si la combinación no es alcanzable
+ */
+uint32_t pwm_timer_init(pwm_timer_t tim, uint32_t freq_hz, uint32_t steps)
+{
+    tim_regs_t *t;
+    uint32_t ticks;
+    uint32_t psc;
+
+    if (tim >= PWM_TIMER_COUNT || freq_hz == 0 || steps == 1 || steps > PWM_MAX_STEPS)
+    {
+        return 0;
+    }
+
+    ticks = system_core_clock / freq_hz; // Ciclos de reloj por periodo PWM
+    if (steps == 0)
+    {
+        psc = (ticks + PWM_MAX_STEPS - 1) / PWM_MAX_STEPS; // Menor divisor con ARR de 16 bits
+        if (psc == 0)
+        {
+            return 0;
+        }
+        steps = ticks / psc;
+        if (steps < 2)
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        psc = (ticks + steps / 2) / steps;
+    }
+
+    if (psc == 0 || psc > 0x10000)
+    {
+        return 0; // Frecuencia demasiado alta para la resolución o demasiado baja
+    }
+
+    t = pwm_hw[tim].regs;
+    if (pwm_hw[tim].apb1_en)
+    {
+        RCC_APB1ENR |= pwm_hw[tim].apb1_en;
+    }
+    else
+    {
+        RCC_APB2ENR |= RCC_APB2ENR_TIM1EN;
+    }
+
+    t->CR1 = TIM_CR1_ARPE;          // Contador parado, ARR con precarga
+    t->PSC = psc - 1;
+    t->ARR = steps - 1;
+    t->EGR = TIM_EGR_UG;            // Cargar PSC y ARR antes de arrancar
+    if (tim == PWM_TIM1)
+    {
+        t->BDTR |= TIM_BDTR_MOE;    // Los timers avanzados necesitan habilitar las salidas
+    }
+    t->CR1 = TIM_CR1_ARPE | TIM_CR1_CEN;
+
+    pwm_steps[tim] = steps;
+    pwm_freq[tim] = system_core_clock / (psc * steps);
+
+    return steps;
+}
+
+/**
+ * @brief Devuelve el bit de RCC_AHBENR que habilita el reloj de un puerto
+ *
+ * @return RCC_AHBENR_GPIOxEN, o 0 si el puerto no es GPIOA, GPIOB ni GPIOC
+ */
+static uint32_t pwm_port_clock(const gpio_regs_t *port)
+{
+    if (port == GPIOA)
+    {
+        return RCC_AHBENR_GPIOAEN;
+    }
+    if (port == GPIOB)
+    {
+        return RCC_AHBENR_GPIOBEN;
+    }
+    if (port == GPIOC)
+    {
+        return RCC_AHBENR_GPIOCEN;
+    }
+    return 0;
+}
+
+/**
+ * @brief Configura un canal como salida PWM en un pin
+ *
+ * @details El pin pasa a función alternativa, el canal a PWM modo 1 con precarga de
+ *          CCRx y la salida empieza inactiva (ciclo de trabajo 0).
+ *
+ * @param tim Timer (configurado antes con pwm_timer_init())
+ * @param channel Canal de 1 a PWM_CHANNELS
+ * @param pin Pin y función alternativa del canal en GPIOA, GPIOB o GPIOC (ver la hoja de datos)
+ *
+ * @return 1 si se ha configurado, 0 si los parámetros no son válidos
+ */
+uint8_t pwm_channel_init(pwm_timer_t tim, uint8_t channel, const pwm_pin_t *pin)
+{
+    tim_regs_t *t;
+    volatile uint32_t *ccmr;
+    uint32_t port_en;
+
+    if (tim >= PWM_TIMER_COUNT || channel == 0 || channel > PWM_CHANNELS ||
+        pin == 0 || pin->pin > 15 || pin->af > 7)
+    {
+        return 0;
+    }
+
+    port_en = pwm_port_clock(pin->port);
+    if (port_en == 0)
+    {
+        return 0; // Puerto desconocido
+    }
+
+    t = pwm_hw[tim].regs;
+
+    RCC_AHBENR |= port_en;
+    REG_MODIFY(pin->port->MODER, GPIO_MODER_MODE(pin->pin), GPIO_MODER_VAL(pin->pin, GPIO_MODE_AF));
+    REG_MODIFY(pin->port->AFR[pin->pin >> 3], GPIO_AFR_AF(pin->pin), GPIO_AFR_VAL(pin->pin, pin->af));
+
+    t->CCR[channel - 1] = 0;
+    ccmr = &t->CCMR[(channel - 1) >> 1];
+    REG_MODIFY(*ccmr, TIM_CCMR_OC(channel),     // Canales impares en el byte bajo de CCMRx, pares en el alto
+               (TIM_CCMR_OCM_PWM1 | TIM_CCMR_OCPE) << ((channel & 1) ? 0 : 8));
+    t->CCER |= TIM_CCER_CCE(channel);           // Habilitar la salida
+
+    return 1;
+}
+
+/**
+ * @brief Convierte un ciclo de trabajo de 16 bits en cuentas del timer
+ *
+ * @return Valor para CCRx (pwm_steps[tim] si duty es PWM_DUTY_MAX)
+ */
+static uint32_t pwm_duty_counts(pwm_timer_t tim, uint16_t duty)
+{
+    if (duty == PWM_DUTY_MAX)
+    {
+        return pwm_steps[tim]; // CCRx > ARR: salida siempre activa
+    }
+
+    return ((uint32_t)duty * pwm_steps[tim]) >> 16; // Sin división: 65535 * 65536 cabe en 32 bits
+}
+
+/**
+ * @brief Establece el ciclo de trabajo de un canal
+ *
+ * @param tim Timer
+ * @param channel Canal de 1 a PWM_CHANNELS
+ * @param duty Ciclo de trabajo de 0 (inactivo) a PWM_DUTY_MAX (siempre activo)
+ *
+ * @note El valor se aplica al comienzo del siguiente periodo
+ * @return Ninguno
+ */
+void pwm_set_duty(pwm_timer_t tim, uint8_t channel, uint16_t duty)
+{
+    if (tim >= PWM_TIMER_COUNT || channel == 0 || channel > PWM_CHANNELS)
+    {
+        return;
+    }
+
+    pwm_hw[tim].regs->CCR[channel - 1] = pwm_duty_counts(tim, duty);
+}
+
+/**
+ * @brief Establece a la vez el ciclo de trabajo de varios canales de un timer
+ *
+ * @details UDIS bloquea la transferencia de los registros precargados mientras se
+ *          escriben, de modo que todos los canales cambian en la misma actualización
+ *          (nunca se aplica una mezcla de valores antiguos y nuevos).
+ *
+ * @param tim Timer
+ * @param duty Ciclos de trabajo de los canales 1 a PWM_CHANNELS (duty[0] = canal 1)
+ * @param mask Canales a modificar (bit 0 = canal 1)
+ *
+ * @note Usar cada timer desde un único contexto: CR1 se modifica con lectura-escritura
+ * @return Ninguno
+ */
+void pwm_set_duties(pwm_timer_t tim, const uint16_t *duty, uint8_t mask)
+{
+    tim_regs_t *t;
+
+    if (tim >= PWM_TIMER_COUNT)
+    {
+        return;
+    }
+
+    t = pwm_hw[tim].regs;
+
+    t->CR1 |= TIM_CR1_UDIS;
+    for (uint8_t ch = 1; ch <= PWM_CHANNELS; ch++)
+    {
+        if (mask & (1U << (ch - 1)))
+        {
+            t->CCR[ch - 1] = pwm_duty_counts(tim, duty[ch - 1]);
+        }
+    }
+    t->CR1 &= ~TIM_CR1_UDIS;
+}
+
+/**
+ * @brief Establece el ciclo de trabajo de un canal en cuentas del timer
+ *
+ * @param tim Timer
+ * @param channel Canal de 1 a PWM_CHANNELS
+ * @param counts Cuentas activas por periodo, de 0 a pwm_get_steps() (siempre activo)
+ *
+ * @return Ninguno
+ */
+void pwm_set_compare(pwm_timer_t tim, uint8_t channel, uint32_t counts)
+{
+    if (tim >= PWM_TIMER_COUNT || channel == 0 || channel > PWM_CHANNELS)
+    {
+        return;
+    }
+
+    pwm_hw[tim].regs->CCR[channel - 1] = counts;
+}
+
+/**
+ * @brief Devuelve la resolución de un timer
+ *
+ * @return Pasos por periodo (ARR + 1), 0 si no está configurado
+ */
+uint32_t pwm_get_steps(pwm_timer_t tim)
+{
+    return (tim < PWM_TIMER_COUNT) ? pwm_steps[tim] : 0;
+}
+
+/**
+ * @brief Devuelve la frecuencia PWM real de un timer
+ *
+ * @return Frecuencia en Hz, 0 si no está configurado
+ */
+uint32_t pwm_get_freq(pwm_timer_t tim)
+{
+    return (tim < PWM_TIMER_COUNT) ? pwm_freq[tim] : 0;
+}
 
 /**
  * @brief Inicializa el periférico TIM2 para generar señal PWM en el LED
- * 
- * @details Esta función configura el timer TIM2 para generar una señal PWM
- *          de 100Hz en el pin PA5 (LED). La secuencia de configuración es:
- *          1. Habilita relojes para GPIOA y TIM2
- *          2. Configura el pin PA5 en modo función alternativa (AF2=TIM2_CH1)
- *          3. Configura el timer TIM2 con un preescalador y periodo
- *          4. Configura el canal 1 en modo PWM
- *          5. Habilita la salida y el contador
- *
- * @note La frecuencia PWM es de 100Hz con una resolución de 0-99 para el brillo
+ *
+ * @details Configura TIM2 a PWM_LED_FREQ con la máxima resolución (48000 pasos a
+ *          48MHz) y el canal 1 en el pin PA5 (AF2 = TIM2_CH1), con el LED apagado. La
+ *          resolución alta es la que permite distinguir los niveles bajos de gamma_table.
+ *
  * @return Ninguno
  */
 void pwm_led_init(void)
 {
-    RCC_AHBENR |= (1 << 17);    // Activar reloj GPIOA
-    RCC_APB1ENR |= (1 << 0);    // Activar reloj TIM2
-    
-    GPIOA_MODER &= ~(3 << 10);  // Limpiar bits PA5
-    GPIOA_MODER |= (2 << 10);   // Settear modo funcion alternativa en PA5
-    GPIOA_AFRL &= ~(0xF << 20); // Limpiar bit del 20 al 23
-    GPIOA_AFRL |= (2 << 20);    // Activar AF2
-    
-    TIM2_PSC = 800 - 1;         // Preescalador: 8MHz/800 = 10kHz (frecuencia de conteo)
-    TIM2_ARR = 100 - 1;         // Auto-reload: 10kHz/100 = 100Hz (frecuencia PWM)
-                                // Determina 100 niveles posibles de brillo (0-99)
-
-    TIM2_CCMR1 &= ~(7 << 4);    // Limpiar bits de modo de salida OC1M (bits 4-6)
-    TIM2_CCMR1 |= (6 << 4);     // Configurar PWM modo 1 (110 binario) para OC1
-    TIM2_CCMR1 |= (1 << 3);     // Habilitar precarga del registro OC1PE
-    
-    TIM2_CCER |= (1 << 0);       // Habilitar capture/compare
-    
-    TIM2_CCR1 = 0;              // Establecer ciclo de trabajo inicial a 0 (LED apagado)
-    
-    TIM2_CR1 |= (1 << 0);       // Habilitar contador del timer (CEN=1)
+    pwm_timer_init(PWM_TIM2, PWM_LED_FREQ, PWM_LED_STEPS);
+    pwm_channel_init(PWM_TIM2, 1, &led_pin);
 }
 
 /**
  * @brief Establece el nivel de brillo del LED mediante PWM
  *
  * @details Controla el ciclo de trabajo del PWM para ajustar el brillo del LED.
- *          El valor se limita automáticamente al rango válido (0-99).
+ *          El valor se limita automáticamente al rango válido (0-99) y se convierte
+ *          con gamma_table (luminosidad CIE L*), de modo que cada nivel produce el
+ *          mismo cambio de brillo percibido; la mitad del rango equivale a ~19% de
+ *          ciclo de trabajo. Si supera el límite de set_led_limit() se aplica el límite.
+ *
+ * @param brightness Nivel de brillo percibido entre 0 (apagado) y 99 (máximo brillo)
  *
- * @param brightness Nivel de brillo entre 0 (apagado) y 99 (máximo brillo)
- * 
  * @note Un valor de 0 apaga el LED, mientras que 99 representa el brillo máximo
  * @return Ninguno
  */
 void set_led_brightness(uint8_t brightness)
 {
+    uint32_t primask;
+
     if (brightness > 99)
     {
         brightness = 99;    // Limitar el brillo al rango de 0-99
     }
-    
-    TIM2_CCR1 = brightness; // Establecer el ciclo de trabajo
+
+    primask = irq_save();   // set_led_limit() puede ejecutarse en una ISR
+    led_level = brightness;
+    if (brightness > led_limit)
+    {
+        brightness = led_limit;
+    }
+    pwm_set_duty(PWM_TIM2, 1, gamma_table[brightness]); // Nivel percibido -> ciclo de trabajo lineal
+    irq_restore(primask);
+}
+
+/**
+ * @brief Limita el brillo del LED
+ *
+ * @details El último brillo pedido se conserva: mientras supere el límite el LED luce
+ *          al nivel del límite, y al subirlo de nuevo (99 = sin límite) recupera el
+ *          brillo pedido. Las secuencias de led_seq.c quedan limitadas igual; las
+ *          tablas de pwm_wave.c no, porque el DMA escribe CCR1 directamente.
+ *
+ * @param max Brillo máximo entre 0 y 99
+ *
+ * @note Puede llamarse desde una ISR
+ * @return Ninguno
+ */
+void set_led_limit(uint8_t max)
+{
+    uint32_t primask = irq_save();
+
+    led_limit = (max > 99) ? 99 : max;
+    set_led_brightness(led_level); // Aplicar el límite al brillo actual
+    irq_restore(primask);
+}
+
+/**
+ * @brief Vuelve a aplicar al LED el último brillo pedido
+ *
+ * @details Recalcula CCR1 con la resolución actual de TIM2 y el límite de
+ *          set_led_limit(); pwm_wave.c la usa al terminar una reproducción.
+ *
+ * @note Puede llamarse desde una ISR
+ * @return Ninguno
+ */
+void pwm_led_refresh(void)
+{
+    set_led_brightness(led_level);
 }
@@ -0,0 +1,321 @@
+/**
+ * @file pwm_wave.c
+ * @brief Reproducción de formas de onda PWM por DMA en TIM2 canal 1
+ * @details Cada evento de actualización de TIM2 (fin de un periodo PWM) genera una
+ *          petición al canal 2 del DMA1, que copia el siguiente valor de la tabla en
+ *          TIM2_CCR1. Con la precarga OC1PE activada (pwm_led_init()) el valor nuevo
+ *          se aplica exactamente al comienzo del siguiente periodo, sin jitter y sin
+ *          trabajo de la CPU por muestra. La frecuencia de actualización coincide con
+ *          la frecuencia PWM: durante la reproducción TIM2 usa el periodo (resolución de
+ *          la tabla) y el preescalador de pwm_wave_start(), y al terminar recupera los de
+ *          pwm_timer_init(). Los valores de la tabla son cuentas del timer, de 0
+ *          (apagado) a esa resolución (encendido). Al terminar, el LED vuelve al brillo
+ *          de set_led_brightness() (pwm_led_refresh()), porque el último valor de la
+ *          tabla no tiene sentido en la resolución del LED.
+ *          El DMA escribe CCR1 directamente: durante la reproducción no se aplica el
+ *          límite de set_led_limit() (p.ej. el de la alarma de temperatura); las tablas
+ *          deben respetarlo si hace falta.
+ *          La interrupción de fin de transferencia solo se habilita cuando hace falta
+ *          (modo de una pasada o tabla en cola): en modo circular sin cola el DMA trabaja
+ *          sin ninguna interrupción.
+ */
+
+#include "pwm_wave.h"
+#include "pwm.h"
+#include "nucleo_conf.h"
+#include "system.h"
+#include "prof.h"
+
+#define PWM_WAVE_DMA_CH     2   // Canal del DMA1 asociado a TIM2_UP
+
+// Configuración común del canal: memoria (16 bits) -> TIM2_CCR1 (16 bits), prioridad alta
+#define PWM_WAVE_DMA_CFG    (DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PSIZE_16 | DMA_CCR_MSIZE_16 | DMA_CCR_PL_HIGH)
+
+static const uint16_t *volatile wave_table = 0;     // Tabla en reproducción (0 = parado)
+static volatile pwm_wave_mode_t wave_mode;          // Modo de la tabla en reproducción
+static const uint16_t *volatile next_table = 0;     // Tabla en cola (0 = ninguna)
+static volatile uint16_t next_len = 0;              // Longitud de la tabla en cola
+static volatile pwm_wave_mode_t next_mode;          // Modo de la tabla en cola
+static pwm_wave_done_cb_t wave_done_cb = 0;         // Aviso de tabla terminada
+static uint32_t saved_psc;                          // Preescalador de pwm_timer_init() a restaurar
+static uint32_t saved_arr;                          // Periodo de pwm_timer_init() a restaurar
+
+/**
+ * @brief Programa el canal del DMA con una tabla
+ *
+ * @note Llamar con las interrupciones deshabilitadas o desde la ISR del DMA
+ * @return Ninguno
+ */
+static void pwm_wave_load(const uint16_t *table, uint16_t len, pwm_wave_mode_t mode)
+{
+    uint32_t ccr = PWM_WAVE_DMA_CFG;
+
+    if (mode == PWM_WAVE_CIRCULAR)
+    {
+        ccr |= DMA_CCR_CIRC;
+    }
+    if (mode == PWM_WAVE_ONESHOT || next_table)
+    {
+        ccr |= DMA_CCR_TCIE; // Hay que actuar al terminar la pasada
+    }
+
+    DMA1_CCR(PWM_WAVE_DMA_CH) = 0; // CMAR y CNDTR solo se escriben con el canal deshabilitado
+    DMA1_IFCR = DMA_IFCR_CGIF(PWM_WAVE_DMA_CH);
+    DMA1_CMAR(PWM_WAVE_DMA_CH) = (uint32_t)table;
+    DMA1_CNDTR(PWM_WAVE_DMA_CH) = len;
+    DMA1_CCR(PWM_WAVE_DMA_CH) = ccr | DMA_CCR_EN;
+
+    wave_table = table;
+    wave_mode = mode;
+}
+
+/**
+ * @brief Guarda la base de tiempos de pwm_timer_init() al empezar una reproducción
+ *
+ * @note Llamar con las interrupciones deshabilitadas
+ * @return Ninguno
+ */
+static void pwm_wave_save(void)
+{
+    if (wave_table == 0)
+    {
+        saved_psc = TIM2_PSC;
+        saved_arr = TIM2_ARR;
+    }
+}
+
+/**
+ * @brief Restaura la base de tiempos de pwm_timer_init() y el brillo del LED
+ *
+ * @details PSC, ARR y CCR1 tienen precarga: los tres cambian en la misma
+ *          actualización, sin ningún periodo con el último valor de la tabla aplicado
+ *          sobre el periodo del LED.
+ *
+ * @note Llamar con las interrupciones deshabilitadas o desde la ISR del DMA
+ * @return Ninguno
+ */
+static void pwm_wave_restore(void)
+{
+    TIM2_PSC = saved_psc;
+    TIM2_ARR = saved_arr;
+    pwm_led_refresh();
+}
+
+/**
+ * @brief Conecta TIM2_UP con el canal del DMA ya programado
+ *
+ * @note Llamar con las interrupciones deshabilitadas
+ * @return Ninguno
+ */
+static void pwm_wave_run(void)
+{
+    RCC_AHBENR |= RCC_AHBENR_DMAEN; // Habilitar reloj del DMA1
+    DMA1_CPAR(PWM_WAVE_DMA_CH) = (uint32_t)&TIM2_CCR1;
+    TIM2_DIER |= TIM_DIER_UDE;      // Cada actualización pide un valor al DMA
+    NVIC_ISER = (1U << DMA1_CH2_3_IRQn);
+}
+
+/**
+ * @brief Arranca la reproducción de una tabla de ciclos de trabajo
+ *
+ * @details Sustituye cualquier reproducción en curso y descarta la tabla en cola.
+ *          El primer valor se aplica a partir del segundo periodo PWM. La resolución
+ *          de la tabla es independiente de la del LED (PWM_LED_STEPS): con 48MHz,
+ *          PWM_WAVE_STEPS pasos admiten desde unos 2Hz hasta PWM_WAVE_MAX_RATE.
+ *
+ * @param table Valores de 0 a steps (debe permanecer válida hasta que termine)
+ * @param len Número de valores (1 a 65535)
+ * @param rate_hz Valores por segundo (frecuencia PWM), hasta PWM_WAVE_MAX_RATE; con
+ *                steps pasos el máximo es system_core_clock / steps
+ * @param steps Resolución de la tabla (2 a PWM_MAX_STEPS, p.ej. PWM_WAVE_STEPS)
+ * @param mode Una pasada o circular
+ *
+ * @note El preescalador se redondea al entero más cercano: la frecuencia real puede
+ *       diferir de rate_hz, tanto más cuanto más se acerque a system_core_clock / steps
+ *       (ver el valor devuelto)
+ * @return Frecuencia de actualización real en Hz, o 0 si los parámetros no son válidos
+ */
+uint32_t pwm_wave_start(const uint16_t *table, uint16_t len, uint32_t rate_hz, uint32_t steps,
+                        pwm_wave_mode_t mode)
+{
+    uint32_t ticks;
+    uint32_t psc;
+    uint32_t primask;
+
+    if (table == 0 || len == 0 || rate_hz == 0 || rate_hz > PWM_WAVE_MAX_RATE ||
+        steps < 2 || steps > PWM_MAX_STEPS || pwm_get_steps(PWM_TIM2) == 0)
+    {
+        return 0;
+    }
+
+    ticks = system_core_clock / rate_hz; // Ciclos de reloj por valor de la tabla
+    psc = (ticks + steps / 2) / steps;
+    if (psc == 0 || psc > 0x10000)
+    {
+        return 0;
+    }
+
+    primask = irq_save();
+
+    TIM2_DIER &= ~TIM_DIER_UDE;
+    pwm_wave_save();
+    next_table = 0;
+    pwm_wave_load(table, len, mode);
+
+    TIM2_PSC = psc - 1;
+    TIM2_ARR = steps - 1;
+    TIM2_EGR = TIM_EGR_UG;          // Cargar PSC y ARR y reiniciar el periodo (sin petición DMA)
+    pwm_wave_run();
+
+    irq_restore(primask);
+
+    return system_core_clock / (psc * steps);
+}
+
+/**
+ * @brief Pone una tabla en cola para reproducirla al terminar la actual
+ *
+ * @details En modo de una pasada la tabla en cola empieza justo después del último
+ *          valor de la actual; en modo circular, al terminar la vuelta en curso.
+ *          La tabla en cola conserva la frecuencia y la resolución de la actual; si no
+ *          hay reproducción en curso arranca de inmediato con las de pwm_timer_init().
+ *          Solo hay una posición de cola: una nueva llamada sustituye a la anterior.
+ *
+ * @param table Valores de 0 a la resolución en uso (la de pwm_wave_start() o
+ *              pwm_get_steps(PWM_TIM2) si no hay reproducción)
+ * @param len Número de valores (1 a 65535)
+ * @param mode Modo de la tabla en cola
+ *
+ * @return 1 si se ha encolado o arrancado, 0 si los parámetros no son válidos
+ */
+uint8_t pwm_wave_queue(const uint16_t *table, uint16_t len, pwm_wave_mode_t mode)
+{
+    uint32_t primask;
+
+    if (table == 0 || len == 0)
+    {
+        return 0;
+    }
+
+    primask = irq_save();
+
+    if (wave_table == 0)
+    {
+        pwm_wave_save();
+        pwm_wave_load(table, len, mode);
+        pwm_wave_run();
+    }
+    else
+    {
+        next_table = table;
+        next_len = len;
+        next_mode = mode;
+        DMA1_CCR(PWM_WAVE_DMA_CH) |= DMA_CCR_TCIE; // Avisar al terminar la pasada actual
+    }
+
+    irq_restore(primask);
+
+    return 1;
+}
+
+/**
+ * @brief Detiene la reproducción
+ *
+ * @details La frecuencia y la resolución vuelven a las configuradas con
+ *          pwm_timer_init() y el LED al último brillo de set_led_brightness(), con el
+ *          límite de set_led_limit(). Se descarta la tabla en cola sin llamar al aviso.
+ *
+ * @return Ninguno
+ */
+void pwm_wave_stop(void)
+{
+    uint32_t primask = irq_save();
+
+    TIM2_DIER &= ~TIM_DIER_UDE;
+    DMA1_CCR(PWM_WAVE_DMA_CH) = 0;
+    DMA1_IFCR = DMA_IFCR_CGIF(PWM_WAVE_DMA_CH);
+    if (wave_table)
+    {
+        pwm_wave_restore();
+    }
+    wave_table = 0;
+    next_table = 0;
+
+    irq_restore(primask);
+}
+
+/**
+ * @brief Indica si hay una reproducción en curso
+ *
+ * @return 1 si el DMA está actualizando TIM2_CCR1, 0 si no
+ */
+uint8_t pwm_wave_active(void)
+{
+    return wave_table != 0;
+}
+
+/**
+ * @brief Registra la función que se llama cuando una tabla termina
+ *
+ * @details Se llama desde la ISR del DMA cuando una tabla de una pasada termina o
+ *          cuando la actual se sustituye por la de la cola; a partir de ese momento
+ *          el usuario puede reutilizar su memoria (p.ej. para encolar la siguiente).
+ *
+ * @param cb Función de aviso (0 para ninguna)
+ *
+ * @return Ninguno
+ */
+void pwm_wave_set_callback(pwm_wave_done_cb_t cb)
+{
+    wave_done_cb = cb;
+}
+
+/**
+ * @brief Manejador de interrupciones de los canales 2 y 3 del DMA1
+ *
+ * @details Fin de pasada del canal 2: pasa a la tabla en cola si la hay o, en modo
+ *          de una pasada, detiene las peticiones DMA y restaura la base de tiempos de
+ *          pwm_timer_init() y el brillo del LED.
+ *          El hueco hasta reprogramar el canal es la latencia de esta ISR, muy
+ *          inferior a un periodo PWM.
+ *
+ * @note Definida en el startup del microcontrolador
+ * @return Ninguno
+ */
+RAMFUNC void DMA1_CH2_3_IRQHandler(void)
+{
+    PROF_START(PROF_ISR_DMA1_CH2_3);
+
+    if (DMA1_ISR & DMA_ISR_TCIF(PWM_WAVE_DMA_CH))
+    {
+        const uint16_t *done = wave_table;
+
+        DMA1_IFCR = DMA_IFCR_CGIF(PWM_WAVE_DMA_CH);
+
+        if (next_table)
+        {
+            const uint16_t *table = next_table;
+
+            next_table = 0;
+            pwm_wave_load(table, next_len, next_mode);
+        }
+        else if (wave_mode == PWM_WAVE_ONESHOT)
+        {
+            TIM2_DIER &= ~TIM_DIER_UDE;
+            DMA1_CCR(PWM_WAVE_DMA_CH) = 0;
+            pwm_wave_restore();
+            wave_table = 0;
+        }
+        else
+        {
+            done = 0; // Vuelta de una tabla circular: sigue en reproducción
+        }
+
+        if (done && wave_done_cb)
+        {
+            wave_done_cb(done);
+        }
+    }
+
+    PROF_END(PROF_ISR_DMA1_CH2_3);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file ring_buffer.c
+ * @brief Implementación de un buffer circular de bytes sin bloqueos
+ * @details Buffer circular para un único productor y un único consumidor. El productor
+ *          solo escribe el índice head y el consumidor solo el índice tail, por lo que
+ *          la aplicación y una ISR pueden compartirlo sin deshabilitar interrupciones.
+ */
+
+#include "ring_buffer.h"
+#include "system.h"
+
+// Barrera de compilador: el dato debe quedar escrito/leído antes de publicar el nuevo índice
+#define COMPILER_BARRIER()  __asm volatile ("" ::: "memory")
+
+/**
+ * @brief Inicializa un buffer circular sobre la memoria indicada
+ *
+ * @param rb Buffer circular a inicializar
+ * @param storage Memoria de almacenamiento
+ * @param size Tamaño de la memoria en bytes (potencia de 2, máximo 32768)
+ *
+ * @return Ninguno
+ */
+void ring_init(ring_buffer_t *rb, uint8_t *storage, uint16_t size)
+{
+    rb->buf = storage;
+    rb->mask = size - 1;
+    rb->head = 0;
+    rb->tail = 0;
+}
+
+/**
+ * @brief Inserta un byte en el buffer (lado productor)
+ *
+ * @param rb Buffer circular
+ * @param data Byte a insertar
+ *
+ * @return 1 si se ha insertado, 0 si el buffer estaba lleno
+ */
+RAMFUNC uint8_t ring_push(ring_buffer_t *rb, uint8_t data)
+{
+    uint16_t head = rb->head;
+
+    if ((uint16_t)(head - rb->tail) > rb->mask)
+    {
+        return 0; // Buffer lleno
+    }
+
+    rb->buf[head & rb->mask] = data;
+    COMPILER_BARRIER();
+    rb->head = head + 1; // Publicar el dato al consumidor
+
+    return 1;
+}
+
+/**
+ * @brief Extrae el byte más antiguo del buffer (lado consumidor)
+ *
+ * @param rb Buffer circular
+ * @param data Puntero donde se guarda el byte extraído
+ *
+ * @return 1 si se ha extraído un byte, 0 si el buffer estaba vacío
+ */
+RAMFUNC uint8_t ring_pop(ring_buffer_t *rb, uint8_t *data)
+{
+    uint16_t tail = rb->tail;
+
+    if (tail == rb->head)
+    {
+        return 0; // Buffer vacío
+    }
+
+    *data = rb->buf[tail & rb->mask];
+    COMPILER_BARRIER();
+    rb->tail = tail + 1; // Liberar la posición al productor
+
+    return 1;
+}
+
+/**
+ * @brief Devuelve el número de bytes almacenados en el buffer
+ *
+ * @param rb Buffer circular
+ *
+ * @return Bytes pendientes de leer
+ */
+uint16_t ring_count(const ring_buffer_t *rb)
+{
+    return (uint16_t)(rb->head - rb->tail);
+}
+
+/**
+ * @brief Devuelve el número de bytes libres en el buffer
+ *
+ * @param rb Buffer circular
+ *
+ * @return Bytes que se pueden insertar antes de llenarse
+ */
+uint16_t ring_space(const ring_buffer_t *rb)
+{
+    return (uint16_t)(rb->mask + 1 - (uint16_t)(rb->head - rb->tail));
+}
+
+/**
+ * @brief Devuelve el bloque contiguo de bytes pendientes a partir de tail
+ *
+ * @details Permite al consumidor entregar los datos a un DMA sin copiarlos. El bloque
+ *          termina en el final de la memoria aunque queden más bytes al principio.
+ *
+ * @param rb Buffer circular
+ * @param data Puntero donde se guarda la dirección del primer byte pendiente
+ *
+ * @return Número de bytes contiguos disponibles
+ */
+uint16_t ring_linear_count(const ring_buffer_t *rb, const uint8_t **data)
+{
+    uint16_t tail = rb->tail;
+    uint16_t count = (uint16_t)(rb->head - tail);
+    uint16_t to_end = (uint16_t)(rb->mask + 1 - (tail & rb->mask));
+
+    *data = &rb->buf[tail & rb->mask];
+
+    return (count < to_end) ? count : to_end;
+}
+
+/**
+ * @brief Descarta bytes ya consumidos fuera del buffer (lado consumidor)
+ *
+ * @param rb Buffer circular
+ * @param len Número de bytes a liberar (no mayor que ring_count())
+ *
+ * @return Ninguno
+ */
+void ring_skip(ring_buffer_t *rb, uint16_t len)
+{
+    COMPILER_BARRIER();
+    rb->tail = rb->tail + len;
+}
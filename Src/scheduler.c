@@ -0,0 +1,287 @@
+/**
+ * @file scheduler.c
+ * @brief Planificador cooperativo de tareas basado en msTicks
+ * @details Las tareas son funciones que se ejecutan hasta terminar (run-to-completion)
+ *          desde el bucle principal. Pueden ser periódicas o de un disparo y cada una
+ *          tiene un plazo relativo a su activación. Entre las tareas activadas se
+ *          ejecuta primero la de plazo absoluto más cercano, se mide su tiempo de
+ *          ejecución con micros() para guardar el peor caso y se cuentan los plazos
+ *          incumplidos.
+ *          Ninguna tarea debe esperar de forma activa: el resto de tareas solo se
+ *          ejecutan cuando la actual retorna.
+ */
+
+#include "scheduler.h"
+#include "system.h"
+
+static sched_task_t tasks[SCHED_MAX_TASKS];
+
+/**
+ * @brief Indica si el instante t ya ha llegado
+ *
+ * @details Comparación con signo de la diferencia para que funcione tras el
+ *          desbordamiento de msTicks (cada 49.7 días).
+ *
+ * @return 1 si now >= t
+ */
+static inline uint8_t sched_reached(uint32_t now, uint32_t t)
+{
+    return (int32_t)(now - t) >= 0;
+}
+
+/**
+ * @brief Reserva un hueco de la tabla de tareas
+ *
+ * @return Identificador del hueco o SCHED_NO_TASK si la tabla está llena
+ */
+static int8_t sched_alloc(sched_task_fn_t fn, uint32_t period_ms, uint32_t deadline_ms)
+{
+    if (fn == 0)
+    {
+        return SCHED_NO_TASK;
+    }
+
+    for (int8_t id = 0; id < SCHED_MAX_TASKS; id++)
+    {
+        if (tasks[id].fn == 0)
+        {
+            tasks[id].period = period_ms;
+            tasks[id].deadline = deadline_ms;
+            tasks[id].wcet = 0;
+            tasks[id].runs = 0;
+            tasks[id].misses = 0;
+            tasks[id].armed = 0;
+            tasks[id].fn = fn;
+            return id;
+        }
+    }
+
+    return SCHED_NO_TASK;
+}
+
+/**
+ * @brief Registra una tarea periódica
+ *
+ * @param fn Función de la tarea
+ * @param period_ms Periodo de activación en ms (mayor que 0)
+ * @param offset_ms Retardo hasta la primera activación, para repartir tareas del
+ *                  mismo periodo en ticks distintos
+ * @param deadline_ms Plazo desde cada activación en ms (0 = el periodo)
+ *
+ * @return Identificador de la tarea o SCHED_NO_TASK
+ */
+int8_t sched_add_periodic(sched_task_fn_t fn, uint32_t period_ms, uint32_t offset_ms, uint32_t deadline_ms)
+{
+    int8_t id;
+
+    if (period_ms == 0)
+    {
+        return SCHED_NO_TASK;
+    }
+
+    id = sched_alloc(fn, period_ms, deadline_ms ? deadline_ms : period_ms);
+    if (id != SCHED_NO_TASK)
+    {
+        sched_start(id, offset_ms);
+    }
+
+    return id;
+}
+
+/**
+ * @brief Registra una tarea de un disparo sin activarla
+ *
+ * @details La tarea se activa con sched_start() y, tras ejecutarse, queda registrada
+ *          a la espera de volver a activarse.
+ *
+ * @param fn Función de la tarea
+ * @param deadline_ms Plazo desde la activación en ms
+ *
+ * @return Identificador de la tarea o SCHED_NO_TASK
+ */
+int8_t sched_add_oneshot(sched_task_fn_t fn, uint32_t deadline_ms)
+{
+    return sched_alloc(fn, 0, deadline_ms);
+}
+
+/**
+ * @brief Activa una tarea dentro de delay_ms milisegundos
+ *
+ * @details Sirve para lanzar una tarea de un disparo o reprogramar una periódica.
+ *          Si la tarea ya estaba activada se sustituye la activación pendiente.
+ *
+ * @param id Identificador de la tarea
+ * @param delay_ms Retardo en ms (0 = en la próxima pasada del planificador)
+ *
+ * @note Puede llamarse desde una ISR
+ * @return Ninguno
+ */
+void sched_start(int8_t id, uint32_t delay_ms)
+{
+    uint32_t primask;
+
+    if (id < 0 || id >= SCHED_MAX_TASKS || tasks[id].fn == 0)
+    {
+        return;
+    }
+
+    primask = irq_save();
+    tasks[id].release = msTicks + delay_ms;
+    tasks[id].armed = 1;
+    irq_restore(primask);
+}
+
+/**
+ * @brief Anula la activación pendiente de una tarea sin eliminarla
+ *
+ * @note Puede llamarse desde una ISR
+ * @return Ninguno
+ */
+void sched_cancel(int8_t id)
+{
+    if (id >= 0 && id < SCHED_MAX_TASKS)
+    {
+        tasks[id].armed = 0;
+    }
+}
+
+/**
+ * @brief Elimina una tarea y libera su hueco
+ *
+ * @return Ninguno
+ */
+void sched_remove(int8_t id)
+{
+    if (id >= 0 && id < SCHED_MAX_TASKS)
+    {
+        tasks[id].armed = 0;
+        tasks[id].fn = 0;
+    }
+}
+
+/**
+ * @brief Ejecuta todas las tareas activadas
+ *
+ * @details En cada paso elige, entre las tareas cuya activación ha llegado, la de
+ *          plazo absoluto más cercano y la ejecuta hasta que retorna. Después
+ *          actualiza sus estadísticas y calcula la siguiente activación: una tarea
+ *          periódica conserva su fase salvo que haya perdido un periodo completo, en
+ *          cuyo caso se resincroniza en lugar de ejecutarse varias veces seguidas.
+ *
+ * @return Milisegundos hasta la próxima activación pendiente (UINT32_MAX si no hay
+ *         ninguna), para que el llamador pueda dormir mientras tanto
+ */
+uint32_t sched_dispatch(void)
+{
+    uint32_t now;
+
+    while (1)
+    {
+        int8_t run = SCHED_NO_TASK;
+        uint32_t best = 0;
+        uint32_t primask;
+        uint32_t start, elapsed;
+        sched_task_t *t;
+
+        primask = irq_save();
+        now = msTicks;
+        for (int8_t id = 0; id < SCHED_MAX_TASKS; id++)
+        {
+            t = &tasks[id];
+            if (t->fn && t->armed && sched_reached(now, t->release))
+            {
+                uint32_t left = t->release + t->deadline - now; // Tiempo hasta su plazo absoluto
+
+                if (run == SCHED_NO_TASK || (int32_t)(left - best) < 0)
+                {
+                    run = id;
+                    best = left;
+                }
+            }
+        }
+
+        if (run == SCHED_NO_TASK)
+        {
+            irq_restore(primask);
+            break;
+        }
+
+        t = &tasks[run];
+        start = t->release;               // Activación que se atiende
+        if (t->period)
+        {
+            t->release += t->period;
+            if (sched_reached(now, t->release))
+            {
+                t->release = now + t->period; // Se ha perdido al menos un periodo
+            }
+        }
+        else
+        {
+            t->armed = 0;
+        }
+        irq_restore(primask);
+
+        now = micros();
+        t->fn();
+        elapsed = micros() - now;
+
+        if (elapsed > t->wcet)
+        {
+            t->wcet = elapsed;
+        }
+        if ((int32_t)(msTicks - (start + t->deadline)) > 0)
+        {
+            t->misses++;
+        }
+        t->runs++;
+    }
+
+    return sched_idle_ms();
+}
+
+/**
+ * @brief Devuelve el tiempo hasta la próxima activación pendiente
+ *
+ * @details Para decidir si se puede dormir debe llamarse con las interrupciones
+ *          deshabilitadas, de forma que ninguna ISR active una tarea entre la consulta
+ *          y el WFI (ver system_sleep()).
+ *
+ * @return Milisegundos hasta la próxima activación (0 si alguna tarea ya debe
+ *         ejecutarse, UINT32_MAX si no hay ninguna)
+ */
+uint32_t sched_idle_ms(void)
+{
+    uint32_t next = UINT32_MAX;
+    uint32_t now = msTicks;
+
+    for (int8_t id = 0; id < SCHED_MAX_TASKS; id++)
+    {
+        if (tasks[id].fn && tasks[id].armed)
+        {
+            uint32_t wait = sched_reached(now, tasks[id].release) ? 0 : tasks[id].release - now;
+
+            if (wait < next)
+            {
+                next = wait;
+            }
+        }
+    }
+
+    return next;
+}
+
+/**
+ * @brief Devuelve el estado y las estadísticas de una tarea
+ *
+ * @return Puntero a la tarea o 0 si el identificador no es válido
+ */
+const sched_task_t *sched_task_info(int8_t id)
+{
+    if (id < 0 || id >= SCHED_MAX_TASKS || tasks[id].fn == 0)
+    {
+        return 0;
+    }
+
+    return &tasks[id];
+}
@@ -47,11 +47,24 @@ static uint8_t *__sbrk_heap_end = NULL;
  * NOTE: If the MSP stack, at any point during execution, grows larger than the
  * reserved size, please increase the '_Min_Stack_Size'.
  *
+ * Built with -DHEAP_DISABLE the heap is not available: dynamic memory comes from
+ * the fixed-block pools (mempool.c) and any call that reaches _sbrk (malloc,
+ * printf and other newlib functions) stops at a breakpoint instead of returning,
+ * so hidden heap use is caught the first time it runs.
+ *
  * @param incr Memory size
  * @return Pointer to allocated memory
  */
 void *_sbrk(ptrdiff_t incr)
 {
+#ifdef HEAP_DISABLE
+  (void)incr;
+  (void)__sbrk_heap_end;
+  for (;;)
+  {
+    __asm volatile ("bkpt #0"); /* Without a debugger attached this escalates to HardFault */
+  }
+#else
   extern uint8_t _end; /* Symbol defined in the linker script */
   extern uint8_t _estack; /* Symbol defined in the linker script */
   extern uint32_t _Min_Stack_Size; /* Symbol defined in the linker script */
@@ -76,4 +89,17 @@ void *_sbrk(ptrdiff_t incr)
   __sbrk_heap_end += incr;
 
   return (void *)prev_heap_end;
+#endif /* HEAP_DISABLE */
+}
+
+/**
+ * @brief Returns the number of heap bytes handed out by _sbrk() so far
+ *
+ * @return Bytes between the '_end' linker symbol and the current heap end
+ */
+uint32_t sysmem_heap_used(void)
+{
+  extern uint8_t _end; /* Symbol defined in the linker script */
+
+  return (NULL == __sbrk_heap_end) ? 0 : (uint32_t)(__sbrk_heap_end - &_end);
 }
@@ -6,41 +6,142 @@
  */
 #include "system.h"
 #include "nucleo_conf.h"
+#include "timer_wheel.h"
+#include "memmap.h"
+#include "prof.h"
 
 /** @brief Contador global de milisegundos, incrementado por SysTick_Handler */
 volatile uint32_t msTicks = 0;
 
+/**
+ * @brief Frecuencia actual del reloj del sistema (HCLK = PCLK) en Hz
+ * @details En .noinit porque SystemInit() la fija antes de que el arranque copie .data
+ */
+uint32_t system_core_clock NOINIT;
+
+static uint32_t systick_ms_cycles = 8000;   // Ciclos del SysTick por milisegundo
+static uint32_t systick_max_ms = 2097;      // Mayor reposo que cabe en los 24 bits del contador
+static uint32_t systick_us_q20 = 131072;    // Microsegundos por ciclo en Q20 (1000 / ciclos por ms)
+
+/**
+ * @brief Ejecuta WFI
+ * @details Con PRIMASK activo, una interrupción pendiente despierta al núcleo sin
+ *          ejecutar su ISR, que se atiende al restaurar las interrupciones.
+ * @return Ninguno
+ */
+static inline void cpu_wfi(void)
+{
+#ifdef HOST_SIM
+    sim_wfi();                          // El modelo avanza hasta la siguiente interrupción
+#else
+    __asm volatile ("wfi" ::: "memory");
+#endif
+}
+
 /**
  * @brief Inicializa el temporizador SysTick
  * @details Configura el temporizador SysTick para generar una interrupción cada 1ms
  *          utilizando el reloj del sistema como fuente. El temporizador se configura
- *          para contar 8000 ciclos de reloj, lo que corresponde a 1ms a 8MHz.
+ *          para contar system_core_clock / 1000 ciclos de reloj (8000 a 8MHz).
  * @return Ninguno
  */
 void systick_init(void)
 {
-    SYST_CSR |= SYST_CSR_CLKSOURCE; // Usar el reloj del sistema 8MHz
-    SYST_RVR = 8000 - 1;            // Generar 1 interrupción cada 8000 ciclos
-    SYST_CVR = 0;                   // Reiniciar contador
-    SYST_CSR |= (SYST_CSR_ENABLE | SYST_CSR_TICKINT); // Activar contador y habilitar interrupción cuando llegue a cero
+    systick_ms_cycles = system_core_clock / 1000;
+    systick_max_ms = SYST_RVR_MAX / systick_ms_cycles;
+    systick_us_q20 = (1000UL << 20) / systick_ms_cycles;
+
+    SYSTICK->CSR = SYST_CSR_CLKSOURCE;   // Usar el reloj del sistema, contador parado
+    SYSTICK->RVR = systick_ms_cycles - 1; // Generar 1 interrupción cada milisegundo
+    SYSTICK->CVR = 0;                    // Reiniciar contador
+    SYSTICK->CSR = SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE; // Activar contador e interrupción al llegar a cero
 }
 
 /**
  * @brief Manejador de interrupciones para SysTick
  * @details Esta función es llamada cuando el temporizador SysTick llega a cero.
- *          Incrementa el contador global msTicks.
+ *          Incrementa el contador global msTicks y avanza la rueda de temporizadores.
  * @note Definida en el startup del microcontrolador
  * @return Ninguno
  */
-void SysTick_Handler(void)
+RAMFUNC void SysTick_Handler(void)
+{
+    PROF_START(PROF_ISR_SYSTICK);
+    timer_wheel_tick(++msTicks);
+    STACK_GUARD_CHECK();
+    PROF_END(PROF_ISR_SYSTICK);
+}
+
+/**
+ * @brief Lee msTicks y la posición del SysTick dentro del milisegundo actual
+ * @details Si el contador llega a 0 entre las dos lecturas, o se llama con las
+ *          interrupciones deshabilitadas y hay un tick pendiente, PENDSTSET indica que
+ *          msTicks aún no lo ha contado: se suma y se vuelve a leer SYST_CVR, que ya
+ *          pertenece al nuevo milisegundo. El reposo sin tick conserva la fase de los
+ *          ticks, por lo que la posición es válida también justo después de despertar.
+ * @param ms Puntero donde se guarda el número de milisegundos
+ * @return Ciclos transcurridos desde el inicio del milisegundo (0 a ciclos por ms - 1)
+ */
+static uint32_t systick_read(uint32_t *ms)
+{
+    uint32_t primask = irq_save();
+    uint32_t t = msTicks;
+    uint32_t cvr = SYST_CVR;
+
+    if (SCB_ICSR & SCB_ICSR_PENDSTSET)
+    {
+        t++;
+        cvr = SYST_CVR;
+    }
+    irq_restore(primask);
+
+    *ms = t;
+    if (cvr >= systick_ms_cycles)
+    {
+        return 0; // Periodo alargado durante system_sleep()
+    }
+    return systick_ms_cycles - 1 - cvr;
+}
+
+/**
+ * @brief Devuelve una marca de tiempo en ciclos del reloj del sistema
+ * @details msTicks * ciclos por ms + ciclos transcurridos en el milisegundo actual.
+ *          El Cortex-M0 no tiene contador de ciclos DWT; la resolución es de un ciclo
+ *          del SysTick (el reloj del sistema). El valor da la vuelta cada 2^32 ciclos
+ *          (89s a 48MHz), por lo que debe usarse para medir intervalos con una resta
+ *          sin signo.
+ * @note Puede llamarse desde una ISR
+ * @return Ciclos desde el arranque del SysTick, módulo 2^32
+ */
+uint32_t timestamp_cycles(void)
 {
-    ++msTicks;
+    uint32_t ms;
+    uint32_t cycles = systick_read(&ms);
+
+    return ms * systick_ms_cycles + cycles;
+}
+
+/**
+ * @brief Devuelve una marca de tiempo en microsegundos
+ * @details La fracción del milisegundo actual se convierte a microsegundos con un
+ *          factor Q20 calculado en systick_init(), sin divisiones. Da la vuelta cada
+ *          2^32 us (71 minutos).
+ * @note Puede llamarse desde una ISR
+ * @return Microsegundos desde el arranque del SysTick, módulo 2^32
+ */
+uint32_t micros(void)
+{
+    uint32_t ms;
+    uint32_t cycles = systick_read(&ms);
+
+    return ms * 1000 + ((cycles * systick_us_q20) >> 20);
 }
 
 /**
  * @brief Genera un retardo en milisegundos
  * @details Utiliza el temporizador SysTick para crear un retardo bloqueante
- *          durante el número de milisegundos especificado.
+ *          durante el número de milisegundos especificado. Entre ticks el núcleo
+ *          espera en WFI en lugar de sondear el contador.
  * @param ms Número de milisegundos para el retardo
  * @return Ninguno
  */
@@ -49,10 +150,199 @@ void delay_ms(uint32_t ms)
     uint32_t start_ticks = msTicks;    // Captura el valor inicial del contador global
                                        // Esta referencia nos permite medir tiempo relativo
     
-    while ((msTicks - start_ticks) < ms);  // Bucle de espera bloqueante
-                                           // Comprueba continuamente la diferencia entre
-                                           // el valor actual y el valor inicial
-                                           // Sale cuando han pasado 'ms' milisegundos
+    while ((msTicks - start_ticks) < ms)   // Bucle de espera bloqueante
+    {                                      // Comprueba en cada interrupción la diferencia entre
+        cpu_wfi();                         // el valor actual y el valor inicial
+    }                                      // Sale cuando han pasado 'ms' milisegundos
+}
+
+/**
+ * @brief Rearranca el SysTick con el siguiente tick dentro de left ciclos
+ * @details El contador carga left - 1 y, una vez cargado, se escribe el periodo normal
+ *          en SYST_RVR para que la siguiente recarga vuelva a ser de 1 ms.
+ * @param left Ciclos hasta el próximo tick (al menos SYSTICK_SLEEP_GUARD)
+ * @return Ninguno
+ */
+static void systick_restart(uint32_t left)
+{
+    SYST_CSR = SYST_CSR_CLKSOURCE;
+    SYST_RVR = left - 1;
+    SYST_CVR = 0;
+    SYST_CSR = SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE;
+    HW_WAIT_WHILE(SYST_CVR == 0);       // Esperar a que cargue el valor corto
+    SYST_RVR = systick_ms_cycles - 1;
+}
+
+/**
+ * @brief Duerme el núcleo hasta la próxima interrupción o durante max_ms milisegundos
+ * @details Reposo sin tick (tickless): si no hay nada que hacer durante al menos
+ *          SYSTICK_SLEEP_MIN_MS, el SysTick se reprograma para interrumpir justo en el
+ *          límite del próximo vencimiento (el menor entre max_ms, la rueda de
+ *          temporizadores y el máximo de 24 bits) y el núcleo entra en Sleep con WFI.
+ *          Cualquier interrupción (UART, DMA del ADC o de la UART, SysTick) lo despierta.
+ *          Al despertar se cuentan los milisegundos transcurridos a partir de SYST_CVR,
+ *          se suman a msTicks avanzando la rueda ranura a ranura y el SysTick vuelve a
+ *          1 ms conservando la fase de los ticks. Con reposos más cortos se usa un WFI
+ *          sin reprogramar el SysTick.
+ *          Se usa Sleep y no Stop: en Stop se detienen los relojes de USART2, del ADC y
+ *          del SysTick, y en el STM32F070 ninguno de ellos puede despertar al núcleo.
+ * @param max_ms Tiempo máximo de reposo en ms (0 = no dormir), p.ej. sched_idle_ms()
+ * @note Debe llamarse con las interrupciones deshabilitadas (irq_save) después de
+ *       comprobar que no hay trabajo pendiente; las interrupciones que lleguen mientras
+ *       tanto despiertan al núcleo y se atienden al restaurarlas
+ * @return Ninguno
+ */
+void system_sleep(uint32_t max_ms)
+{
+    uint32_t n, cur, load, v, left, ms_done;
+
+    if (max_ms == 0)
+    {
+        return;
+    }
+
+    SCB_SCR &= ~SCB_SCR_SLEEPDEEP;      // WFI entra en Sleep
+
+    n = timer_wheel_next_expiry(max_ms < systick_max_ms ? max_ms : systick_max_ms);
+    if (n < SYSTICK_SLEEP_MIN_MS || SYST_CVR < SYSTICK_SLEEP_GUARD || (SCB_ICSR & SCB_ICSR_PENDSTSET))
+    {
+        cpu_wfi();                      // Reposo corto o tick inminente: el próximo tick despierta
+        return;
+    }
+
+    // Alargar el periodo actual hasta el límite del n-ésimo tick
+    SYST_CSR = SYST_CSR_CLKSOURCE;      // Parar el contador para leer un valor estable
+    cur = SYST_CVR;
+    load = cur + (n - 1) * systick_ms_cycles - SYSTICK_RESTART_CYCLES;
+    SYST_RVR = load - 1;
+    SYST_CVR = 0;
+    SYST_CSR = SYST_CSR_CLKSOURCE | SYST_CSR_TICKINT | SYST_CSR_ENABLE;
+
+    cpu_wfi();
+
+    v = SYST_CVR;
+    ms_done = n;                        // Marca: aún sin calcular
+    if (v != 0 && !(SCB_ICSR & SCB_ICSR_PENDSTSET))
+    {
+        // Despertado antes: los límites de tick están en v = k * systick_ms_cycles
+        uint32_t q = (v - 1) / systick_ms_cycles;
+        uint32_t boundary = q * systick_ms_cycles;
+        uint32_t v2 = SYST_CVR;
+
+        if (v2 <= v && !(SCB_ICSR & SCB_ICSR_PENDSTSET)) // Sin recarga durante el cálculo
+        {
+            ms_done = n - 1 - q;
+            left = (v2 > boundary + SYSTICK_SLEEP_GUARD) ? v2 - boundary : SYSTICK_SLEEP_GUARD;
+        }
+    }
+
+    if (ms_done == n)
+    {
+        // Reposo completo: la ISR pendiente cuenta el último tick
+        ms_done = n - 1;
+        v = SYST_CVR;                   // Leído tras la recarga: ciclos desde el vencimiento
+        left = systick_ms_cycles - (load - 1 - v);
+        if ((int32_t)left < SYSTICK_SLEEP_GUARD)
+        {
+            left = SYSTICK_SLEEP_GUARD;
+        }
+    }
+
+    systick_restart(left > SYSTICK_RESTART_CYCLES + SYSTICK_SLEEP_GUARD ? left - SYSTICK_RESTART_CYCLES : left);
+
+    while (ms_done--)
+    {
+        timer_wheel_tick(++msTicks);    // Ticks que no han generado interrupción
+    }
+}
+
+/**
+ * @brief Selecciona el HSI como reloj del sistema y desactiva el PLL
+ * @details Paso previo a cualquier cambio de perfil: el PLL no puede reconfigurarse
+ *          mientras está activo o siendo usado como reloj del sistema.
+ * @return Ninguno
+ */
+static void clk_switch_to_hsi(void)
+{
+	RCC_CR |= RCC_CR_HSION;             // Configura el reloj del sistema a 8MHz
+
+	HW_WAIT_WHILE(!(RCC_CR & RCC_CR_HSIRDY)); // Esperar a que el oscilador sea estable
+
+	REG_MODIFY(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_HSI); // Seleccionar el HSI como reloj del sistema 8MHz
+
+	HW_WAIT_WHILE((RCC_CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI); // Esperar confirmacion
+
+	RCC_CR &= ~RCC_CR_PLLON;            // Asegurar que PLL este desactivado
+	HW_WAIT_WHILE(RCC_CR & RCC_CR_PLLRDY); // Esperar a que se detenga
+}
+
+/**
+ * @brief Configura el reloj del sistema según el perfil indicado
+ * @details Perfiles disponibles:
+ *          - CLK_PROFILE_HSI_8MHZ: HSI directo, 0 estados de espera en Flash.
+ *          - CLK_PROFILE_HSI_PLL_48MHZ: HSI/2 x 12 = 48MHz, 1 estado de espera y prefetch.
+ *          - CLK_PROFILE_HSE_BYPASS_48MHZ: reloj de 8MHz del MCO del ST-LINK en OSC_IN
+ *            (HSE en bypass) x 6 = 48MHz, más preciso que el HSI para la UART.
+ *          Los buses AHB y APB quedan sin división, por lo que system_core_clock es
+ *          también el reloj de los periféricos (USART2, TIM2, SysTick).
+ *          La latencia de la Flash se aumenta antes de subir la frecuencia y se reduce
+ *          después de bajarla.
+ * @param profile Perfil de reloj a aplicar
+ * @note systick_init(), uart_conf() y pwm_led_init() calculan sus divisores a partir de
+ *       system_core_clock, por lo que deben llamarse después de cambiar de perfil
+ * @return 1 si se ha aplicado el perfil, 0 si el HSE no arrancó (se queda en HSI 8MHz)
+ */
+uint8_t clk_set_profile(clk_profile_t profile)
+{
+	uint32_t pll_cfg;
+
+	clk_switch_to_hsi();
+	RCC_CR &= ~(RCC_CR_HSEON | RCC_CR_HSEBYP); // HSE apagado salvo que el perfil lo use
+	REG_MODIFY(RCC->CFGR, RCC_CFGR_HPRE | RCC_CFGR_PPRE, 0); // AHB y APB sin división
+	FLASH_ACR = FLASH_ACR_PRFTBE;                  // 0 estados de espera a 8MHz
+	system_core_clock = 8000000;
+
+	if (profile == CLK_PROFILE_HSI_8MHZ)
+	{
+		return 1;
+	}
+
+	if (profile == CLK_PROFILE_HSE_BYPASS_48MHZ)
+	{
+		uint32_t timeout = CLK_HSE_TIMEOUT;
+
+		RCC_CR |= RCC_CR_HSEBYP;            // El bypass debe activarse con el HSE apagado
+		RCC_CR |= RCC_CR_HSEON;
+		while (!(RCC_CR & RCC_CR_HSERDY))   // Esperar el reloj externo con límite
+		{
+			HW_POLL();
+			if (--timeout == 0)
+			{
+				RCC_CR &= ~(RCC_CR_HSEON | RCC_CR_HSEBYP);
+				return 0;                   // Sin MCO (p.ej. SB16/SB50 abiertos): seguir en HSI
+			}
+		}
+
+		RCC_CFGR2 &= ~RCC_CFGR2_PREDIV;     // HSE / 1
+		pll_cfg = RCC_CFGR_PLLSRC | RCC_CFGR_PLLMUL6; // 8MHz x 6 = 48MHz
+	}
+	else
+	{
+		pll_cfg = RCC_CFGR_PLLMUL12;        // HSI/2 (4MHz) x 12 = 48MHz
+	}
+
+	FLASH_ACR = FLASH_ACR_PRFTBE | FLASH_ACR_LATENCY; // 1 estado de espera para 24-48MHz
+
+	REG_MODIFY(RCC->CFGR, RCC_CFGR_PLLSRC | RCC_CFGR_PLLMUL, pll_cfg);
+
+	RCC_CR |= RCC_CR_PLLON;             // Encender el PLL
+	HW_WAIT_WHILE(!(RCC_CR & RCC_CR_PLLRDY)); // Esperar a que enganche
+
+	REG_MODIFY(RCC->CFGR, RCC_CFGR_SW, RCC_CFGR_SW_PLL); // Seleccionar el PLL
+	HW_WAIT_WHILE((RCC_CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL); // Esperar confirmacion
+
+	system_core_clock = 48000000;
+	return 1;
 }
 
 /**
@@ -65,15 +355,17 @@ void delay_ms(uint32_t ms)
  */
 void clk_conf(void)
 {
-    
-	RCC_CR |= RCC_CR_HSION;             // Configura el reloj del sistema a 8MHz
-
-	while (!(RCC_CR & RCC_CR_HSIRDY));  // Esperar a que el oscilador sea estable
-
-	RCC_CFGR &= ~RCC_CFGR_SW;           // Limpiar bits de seleccion de la fuente
-	RCC_CFGR |= RCC_CFGR_SW_HSI;        // Seleccionar el HSI como reloj del sistema 8MHz
-
-	while ((RCC_CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_HSI); // Esperar confirmacion
+	clk_set_profile(CLK_PROFILE_HSI_8MHZ);
+}
 
-	//RCC_CR &= ~(1UL << 24);           // Asegurar que PLL este desactivado
+/**
+ * @brief Configura el reloj del sistema nada más salir del reset
+ * @details Llamada desde Reset_Handler antes de copiar .data y poner a cero .bss, de modo
+ *          que esas copias y todo main() se ejecutan ya a 48MHz (CLK_BOOT_PROFILE). Solo
+ *          puede usar registros y variables NOINIT como system_core_clock.
+ * @return Ninguno
+ */
+void SystemInit(void)
+{
+	clk_set_profile(CLK_BOOT_PROFILE);
 }
@@ -0,0 +1,144 @@
+/**
+ * @file telemetry.c
+ * @brief Tramas binarias de telemetría sobre la UART
+ * @details Formato de trama (multibyte en little-endian):
+ *
+ *          | 0xAA | 0x55 | len | type | seq | payload (len bytes) | CRC16 |
+ *
+ *          El CRC16-CCITT (polinomio 0x1021, valor inicial 0xFFFF) cubre desde len
+ *          hasta el final de la carga útil; el receptor se resincroniza buscando el
+ *          sincronismo y descartando las tramas cuyo CRC no coincide. seq aumenta en
+ *          una unidad por trama enviada, de forma que el receptor detecta pérdidas.
+ *          La cabecera, la carga útil y el CRC se escriben directamente en el buffer de
+ *          transmisión de la UART, sin formatear texto ni copiar la trama a un buffer
+ *          intermedio. Una trama que no cabe entera en el buffer se descarta completa.
+ */
+
+#include "telemetry.h"
+#include "uart.h"
+
+static uint8_t tlm_seq = 0;             // Número de secuencia de la próxima trama
+static uint32_t tlm_dropped_frames = 0; // Tramas descartadas por falta de espacio
+
+// CRC16-CCITT de cada nibble: 32 bytes de Flash en lugar de los 512 de una tabla por byte
+static const uint16_t crc16_nibble[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/**
+ * @brief Actualiza un CRC16-CCITT con un bloque de datos
+ *
+ * @param crc Valor previo (0xFFFF para empezar)
+ * @param data Datos
+ * @param len Número de bytes
+ *
+ * @return CRC actualizado
+ */
+uint16_t tlm_crc16(uint16_t crc, const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        crc = (uint16_t)(crc << 4) ^ crc16_nibble[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (uint16_t)(crc << 4) ^ crc16_nibble[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Envía una trama de telemetría
+ *
+ * @param type Tipo de trama
+ * @param payload Carga útil (puede ser 0 si len es 0)
+ * @param len Longitud de la carga útil (hasta TLM_MAX_PAYLOAD)
+ *
+ * @note No bloquea: si el buffer de transmisión no tiene sitio para la trama
+ *       completa se descarta y se contabiliza en tlm_dropped()
+ * @return 1 si la trama se ha encolado, 0 si se ha descartado
+ */
+uint8_t tlm_send(tlm_type_t type, const uint8_t *payload, uint8_t len)
+{
+    uint8_t header[5];
+    uint8_t crc_le[2];
+    uint16_t crc;
+
+    if (len > TLM_MAX_PAYLOAD || uart_tx_space() < (uint16_t)(len + TLM_OVERHEAD))
+    {
+        ++tlm_dropped_frames;
+        return 0;
+    }
+
+    header[0] = TLM_SYNC0;
+    header[1] = TLM_SYNC1;
+    header[2] = len;
+    header[3] = (uint8_t)type;
+    header[4] = tlm_seq++;
+
+    crc = tlm_crc16(0xFFFF, &header[2], 3);
+    crc = tlm_crc16(crc, payload, len);
+    crc_le[0] = (uint8_t)crc;
+    crc_le[1] = (uint8_t)(crc >> 8);
+
+    uart_write(header, sizeof(header));
+    uart_write(payload, len);
+    uart_write(crc_le, sizeof(crc_le));
+
+    return 1;
+}
+
+/**
+ * @brief Envía una trama con la temperatura y la tensión de alimentación
+ *
+ * @param mdeg Temperatura en milésimas de grado Celsius
+ * @param vdd_mv Tensión de alimentación en mV
+ *
+ * @return 1 si la trama se ha encolado, 0 si se ha descartado
+ */
+uint8_t tlm_send_temperature(int32_t mdeg, uint16_t vdd_mv)
+{
+    uint8_t payload[6];
+
+    payload[0] = (uint8_t)mdeg;
+    payload[1] = (uint8_t)(mdeg >> 8);
+    payload[2] = (uint8_t)(mdeg >> 16);
+    payload[3] = (uint8_t)(mdeg >> 24);
+    payload[4] = (uint8_t)vdd_mv;
+    payload[5] = (uint8_t)(vdd_mv >> 8);
+
+    return tlm_send(TLM_TYPE_TEMPERATURE, payload, sizeof(payload));
+}
+
+/**
+ * @brief Envía un bloque de muestras del ADC
+ *
+ * @details El Cortex-M0 es little-endian, por lo que las muestras se envían
+ *          directamente desde su memoria (p.ej. la mitad del buffer ping-pong que
+ *          entrega adc_sampling_start()).
+ *
+ * @param samples Muestras de 16 bits
+ * @param count Número de muestras (hasta TLM_MAX_PAYLOAD / 2)
+ *
+ * @return 1 si la trama se ha encolado, 0 si se ha descartado
+ */
+uint8_t tlm_send_samples(const uint16_t *samples, uint8_t count)
+{
+    if (count > TLM_MAX_PAYLOAD / 2)
+    {
+        ++tlm_dropped_frames;
+        return 0;
+    }
+
+    return tlm_send(TLM_TYPE_SAMPLES, (const uint8_t *)samples, (uint8_t)(count * 2));
+}
+
+/**
+ * @brief Devuelve el número de tramas descartadas
+ *
+ * @return Tramas descartadas desde el arranque
+ */
+uint32_t tlm_dropped(void)
+{
+    return tlm_dropped_frames;
+}
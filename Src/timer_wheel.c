@@ -0,0 +1,246 @@
+/**
+ * @file timer_wheel.c
+ * @brief Rueda de temporizadores software sobre SysTick
+ * @details Rueda con TIMER_WHEEL_SLOTS ranuras de 1 ms. Cada temporizador se guarda en
+ *          una lista doblemente enlazada de la ranura (vencimiento & (SLOTS - 1)), por lo
+ *          que armar, cancelar y rearmar cuestan O(1) sin importar cuántos temporizadores
+ *          haya pendientes. En cada tick solo se recorre la ranura actual; los
+ *          temporizadores de más de SLOTS ms permanecen en ella hasta que su vencimiento
+ *          coincide con msTicks.
+ *          Al vencer, un temporizador llama a su función y/o marca bits en una
+ *          palabra de eventos que la aplicación consulta desde sus tareas.
+ */
+
+#include "timer_wheel.h"
+#include "system.h"
+
+static soft_timer_t *wheel[TIMER_WHEEL_SLOTS]; // Cabeza de la lista de cada ranura
+
+/**
+ * @brief Inserta un temporizador en la ranura de su vencimiento
+ *
+ * @note Debe llamarse con las interrupciones deshabilitadas
+ * @return Ninguno
+ */
+static void timer_link(soft_timer_t *t)
+{
+    soft_timer_t **head = &wheel[t->expires & (TIMER_WHEEL_SLOTS - 1)];
+
+    t->prev = 0;
+    t->next = *head;
+    if (*head)
+    {
+        (*head)->prev = t;
+    }
+    *head = t;
+    t->armed = 1;
+}
+
+/**
+ * @brief Saca un temporizador de su ranura
+ *
+ * @note Debe llamarse con las interrupciones deshabilitadas
+ * @return Ninguno
+ */
+static void timer_unlink(soft_timer_t *t)
+{
+    if (t->prev)
+    {
+        t->prev->next = t->next;
+    }
+    else
+    {
+        wheel[t->expires & (TIMER_WHEEL_SLOTS - 1)] = t->next;
+    }
+
+    if (t->next)
+    {
+        t->next->prev = t->prev;
+    }
+
+    t->next = 0;
+    t->prev = 0;
+    t->armed = 0;
+}
+
+/**
+ * @brief Inicializa un temporizador desarmado
+ *
+ * @param t Temporizador
+ * @param cb Función a llamar al vencer (0 si solo se usan eventos)
+ *
+ * @return Ninguno
+ */
+void timer_init(soft_timer_t *t, timer_callback_t cb)
+{
+    t->next = 0;
+    t->prev = 0;
+    t->expires = 0;
+    t->period = 0;
+    t->cb = cb;
+    t->events = 0;
+    t->event_mask = 0;
+    t->armed = 0;
+}
+
+/**
+ * @brief Asocia al temporizador bits de una palabra de eventos
+ *
+ * @details Al vencer se hace *events |= mask antes de llamar a la función. La
+ *          aplicación debe limpiar los bits con las interrupciones deshabilitadas.
+ *
+ * @param t Temporizador
+ * @param events Palabra de eventos (0 para no usar eventos)
+ * @param mask Bits a activar
+ *
+ * @return Ninguno
+ */
+void timer_set_event(soft_timer_t *t, volatile uint32_t *events, uint32_t mask)
+{
+    t->events = events;
+    t->event_mask = mask;
+}
+
+/**
+ * @brief Arma o rearma un temporizador
+ *
+ * @details Si ya estaba armado se cancela el vencimiento anterior.
+ *
+ * @param t Temporizador
+ * @param delay_ms Tiempo hasta el vencimiento en ms (0 se trata como 1: el próximo tick)
+ * @param period_ms Periodo de rearme automático en ms (0 = un disparo)
+ *
+ * @note Puede llamarse desde una ISR o desde la función de otro temporizador
+ * @return Ninguno
+ */
+void timer_arm(soft_timer_t *t, uint32_t delay_ms, uint32_t period_ms)
+{
+    uint32_t primask = irq_save();
+
+    if (t->armed)
+    {
+        timer_unlink(t);
+    }
+
+    t->expires = msTicks + (delay_ms ? delay_ms : 1);
+    t->period = period_ms;
+    timer_link(t);
+
+    irq_restore(primask);
+}
+
+/**
+ * @brief Cancela un temporizador armado
+ *
+ * @note Puede llamarse desde una ISR o desde la función de otro temporizador
+ * @return Ninguno
+ */
+void timer_cancel(soft_timer_t *t)
+{
+    uint32_t primask = irq_save();
+
+    if (t->armed)
+    {
+        timer_unlink(t);
+    }
+
+    irq_restore(primask);
+}
+
+/**
+ * @brief Indica si el temporizador está pendiente de vencer
+ *
+ * @return 1 si está armado, 0 si no
+ */
+uint8_t timer_armed(const soft_timer_t *t)
+{
+    return t->armed;
+}
+
+/**
+ * @brief Devuelve el tiempo hasta el próximo vencimiento
+ *
+ * @details Recorre todos los temporizadores armados, por lo que cuesta O(N). Solo se
+ *          usa en el camino de reposo (system_sleep), donde la CPU no tiene otra cosa
+ *          que hacer; el tick y las operaciones de armado siguen siendo O(1).
+ *
+ * @param limit Valor máximo a devolver en ms
+ *
+ * @note Debe llamarse con las interrupciones deshabilitadas
+ * @return Milisegundos hasta el próximo vencimiento (al menos 1), o limit si no hay
+ *         ninguno antes
+ */
+uint32_t timer_wheel_next_expiry(uint32_t limit)
+{
+    uint32_t now = msTicks;
+
+    for (uint8_t slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+    {
+        for (const soft_timer_t *t = wheel[slot]; t; t = t->next)
+        {
+            uint32_t left = t->expires - now;
+
+            if (left < limit)
+            {
+                limit = left ? left : 1;
+            }
+        }
+    }
+
+    return limit;
+}
+
+/**
+ * @brief Avanza la rueda un tick y dispara los temporizadores vencidos
+ *
+ * @details Cada temporizador vencido se saca de la ranura (los periódicos se vuelven a
+ *          insertar con el siguiente vencimiento) antes de dispararlo, y la búsqueda se
+ *          reinicia después de cada disparo. Así las funciones pueden armar o cancelar
+ *          cualquier temporizador, incluido el propio, sin romper el recorrido de la
+ *          lista, y un temporizador cancelado por otro del mismo tick ya no se dispara.
+ *          El recorrido se hace con las interrupciones deshabilitadas, que se habilitan
+ *          durante cada llamada.
+ *
+ * @param now Valor de msTicks del tick actual
+ *
+ * @note Se llama desde SysTick_Handler; las funciones de los temporizadores se
+ *       ejecutan en contexto de interrupción y deben ser breves
+ * @return Ninguno
+ */
+RAMFUNC void timer_wheel_tick(uint32_t now)
+{
+    uint32_t primask = irq_save(); // Otra ISR puede armar o cancelar durante el recorrido
+    soft_timer_t *t = wheel[now & (TIMER_WHEEL_SLOTS - 1)];
+
+    while (t)
+    {
+        if (t->expires != now)
+        {
+            t = t->next; // Vence en otra vuelta de la rueda
+            continue;
+        }
+
+        timer_unlink(t);
+        if (t->period)
+        {
+            t->expires = now + t->period;
+            timer_link(t);
+        }
+
+        if (t->events)
+        {
+            *t->events |= t->event_mask;
+        }
+        irq_restore(primask);
+
+        if (t->cb)
+        {
+            t->cb(t);
+        }
+
+        primask = irq_save();
+        t = wheel[now & (TIMER_WHEEL_SLOTS - 1)]; // La función ha podido modificar la ranura
+    }
+
+    irq_restore(primask);
+}
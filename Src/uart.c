@@ -4,11 +4,89 @@
  * @details Contiene las funciones para configurar y utilizar la comunicación serie UART
  *          a través del periférico USART2 del microcontrolador STM32F070RB.
  *          La comunicación está configurada para 9600 baudios, 8 bits de datos, 
- *          sin paridad y 1 bit de parada (8N1).
+ *          sin paridad y 1 bit de parada (8N1). La velocidad puede cambiarse en
+ *          ejecución con uart_set_baud(), que calcula BRR a partir del reloj real.
+ *          La transmisión no es bloqueante: los datos se copian a un buffer circular
+ *          que la interrupción de USART2 vacía byte a byte (TXE) hasta completar (TC).
+ *          La recepción se almacena desde la interrupción RXNE en una FIFO, de modo
+ *          que no se pierden bytes aunque la aplicación tarde en leerlos.
+ *          En modo DMA el buffer se entrega por bloques al canal 4 del DMA1 y la
+ *          recepción se realiza con el canal 5 en modo circular y detección de línea
+ *          inactiva, sin trabajo de la CPU por cada byte.
  */
 
 #include "uart.h"
 #include "nucleo_conf.h"
+#include "system.h"
+#include "ring_buffer.h"
+#include "prof.h"
+
+static uint8_t tx_storage[UART_TX_BUF_SIZE];        // Memoria del buffer de transmisión
+static ring_buffer_t tx_ring;                       // Bytes pendientes de enviar por la ISR
+static uart_tx_policy_t tx_policy = UART_TX_BLOCK;  // Política con el buffer lleno
+static volatile uint32_t tx_dropped = 0;            // Bytes descartados por buffer lleno
+static volatile uint8_t tx_active = 0;              // 1 mientras queden bytes por transmitir
+static volatile uart_mode_t uart_mode = UART_MODE_IRQ; // Mecanismo de transferencia activo
+
+static volatile uint16_t dma_tx_len = 0;            // Bytes de la transferencia DMA en curso (0 = DMA libre)
+static volatile uint8_t dma_tx_zero_copy = 0;       // 1 si la transferencia en curso es el buffer de usuario
+static const uint8_t *volatile zc_buf = 0;          // Buffer de usuario pendiente o en transmisión
+static volatile uint16_t zc_len = 0;                // Longitud del buffer de usuario
+static volatile uint16_t zc_mark = 0;               // Posición del buffer circular donde se intercala
+static uart_tx_release_cb_t tx_release_cb = 0;      // Aviso de liberación del buffer de usuario
+
+static uint8_t rx_dma_buf[UART_RX_DMA_SIZE];        // Buffer circular escrito por el DMA
+static uint32_t rx_dma_read = 0;                    // Bytes leídos de rx_dma_buf (módulo 2^32)
+static volatile uint32_t rx_dma_laps = 0;           // Vueltas completas del DMA sobre rx_dma_buf
+static volatile uint8_t rx_idle = 0;                // 1 al detectar línea inactiva tras una ráfaga
+
+static uint8_t rx_storage[UART_RX_BUF_SIZE];        // Memoria de la FIFO de recepción
+static ring_buffer_t rx_ring;                       // Bytes recibidos por la ISR pendientes de leer
+static volatile uint32_t rx_overruns = 0;           // Bytes perdidos (overrun hardware o FIFO llena)
+
+static uint32_t uart_baud = UART_BAUD_DEFAULT;      // Velocidad configurada en baudios
+
+/**
+ * @brief Calcula BRR y el modo de sobremuestreo para una velocidad dada
+ *
+ * @details USART2 está en APB, que funciona a system_core_clock. Con sobremuestreo
+ *          x16 USARTDIV = fck / baud debe ser >= 16; si no lo es se usa x8, donde
+ *          USARTDIV = 2 * fck / baud y BRR[2:0] = USARTDIV[3:0] >> 1 (BRR[3] = 0).
+ *          El divisor se redondea al entero más cercano para minimizar el error.
+ *
+ * @param baud Velocidad deseada en baudios
+ * @param brr Valor calculado para USART_BRR
+ * @param over8 USART_CR1_OVER8 si se necesita sobremuestreo x8, 0 si no
+ *
+ * @return 1 si la velocidad es alcanzable, 0 si está fuera de rango
+ */
+static uint8_t uart_calc_brr(uint32_t baud, uint32_t *brr, uint32_t *over8)
+{
+    uint32_t div;
+
+    if (baud == 0)
+    {
+        return 0;
+    }
+
+    div = (system_core_clock + baud / 2) / baud; // USARTDIV con sobremuestreo x16
+    if (div >= 16)
+    {
+        *brr = div;
+        *over8 = 0;
+        return (div <= 0xFFFF) ? 1 : 0;
+    }
+
+    div = (2 * system_core_clock + baud / 2) / baud; // USARTDIV con sobremuestreo x8
+    if (div < 16)
+    {
+        return 0; // Por encima de fck / 8
+    }
+
+    *brr = (div & 0xFFF0) | ((div & 0x000F) >> 1);
+    *over8 = USART_CR1_OVER8;
+    return 1;
+}
 
 /**
  * @brief Configura el periférico UART2 para comunicación serie
@@ -19,87 +97,681 @@
  *          3. Habilita el reloj para el periférico USART2
  *          4. Configura USART2 para comunicación 8N1 a 9600 baudios
  *          5. Habilita transmisión y recepción
- *          6. Activa el periférico USART2
+ *          6. Activa el periférico USART2 y sus interrupciones (RXNE) en el NVIC
  *
- * @note La velocidad de comunicación está configurada para 9600 baudios con
- *       un reloj del sistema de 8MHz
+ * @note La velocidad inicial es UART_BAUD_DEFAULT (9600 baudios) y BRR se calcula
+ *       a partir de system_core_clock, por lo que clk_set_profile() debe llamarse antes
  * 
  * @return Ninguno
  */
 void uart_conf()
 {
-    RCC_AHBENR |= (1 << 17);    // Activar reloj GPIOA
-    
-    GPIOA_MODER &= ~(3 << 4);   // Limpiar PA2 (TX)
-    GPIOA_MODER |= (2 << 4);    // Settear modo funcion alternativa en PA2
-    GPIOA_AFRL &= ~(0xF << 8);  // Limpiar bits del 8 al 11
-    GPIOA_AFRL |= (1 << 8);     // Activar AF1 para PA2
-    
-    GPIOA_MODER &= ~(3 << 6);   // Limpiar PA3 (RX)
-    GPIOA_MODER |= (2 << 6);    // Settear modo funcion alternativa en PA3
-    GPIOA_AFRL &= ~(0xF << 12); // Limpiar bits del 12 a 15
-    GPIOA_AFRL |= (1 << 12);    // Activar AF1 para PA3
-    
+    ring_init(&tx_ring, tx_storage, UART_TX_BUF_SIZE);
+    ring_init(&rx_ring, rx_storage, UART_RX_BUF_SIZE);
 
-    RCC_APB1ENR |= (1 << 17);   // Habilitar reloj UART2
-    
-    USART_CR1 &= ~(1 << 0);     // Desactivar UART
-    
-    USART_CR1 &= ~(1 << 15);    // Sobremuestreo a 16 bits
-    
-    // Longitud de palabra: 8 bits (M[1:0] = 00) - bits 12 y 28 en CR1
-    USART_CR1 &= ~(1 << 12);    // M0 = 0
-    USART_CR1 &= ~(1 << 28);    // M1 = 0
-    
-    USART_CR1 &= ~(1 << 10);    // Bit de paridad desactivado
-    
-    // Bits de parada: 1 bit de parada (STOP = 00) - bits 12-13 en CR2
-    USART_CR2 &= ~(3 << 12);    // STOP[1:0] = 00
-    
-    USART_BRR = 0x341;          // BRR 9600 @ 8Mhz
+    RCC_AHBENR |= RCC_AHBENR_GPIOAEN;   // Activar reloj GPIOA
+
+    // PA2 (TX) y PA3 (RX) en función alternativa AF1: una escritura por registro
+    REG_MODIFY(GPIOA->MODER, GPIO_MODER_MODE(2) | GPIO_MODER_MODE(3),
+               GPIO_MODER_VAL(2, GPIO_MODE_AF) | GPIO_MODER_VAL(3, GPIO_MODE_AF));
+    REG_MODIFY(GPIOA->AFR[0], GPIO_AFR_AF(2) | GPIO_AFR_AF(3),
+               GPIO_AFR_VAL(2, 1) | GPIO_AFR_VAL(3, 1));
+
+    RCC_APB1ENR |= RCC_APB1ENR_USART2EN; // Habilitar reloj UART2
+
+    USART2->CR1 = 0;            // Desactivar UART: 8 bits de datos (M1:M0 = 00), sin paridad
+    REG_MODIFY(USART2->CR2, USART_CR2_STOP, FIELD(USART_CR2_STOP, 0)); // 1 bit de parada
+
+    uint32_t brr = 0, over8 = 0; // uart_baud siempre es válida (la comprueba uart_set_baud)
+    uart_calc_brr(uart_baud, &brr, &over8);
+    USART2->BRR = brr;          // BRR 9600 @ 8Mhz = 0x341
                                 // Resumen del formato:
                                 // 8 Bits de datos - Sin paridad - 1 bit de parada -
                                 // 9600 baudios - 16 bits de sobremuestreo
 
-    USART_CR1 |= (1 << 3);      // Activar transmision
-    
-    USART_CR1 |= (1 << 2);      // Activar recepcion
+    // Sobremuestreo x16 salvo velocidades altas, transmisión, recepción e interrupción
+    // por cada byte recibido hacia la FIFO. OVER8 solo se puede cambiar con UE = 0,
+    // por eso el USART se activa en una segunda escritura
+    USART2->CR1 = over8 | USART_CR1_TE | USART_CR1_RE | USART_CR1_RXNEIE;
+    USART2->CR1 |= USART_CR1_UE; // Activar UART2
 
-    USART_CR1 |= (1 << 0);      // Activar UART2  
+    NVIC_ISER = (1U << USART2_IRQn); // Habilitar la interrupción de USART2
+}
+
+/**
+ * @brief Cambia la velocidad de comunicación de USART2
+ *
+ * @details Espera a que termine la transmisión en curso, desactiva el USART para
+ *          poder cambiar OVER8 y BRR, y lo vuelve a activar. A 48MHz se pueden usar
+ *          velocidades como 921600 (x16, error 0.16%) o 1000000 baudios (x16, exacto).
+ *
+ * @param baud Velocidad en baudios (hasta system_core_clock / 8)
+ *
+ * @return 1 si se ha aplicado, 0 si la velocidad no es alcanzable con el reloj actual
+ */
+uint8_t uart_set_baud(uint32_t baud)
+{
+    uint32_t brr, over8;
+
+    if (!uart_calc_brr(baud, &brr, &over8))
+    {
+        return 0;
+    }
+
+    uart_flush();
+
+    USART_CR1 &= ~USART_CR1_UE;                          // OVER8 solo se puede cambiar con UE = 0
+    USART_CR1 = (USART_CR1 & ~USART_CR1_OVER8) | over8;
+    USART_BRR = brr;
+    USART_CR1 |= USART_CR1_UE;
+
+    uart_baud = baud;
+    return 1;
+}
+
+/**
+ * @brief Devuelve la velocidad de comunicación configurada
+ *
+ * @return Velocidad en baudios
+ */
+uint32_t uart_get_baud(void)
+{
+    return uart_baud;
+}
+
+/**
+ * @brief Programa en el canal 4 del DMA el siguiente bloque a transmitir
+ *
+ * @details Los bytes del buffer circular anteriores a un buffer de usuario se envían
+ *          antes que él para conservar el orden. Si no queda nada por enviar se
+ *          habilita la interrupción TC para detectar el final del último byte.
+ *
+ * @note Debe llamarse desde la ISR o con las interrupciones deshabilitadas
+ * @return Ninguno
+ */
+static void uart_dma_tx_next(void)
+{
+    const uint8_t *data;
+    uint16_t len;
+
+    if (zc_buf && tx_ring.tail == zc_mark)
+    {
+        data = zc_buf;          // Turno del buffer de usuario, sin copia
+        len = zc_len;
+        dma_tx_zero_copy = 1;
+    }
+    else
+    {
+        len = ring_linear_count(&tx_ring, &data);
+        if (zc_buf && len > (uint16_t)(zc_mark - tx_ring.tail))
+        {
+            len = (uint16_t)(zc_mark - tx_ring.tail); // No adelantar bytes posteriores al buffer de usuario
+        }
+        dma_tx_zero_copy = 0;
+    }
+
+    if (len == 0)
+    {
+        USART_CR1 |= USART_CR1_TCIE; // Nada más que enviar: esperar fin del último byte
+        return;
+    }
+
+    USART_CR1 &= ~USART_CR1_TCIE;
+    dma_tx_len = len;
+    DMA1_CMAR(4) = (uint32_t)data;
+    DMA1_CNDTR(4) = len;
+    DMA1_CCR(4) = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_TCIE | DMA_CCR_EN;
+}
+
+/**
+ * @brief Finaliza la transferencia DMA de transmisión y lanza la siguiente
+ *
+ * @details Libera los bytes enviados del buffer circular o, si se trataba de un
+ *          buffer de usuario, lo marca como liberado y avisa al callback registrado.
+ *
+ * @note Debe llamarse desde la ISR o con las interrupciones deshabilitadas
+ * @return Ninguno
+ */
+static void uart_dma_tx_complete(void)
+{
+    DMA1_IFCR = DMA_IFCR_CGIF(4);
+    DMA1_CCR(4) &= ~DMA_CCR_EN;
+
+    if (dma_tx_zero_copy)
+    {
+        const uint8_t *released = zc_buf;
+
+        zc_buf = 0;
+        dma_tx_zero_copy = 0;
+        if (tx_release_cb)
+        {
+            tx_release_cb(released);
+        }
+    }
+    else
+    {
+        ring_skip(&tx_ring, dma_tx_len);
+    }
+
+    dma_tx_len = 0;
+    uart_dma_tx_next();
+}
+
+/**
+ * @brief Pone en marcha el vaciado del buffer de transmisión
+ *
+ * @details En modo interrupción habilita TXE; en modo DMA programa un bloque si el
+ *          canal está libre. Se ejecuta con las interrupciones deshabilitadas porque
+ *          las ISR también modifican USART_CR1 y tx_active.
+ *
+ * @return Ninguno
+ */
+static void uart_tx_start(void)
+{
+    uint32_t primask = irq_save();
+
+    tx_active = 1;
+    if (uart_mode == UART_MODE_DMA)
+    {
+        if (dma_tx_len == 0)
+        {
+            uart_dma_tx_next();
+        }
+    }
+    else
+    {
+        USART_CR1 |= USART_CR1_TXEIE;
+    }
+
+    irq_restore(primask);
+}
+
+/**
+ * @brief Avanza la transmisión por sondeo
+ *
+ * @details Se usa cuando las ISR de USART2 y DMA no pueden ejecutarse (llamada desde
+ *          otra ISR o con interrupciones deshabilitadas) y hay que esperar espacio.
+ *          En modo interrupción envía un byte; en modo DMA espera el fin del bloque.
+ *
+ * @return Ninguno
+ */
+static void uart_tx_poll(void)
+{
+    uint8_t c;
+
+    if (uart_mode == UART_MODE_DMA)
+    {
+        if (dma_tx_len == 0)
+        {
+            uart_dma_tx_next();
+            return;
+        }
+        HW_WAIT_WHILE(!(DMA1_ISR & DMA_ISR_TCIF(4))); // Esperar fin del bloque en curso
+        uart_dma_tx_complete();
+        return;
+    }
+
+    HW_WAIT_WHILE(!(USART_ISR & USART_ISR_TXE)); // Esperar a que TDR quede libre
+
+    if (ring_pop(&tx_ring, &c))
+    {
+        USART_TDR = c;
+    }
+}
+
+/**
+ * @brief Inserta un byte en el buffer de transmisión aplicando la política configurada
+ *
+ * @note En modo DMA los bytes más antiguos pueden estar siendo leídos por el DMA,
+ *       por lo que UART_TX_OVERWRITE se comporta como UART_TX_BLOCK.
+ *
+ * @param c Byte a transmitir
+ *
+ * @return Ninguno
+ */
+static void uart_tx_put(uint8_t c)
+{
+    while (!ring_push(&tx_ring, c))
+    {
+        HW_POLL();
+        if (tx_policy == UART_TX_DROP)
+        {
+            ++tx_dropped; // Descartar el byte nuevo
+            return;
+        }
+        else if (tx_policy == UART_TX_OVERWRITE && uart_mode != UART_MODE_DMA)
+        {
+            uint8_t oldest;
+            uint32_t primask = irq_save(); // La ISR también extrae bytes del buffer
+
+            if (ring_pop(&tx_ring, &oldest))
+            {
+                ++tx_dropped; // Descartar el byte más antiguo
+            }
+
+            irq_restore(primask);
+        }
+        else if (irq_blocked())
+        {
+            uart_tx_poll(); // Sin ISR disponible: liberar espacio por sondeo
+        }
+        else
+        {
+            uart_tx_start(); // Asegurar que la ISR está vaciando el buffer y esperar
+        }
+    }
 }
 
 /**
  * @brief Envía una cadena de caracteres por UART
  *
- * @details Transmite cada carácter de la cadena de forma secuencial
- *          y espera a que cada transmisión se complete antes de
- *          enviar el siguiente carácter.
+ * @details Copia la cadena en el buffer de transmisión y habilita la interrupción
+ *          de USART2, que se encarga de enviar los caracteres en segundo plano.
  *
  * @param str Puntero a la cadena de caracteres a enviar (terminada en NULL)
  *
- * @note Esta función es bloqueante, no retorna hasta que todos los
- *       caracteres hayan sido transmitidos.
+ * @note Solo bloquea si el buffer se llena y la política es UART_TX_BLOCK.
  *
  * @return Ninguno
  */
 void uart_send_string(const char *str)
 {
+    PROF_START(PROF_UART_SEND_STRING);
+
     // Recorre cada carácter de la cadena hasta encontrar el terminador nulo
     for (int i = 0; str[i]; i++)
     {
-        // Envía el carácter actual al registro de transmisión
-        USART_TDR = str[i];
-        
-        // Espera hasta que el bit TXE indique que el registro está vacío y listo para enviar
-        while (!(USART_ISR & (1 << 7)));
+        uart_tx_put((uint8_t)str[i]);
     }
+
+    uart_tx_start();
+    PROF_END(PROF_UART_SEND_STRING);
+}
+
+/**
+ * @brief Envía un único carácter por UART
+ *
+ * @param c Carácter a enviar
+ *
+ * @return Ninguno
+ */
+void uart_send_char(char c)
+{
+    uart_tx_put((uint8_t)c);
+    uart_tx_start();
+}
+
+/**
+ * @brief Envía un bloque de bytes por UART
+ *
+ * @details Igual que uart_send_string() pero con longitud explícita, de forma que
+ *          el bloque puede contener bytes nulos.
+ *
+ * @param data Puntero a los datos a enviar
+ * @param len Número de bytes a enviar
+ *
+ * @return Ninguno
+ */
+void uart_write(const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        uart_tx_put(data[i]);
+    }
+
+    uart_tx_start();
+}
+
+/**
+ * @brief Selecciona la política a aplicar cuando el buffer de transmisión está lleno
+ *
+ * @param policy UART_TX_BLOCK, UART_TX_DROP o UART_TX_OVERWRITE
+ *
+ * @return Ninguno
+ */
+void uart_set_tx_policy(uart_tx_policy_t policy)
+{
+    tx_policy = policy;
+}
+
+/**
+ * @brief Devuelve el número de bytes descartados por tener el buffer lleno
+ *
+ * @return Bytes descartados desde el arranque
+ */
+uint32_t uart_tx_dropped(void)
+{
+    return tx_dropped;
+}
+
+/**
+ * @brief Devuelve el espacio libre en el buffer de transmisión
+ *
+ * @details Permite a un productor escribir un mensaje completo o ninguno en lugar de
+ *          depender de la política de buffer lleno.
+ *
+ * @return Bytes que se pueden escribir sin esperar ni descartar
+ */
+uint16_t uart_tx_space(void)
+{
+    return ring_space(&tx_ring);
+}
+
+/**
+ * @brief Indica si hay una transmisión en curso
+ *
+ * @return 1 si quedan bytes en el buffer o en el registro de desplazamiento, 0 si no
+ */
+uint8_t uart_tx_busy(void)
+{
+    return tx_active;
+}
+
+/**
+ * @brief Espera a que se hayan transmitido todos los bytes pendientes
+ *
+ * @return Ninguno
+ */
+void uart_flush(void)
+{
+    if (irq_blocked())
+    {
+        while (ring_count(&tx_ring) || dma_tx_len || zc_buf)
+        {
+            uart_tx_poll();
+        }
+        HW_WAIT_WHILE(!(USART_ISR & USART_ISR_TC)); // Esperar a que salga el último bit
+        return;
+    }
+
+    HW_WAIT_WHILE(tx_active);
+}
+
+/**
+ * @brief Entrega un buffer al DMA para transmitirlo sin copiarlo
+ *
+ * @details El buffer pertenece al driver hasta que uart_tx_buffer_released() devuelve 1
+ *          o se llama al callback de liberación. Solo admite un buffer a la vez. Fuera
+ *          del modo DMA los datos se copian al buffer circular y se liberan al instante.
+ *
+ * @param buf Datos a transmitir (deben seguir válidos hasta su liberación)
+ * @param len Número de bytes a transmitir (mayor que 0)
+ *
+ * @return 1 si el buffer se ha aceptado, 0 si ya hay otro buffer en curso
+ */
+uint8_t uart_send_buffer(const uint8_t *buf, uint16_t len)
+{
+    if (uart_mode != UART_MODE_DMA)
+    {
+        uart_write(buf, len);
+        if (tx_release_cb)
+        {
+            tx_release_cb(buf);
+        }
+        return 1;
+    }
+
+    uint32_t primask = irq_save();
+
+    if (zc_buf)
+    {
+        irq_restore(primask);
+        return 0;
+    }
+
+    zc_mark = tx_ring.head; // Se enviará tras los bytes ya encolados
+    zc_len = len;
+    zc_buf = buf;
+
+    irq_restore(primask);
+
+    uart_tx_start();
+    return 1;
+}
+
+/**
+ * @brief Indica si un buffer entregado con uart_send_buffer() puede reutilizarse
+ *
+ * @param buf Buffer a comprobar
+ *
+ * @return 1 si el driver ya no lo usa, 0 si está pendiente o en transmisión
+ */
+uint8_t uart_tx_buffer_released(const uint8_t *buf)
+{
+    return (zc_buf != buf) ? 1 : 0;
+}
+
+/**
+ * @brief Registra la función a la que se avisa al liberar un buffer de usuario
+ *
+ * @param cb Callback (se ejecuta en la ISR del DMA) o 0 para desactivarlo
+ *
+ * @return Ninguno
+ */
+void uart_set_tx_release_callback(uart_tx_release_cb_t cb)
+{
+    tx_release_cb = cb;
+}
+
+/**
+ * @brief Selecciona el mecanismo de transferencia de USART2
+ *
+ * @details UART_MODE_IRQ transmite byte a byte desde la ISR de USART2 y recibe en
+ *          la FIFO con la interrupción RXNE. UART_MODE_DMA transmite por bloques con el canal 4 del DMA1
+ *          y recibe con el canal 5 en modo circular sobre rx_dma_buf, usando la
+ *          interrupción de línea inactiva para señalar el final de cada ráfaga.
+ *
+ * @param mode UART_MODE_IRQ o UART_MODE_DMA
+ *
+ * @note Espera a que termine la transmisión en curso. Al salir del modo DMA se
+ *       descartan los bytes recibidos que no se hayan leído.
+ * @return Ninguno
+ */
+void uart_set_mode(uart_mode_t mode)
+{
+    uart_flush();
+
+    uint32_t primask = irq_save();
+
+    DMA1_CCR(4) = 0;
+    DMA1_CCR(5) = 0;
+
+    if (mode == UART_MODE_DMA)
+    {
+        RCC_AHBENR |= RCC_AHBENR_DMAEN; // Habilitar reloj del DMA1
+
+        DMA1_CPAR(4) = (uint32_t)&USART_TDR; // TX: memoria -> TDR, se programa por bloque
+
+        DMA1_IFCR = DMA_IFCR_CGIF(5);
+        DMA1_CPAR(5) = (uint32_t)&USART_RDR; // RX: RDR -> rx_dma_buf en modo circular
+        DMA1_CMAR(5) = (uint32_t)rx_dma_buf;
+        DMA1_CNDTR(5) = UART_RX_DMA_SIZE;
+        DMA1_CCR(5) = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_TCIE | DMA_CCR_EN; // TC: una vuelta
+        rx_dma_read = 0;
+        rx_dma_laps = 0;
+
+        USART_ICR = USART_ICR_IDLECF | USART_ICR_ORECF;
+        USART_CR3 |= USART_CR3_DMAT | USART_CR3_DMAR | USART_CR3_EIE;
+        USART_CR1 = (USART_CR1 & ~USART_CR1_RXNEIE) | USART_CR1_IDLEIE; // El DMA lee RDR
+
+        NVIC_ISER = (1U << DMA1_CH4_5_IRQn); // Habilitar la interrupción de los canales 4 y 5
+    }
+    else
+    {
+        USART_CR3 &= ~(USART_CR3_DMAT | USART_CR3_DMAR | USART_CR3_EIE);
+        USART_CR1 = (USART_CR1 & ~USART_CR1_IDLEIE) | USART_CR1_RXNEIE;
+    }
+
+    uart_mode = mode;
+
+    irq_restore(primask);
+}
+
+/**
+ * @brief Indica si la línea RX ha quedado inactiva tras recibir datos
+ *
+ * @details Solo en modo DMA. Permite procesar una ráfaga de comandos completa en
+ *          lugar de comprobar byte a byte. El flag se limpia al leerlo.
+ *
+ * @return 1 si se ha detectado línea inactiva desde la última consulta, 0 si no
+ */
+uint8_t uart_rx_idle(void)
+{
+    uint8_t idle = rx_idle;
+
+    rx_idle = 0;
+    return idle;
+}
+
+/**
+ * @brief Manejador de interrupciones de USART2
+ *
+ * @details Con TXE escribe en TDR el siguiente byte del buffer. Cuando el buffer
+ *          queda vacío cambia a la interrupción TC para detectar el final de la
+ *          transmisión del último byte. Con RXNE guarda el byte recibido en la FIFO.
+ *          En modo DMA atiende además la detección de línea inactiva. Los errores de
+ *          overrun se limpian y se contabilizan en ambos modos.
+ *
+ * @note Definida en el startup del microcontrolador
+ * @return Ninguno
+ */
+RAMFUNC void USART2_IRQHandler(void)
+{
+    PROF_START(PROF_ISR_USART2);
+    uint32_t isr = USART_ISR;
+    uint32_t cr1 = USART_CR1;
+
+    if ((cr1 & USART_CR1_RXNEIE) && (isr & USART_ISR_RXNE))
+    {
+        if (!ring_push(&rx_ring, (uint8_t)USART_RDR)) // La lectura de RDR limpia RXNE
+        {
+            ++rx_overruns; // FIFO llena: el byte se pierde
+        }
+    }
+
+    if ((cr1 & USART_CR1_TXEIE) && (isr & USART_ISR_TXE))
+    {
+        uint8_t c;
+
+        if (ring_pop(&tx_ring, &c))
+        {
+            USART_TDR = c; // La escritura en TDR limpia también el flag TC
+        }
+        else
+        {
+            USART_CR1 = (cr1 & ~USART_CR1_TXEIE) | USART_CR1_TCIE; // Esperar fin del último byte
+        }
+    }
+    else if ((cr1 & USART_CR1_TCIE) && (isr & USART_ISR_TC))
+    {
+        USART_CR1 = cr1 & ~USART_CR1_TCIE;
+        if (dma_tx_len == 0)
+        {
+            tx_active = 0;
+        }
+    }
+
+    if ((cr1 & USART_CR1_IDLEIE) && (isr & USART_ISR_IDLE))
+    {
+        USART_ICR = USART_ICR_IDLECF;
+        rx_idle = 1; // Fin de ráfaga: los datos ya están en rx_dma_buf
+    }
+
+    if (isr & USART_ISR_ORE)
+    {
+        USART_ICR = USART_ICR_ORECF;
+        ++rx_overruns; // Llegó un byte antes de leer el anterior
+    }
+
+    PROF_END(PROF_ISR_USART2);
+}
+
+/**
+ * @brief Manejador de interrupciones de los canales 4 y 5 del DMA1
+ *
+ * @details Atiende el fin de cada bloque de transmisión. El canal 5 (recepción)
+ *          funciona en modo circular y solo interrumpe al completar cada vuelta, para
+ *          contarlas (uart_rx_dma_sync()).
+ *
+ * @note Definida en el startup del microcontrolador
+ * @return Ninguno
+ */
+RAMFUNC void DMA1_CH4_5_IRQHandler(void)
+{
+    PROF_START(PROF_ISR_DMA1_CH4_5);
+
+    if (DMA1_ISR & DMA_ISR_TCIF(4))
+    {
+        uart_dma_tx_complete();
+    }
+
+    if (DMA1_ISR & DMA_ISR_TCIF(5))
+    {
+        DMA1_IFCR = DMA_IFCR_CGIF(5);
+        ++rx_dma_laps;
+    }
+
+    PROF_END(PROF_ISR_DMA1_CH4_5);
+}
+
+/**
+ * @brief Redirige la salida estándar de newlib (printf, puts...) al buffer de UART
+ *
+ * @details Sustituye la implementación débil de syscalls.c.
+ *
+ * @param file Descriptor de fichero (ignorado)
+ * @param ptr Datos a escribir
+ * @param len Número de bytes
+ *
+ * @return Número de bytes aceptados
+ */
+int _write(int file, char *ptr, int len)
+{
+    (void)file;
+    uart_write((const uint8_t *)ptr, (uint16_t)len);
+    return len;
+}
+
+/**
+ * @brief Devuelve los bytes recibidos por DMA sin leer, descontando los perdidos
+ *
+ * @details El total escrito por el DMA son las vueltas contadas por la ISR más la
+ *          posición actual; una vuelta cuyo TC aún no se ha atendido se reconoce por el
+ *          flag pendiente con la posición ya en la primera mitad. Si el DMA ha
+ *          adelantado a la lectura en más de un buffer, los bytes sobrescritos se suman
+ *          a rx_overruns y la lectura salta al byte más antiguo que sigue en el buffer.
+ *
+ * @note Llamar con las interrupciones deshabilitadas
+ * @return Bytes pendientes de leer en rx_dma_buf (hasta UART_RX_DMA_SIZE)
+ */
+static uint16_t uart_rx_dma_sync(void)
+{
+    uint16_t head = UART_RX_DMA_SIZE - DMA1_CNDTR(5); // Posición que escribirá el DMA
+    uint32_t laps = rx_dma_laps;
+    uint32_t unread;
+
+    if ((DMA1_ISR & DMA_ISR_TCIF(5)) && head < UART_RX_DMA_SIZE / 2)
+    {
+        laps++; // Vuelta completada que la ISR aún no ha contado
+    }
+
+    unread = laps * UART_RX_DMA_SIZE + head - rx_dma_read;
+    if (unread > UART_RX_DMA_SIZE)
+    {
+        rx_overruns += unread - UART_RX_DMA_SIZE; // El DMA ha dado la vuelta sobre bytes sin leer
+        rx_dma_read += unread - UART_RX_DMA_SIZE;
+        unread = UART_RX_DMA_SIZE;
+    }
+
+    return (uint16_t)unread;
 }
 
 /**
  * @brief Recibe un carácter por UART si hay datos disponibles
  *
- * @details Comprueba si hay datos disponibles en el buffer de recepción
- *          y devuelve el carácter recibido si existe.
+ * @details Comprueba si hay datos disponibles en la FIFO de recepción
+ *          y devuelve el carácter recibido si existe. En modo DMA lee del
+ *          buffer circular que escribe el canal 5.
  *
  * @note Esta función no es bloqueante. Si no hay datos disponibles,
  *       devuelve 0 inmediatamente.
@@ -108,11 +780,26 @@ void uart_send_string(const char *str)
  */
 char uart_receive_char(void)
 {
-    // Verifica si hay datos disponibles (bit RXNE activado)
-    if (USART_ISR & (1 << 5))
+    if (uart_mode == UART_MODE_DMA)
+    {
+        uint32_t primask = irq_save();
+        char c = 0;
+
+        if (uart_rx_dma_sync())
+        {
+            c = (char)rx_dma_buf[rx_dma_read & (UART_RX_DMA_SIZE - 1)];
+            rx_dma_read++;
+        }
+        irq_restore(primask);
+        return c;
+    }
+
+    uint8_t c;
+
+    // Extrae el byte más antiguo de la FIFO que llena la ISR
+    if (ring_pop(&rx_ring, &c))
     {
-        // Lee y retorna el carácter recibido
-        return (char)USART_RDR;
+        return (char)c;
     }
     
     // Si no hay datos, retorna 0
@@ -122,13 +809,35 @@ char uart_receive_char(void)
 /**
  * @brief Comprueba si hay datos disponibles para leer en el UART
  *
- * @details Verifica el bit RXNE (Read data register not empty)
- *          en el registro de estado USART_ISR.
+ * @details Devuelve el número de bytes almacenados en la FIFO de recepción.
+ *          En modo DMA calcula los bytes pendientes en el buffer circular.
+ *
+ * @return Número de bytes disponibles para leer (0 si no hay ninguno)
+ */
+uint16_t uart_data_available(void)
+{
+    if (uart_mode == UART_MODE_DMA)
+    {
+        uint32_t primask = irq_save();
+        uint16_t n = uart_rx_dma_sync();
+
+        irq_restore(primask);
+        return n;
+    }
+
+    return ring_count(&rx_ring);
+}
+
+/**
+ * @brief Devuelve el número de bytes recibidos que se han perdido
+ *
+ * @details Incluye los overrun del hardware (un byte llegó sin haber leído el
+ *          anterior), los bytes descartados por tener la FIFO llena y, en modo DMA,
+ *          los sobrescritos por el DMA antes de leerlos (contados en la siguiente lectura).
  *
- * @return 1 si hay datos disponibles para leer, 0 en caso contrario
+ * @return Bytes perdidos desde el arranque
  */
-uint8_t uart_data_available(void)
+uint32_t uart_rx_overruns(void)
 {
-    // Retorna 1 si hay datos disponibles (bit RXNE activado), 0 en caso contrario
-    return (USART_ISR & (1 << 5)) ? 1 : 0;
+    return rx_overruns;
 }
@@ -41,6 +41,8 @@ defined in linker script */
 .word _sbss
 /* end address for the .bss section. defined in linker script */
 .word _ebss
+/* start address of the reserved stack. defined in linker script */
+.word _sstack
 
 /**
  * @brief  This is the code that gets called when the processor first
@@ -57,10 +59,12 @@ defined in linker script */
 Reset_Handler:
   ldr   r0, =_estack
   mov   sp, r0          /* set stack pointer */
-/* Call the clock system initialization function.*/
+/* Call the clock system initialization function (system.c): the PLL is running
+   before the copy loops below, so the whole boot runs at 48MHz. SystemInit may
+   only touch registers and .noinit variables. */
   bl  SystemInit
 
-/* Copy the data segment initializers from flash to SRAM */
+/* Copy the data segment initializers from flash to SRAM (including the .ramfunc code) */
   ldr r0, =_sdata
   ldr r1, =_edata
   ldr r2, =_sidata
@@ -91,6 +95,21 @@ LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
 
+/* Paint the reserved stack up to the current SP with MEMMAP_STACK_PAINT (memmap.h)
+   so that its high-water mark and the guard canary can be checked at run time. */
+  ldr r2, =_sstack
+  ldr r3, =0xC5C5C5C5
+  mov r4, sp
+  b LoopPaintStack
+
+PaintStack:
+  str r3, [r2]
+  adds r2, r2, #4
+
+LoopPaintStack:
+  cmp r2, r4
+  bcc PaintStack
+
 /* Call static constructors */
   bl __libc_init_array
 /* Call the application's entry point.*/
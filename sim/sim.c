@@ -0,0 +1,1260 @@
+/**
+ * @file sim.c
+ * @brief Modelo de periféricos del STM32F070RB para la compilación en el host
+ * @details Implementa sobre sim_hw el comportamiento que usan los drivers de Src/:
+ *          SysTick (recarga, CVR reiniciado por escritura, PENDSTSET), NVIC (prioridad
+ *          por número de excepción, sin anidamiento), RCC (flags RDY y SWS), USART2
+ *          (registro de desplazamiento y TDR con la temporización de BRR, RX con
+ *          overrun y línea inactiva), DMA1 (canales normales y circulares, HT/TC), ADC
+ *          (calibración, secuencias de CHSELR, modo continuo, disparo por TIM3 y
+ *          watchdog analógico) y las
+ *          actualizaciones de TIM2 (peticiones DMA) y TIM3 (TRGO).
+ *          El tiempo virtual se cuenta en ciclos del reloj del sistema, que se deduce del
+ *          estado del RCC, y solo avanza en sim_poll() y sim_wfi() (ver sim.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "sim.h"
+#include "nucleo_conf.h"
+#include "system.h"
+#include "adc.h"
+#include "memmap.h"
+#include "uart.h"
+
+#define SIM_NEVER           UINT64_MAX
+#define SIM_TDR_EMPTY       0xFFFFFFFFUL    // TDR sin escribir desde el último paso del modelo
+#define SIM_DMA_CHANNELS    7
+
+#define SIM_EXC_SYSTICK     15              // Número de excepción del SysTick
+#define SIM_EXC_IRQ0        16              // Número de excepción de la IRQ 0
+
+// Bits del modelo que nucleo_conf.h no define
+#define SIM_ADC_ISR_ADRDY   (0x1U << 0)
+#define SIM_ADC_ISR_EOC     (0x1U << 2)
+#define SIM_ADC_ISR_EOS     (0x1U << 3)
+#define SIM_ADC_ISR_OVR     (0x1U << 4)
+#define SIM_ADC_CFGR1_SCANDIR (0x1U << 2)
+#define SIM_ADC_CFGR2_CKMODE  (0x3U << 30)
+#define SIM_DMA_CCR_TEIE    (0x1U << 3)
+#define SIM_DMA_CCR_PINC    (0x1U << 6)
+#define SIM_TIM_SR_UIF      (0x1U << 0)
+#define SIM_TIM_CR2_MMS     (0x7U << 4)
+#define SIM_USART_ISR_RESET (USART_ISR_TXE | USART_ISR_TC)
+
+sim_hw_t sim_hw;
+
+static uint64_t now = 0;                // Ciclos virtuales desde sim_reset()
+static uint32_t primask = 0;            // PRIMASK.PM
+static uint32_t ipsr = 0;               // Excepción en curso (0 = modo thread)
+static uint32_t nvic_enabled = 0;       // Interrupciones habilitadas en el NVIC
+static uint8_t hse_present = 1;         // MCO del ST-LINK conectado
+static sim_idle_hook_t idle_hook = 0;
+static uint8_t in_hook = 0;             // Gancho de inactividad en ejecución
+static uint32_t handlers_run = 0;       // Manejadores ejecutados desde sim_reset()
+
+static uint16_t adc_raw[ADC_SCAN_MAX_CHANNELS]; // Resultado de cada canal del ADC
+
+// SysTick
+static struct
+{
+    uint8_t running;        // CSR.ENABLE en el último paso
+    uint8_t pending;        // Excepción pendiente (PENDSTSET)
+    uint32_t cvr;           // Valor publicado en CVR (para detectar escrituras)
+    uint32_t frozen;        // Valor con el contador parado
+    uint64_t zero_at;       // Ciclo en que el contador llega a 0
+} st;
+
+// USART2
+static struct
+{
+    uint32_t isr;           // Flags de USART_ISR
+    uint8_t shift_busy;     // Registro de desplazamiento enviando shift_byte
+    uint8_t shift_byte;
+    uint64_t shift_done;    // Fin del byte en curso
+    uint8_t hold_valid;     // TDR lleno (TXE = 0)
+    uint8_t hold_byte;
+    uint8_t rx_queue[SIM_UART_RX_QUEUE]; // Bytes que llegarán por RX
+    uint16_t rx_head;
+    uint16_t rx_tail;
+    uint64_t rx_next;       // Llegada del siguiente byte
+    uint64_t idle_at;       // Detección de línea inactiva
+    char tx_log[SIM_UART_TX_LOG]; // Bytes transmitidos
+    uint32_t tx_head;
+    uint32_t tx_tail;
+    uint8_t echo;           // Copiar la salida a stdout
+} ua;
+
+// Canales del DMA
+static struct
+{
+    uint8_t enabled;        // CCR.EN en el último paso
+    uint32_t count;         // CNDTR programado (recarga en modo circular)
+    uint32_t remaining;     // Datos pendientes (publicado en CNDTR)
+    uint32_t cmar;          // CMAR programado
+    uint32_t index;         // Datos transferidos desde el inicio o la última recarga
+} dma[SIM_DMA_CHANNELS];
+static uint32_t dma_isr = 0;
+
+// ADC
+static struct
+{
+    uint32_t isr;           // Flags de ADC_ISR
+    uint8_t started;        // ADSTART atendido
+    uint8_t waiting;        // Esperando el disparo externo
+    int8_t channel;         // Canal en conversión
+    uint64_t conv_at;       // Fin de la conversión en curso
+} adc;
+
+// Timers con eventos de actualización modelados (TIM2 y TIM3)
+typedef struct
+{
+    tim_regs_t *regs;
+    uint8_t running;        // CR1.CEN en el último paso
+    uint64_t update_at;     // Siguiente evento de actualización
+} sim_tim_t;
+
+static sim_tim_t tim2 = { &sim_hw.tim2, 0, SIM_NEVER };
+static sim_tim_t tim3 = { &sim_hw.tim3, 0, SIM_NEVER };
+
+static void sim_dispatch(void);
+static void dma_request(uint8_t ch);
+
+/**
+ * @brief Termina la simulación con un mensaje de error
+ *
+ * @return No retorna
+ */
+static void sim_fatal(const char *fmt, ...)
+{
+    va_list ap;
+
+    fflush(stdout);
+    fprintf(stderr, "sim: cycle %llu: ", (unsigned long long)now);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    exit(2);
+}
+
+/**
+ * @brief Devuelve la frecuencia del reloj del sistema según el RCC
+ *
+ * @return Hz de SYSCLK (HCLK = PCLK, sin divisores AHB/APB)
+ */
+uint32_t sim_core_clock(void)
+{
+    uint32_t cfgr = sim_hw.rcc.CFGR;
+    uint32_t src, mul;
+
+    switch (cfgr & RCC_CFGR_SWS)
+    {
+    case 0x1U << 2:
+        return SIM_HSI_HZ; // HSE: MCO de 8MHz del ST-LINK
+    case RCC_CFGR_SWS_PLL:
+        src = (cfgr & RCC_CFGR_PLLSRC) ? SIM_HSI_HZ / ((sim_hw.rcc.CFGR2 & RCC_CFGR2_PREDIV) + 1)
+                                       : SIM_HSI_HZ / 2;
+        mul = FIELD_GET(cfgr, RCC_CFGR_PLLMUL) + 2;
+        return src * (mul > 16 ? 16 : mul);
+    default:
+        return SIM_HSI_HZ;
+    }
+}
+
+/**
+ * @brief Devuelve los ciclos virtuales transcurridos desde sim_reset()
+ *
+ * @return Ciclos del reloj del sistema
+ */
+uint64_t sim_cycles(void)
+{
+    return now;
+}
+
+/**
+ * @brief Devuelve el número de manejadores de interrupción ejecutados
+ *
+ * @return Manejadores desde sim_reset() (cada uno despierta al núcleo si dormía)
+ */
+uint32_t sim_handler_count(void)
+{
+    return handlers_run;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Accesos del DMA                                                           */
+/* ------------------------------------------------------------------------- */
+
+static uint32_t mem_read(uint32_t addr, uint8_t size)
+{
+    void *p = (void *)(uintptr_t)addr;
+
+    return (size == 1) ? *(uint8_t *)p : (size == 2) ? *(uint16_t *)p : *(uint32_t *)p;
+}
+
+static void mem_write(uint32_t addr, uint32_t v, uint8_t size)
+{
+    void *p = (void *)(uintptr_t)addr;
+
+    if (size == 1)
+    {
+        *(uint8_t *)p = (uint8_t)v;
+    }
+    else if (size == 2)
+    {
+        *(uint16_t *)p = (uint16_t)v;
+    }
+    else
+    {
+        *(uint32_t *)p = v;
+    }
+}
+
+static uint32_t reg_addr(volatile uint32_t *reg)
+{
+    return (uint32_t)(uintptr_t)reg;
+}
+
+static void uart_tdr_write(uint32_t v);
+
+// Escritura del DMA en un registro: TDR tiene efecto inmediato
+static void periph_write(uint32_t addr, uint32_t v)
+{
+    if (addr == reg_addr(&sim_hw.usart2.TDR))
+    {
+        uart_tdr_write(v);
+        return;
+    }
+    *(volatile uint32_t *)(uintptr_t)addr = v;
+}
+
+// Lectura del DMA de un registro: RDR y DR limpian su flag
+static uint32_t periph_read(uint32_t addr)
+{
+    if (addr == reg_addr(&sim_hw.usart2.RDR))
+    {
+        ua.isr &= ~USART_ISR_RXNE;
+    }
+    else if (addr == reg_addr(&sim_hw.adc.DR))
+    {
+        adc.isr &= ~SIM_ADC_ISR_EOC;
+    }
+    return *(volatile uint32_t *)(uintptr_t)addr;
+}
+
+/* ------------------------------------------------------------------------- */
+/* DMA1                                                                      */
+/* ------------------------------------------------------------------------- */
+
+static uint8_t dma_active(uint8_t ch)
+{
+    return dma[ch - 1].enabled && dma[ch - 1].remaining != 0;
+}
+
+/**
+ * @brief Aplica las escrituras del firmware en el DMA
+ *
+ * @details IFCR limpia flags; un canal se (re)programa al habilitarse o cuando CNDTR o
+ *          CMAR ya no coinciden con el estado del modelo (el firmware los escribe con
+ *          el canal deshabilitado y lo vuelve a habilitar sin un paso intermedio).
+ *
+ * @return Ninguno
+ */
+static void dma_apply(void)
+{
+    if (sim_hw.dma1.IFCR)
+    {
+        for (uint8_t ch = 1; ch <= SIM_DMA_CHANNELS; ch++)
+        {
+            if (sim_hw.dma1.IFCR & DMA_IFCR_CGIF(ch))
+            {
+                dma_isr &= ~(0xFU << (4 * (ch - 1)));
+            }
+        }
+        dma_isr &= ~sim_hw.dma1.IFCR;
+        sim_hw.dma1.IFCR = 0;
+    }
+
+    for (uint8_t ch = 1; ch <= SIM_DMA_CHANNELS; ch++)
+    {
+        dma_channel_regs_t *r = &sim_hw.dma1.CH[ch - 1];
+        uint8_t en = (r->CCR & DMA_CCR_EN) ? 1 : 0;
+
+        if (en && (!dma[ch - 1].enabled || r->CNDTR != dma[ch - 1].remaining || r->CMAR != dma[ch - 1].cmar))
+        {
+            dma[ch - 1].count = r->CNDTR & 0xFFFF;
+            dma[ch - 1].remaining = dma[ch - 1].count;
+            dma[ch - 1].cmar = r->CMAR;
+            dma[ch - 1].index = 0;
+        }
+        else if (!en)
+        {
+            dma[ch - 1].remaining = r->CNDTR;
+            dma[ch - 1].cmar = r->CMAR;
+        }
+        dma[ch - 1].enabled = en;
+    }
+}
+
+/**
+ * @brief Ejecuta una transferencia de un dato en un canal activo
+ *
+ * @return Ninguno
+ */
+static void dma_request(uint8_t ch)
+{
+    dma_channel_regs_t *r = &sim_hw.dma1.CH[ch - 1];
+    uint32_t ccr = r->CCR;
+    uint8_t msize = 1U << ((ccr >> 10) & 3);
+    uint8_t psize = 1U << ((ccr >> 8) & 3);
+    uint32_t maddr, paddr, v;
+
+    if (!dma_active(ch))
+    {
+        return;
+    }
+
+    maddr = dma[ch - 1].cmar + ((ccr & DMA_CCR_MINC) ? dma[ch - 1].index * msize : 0);
+    paddr = r->CPAR + ((ccr & SIM_DMA_CCR_PINC) ? dma[ch - 1].index * psize : 0);
+
+    if (ccr & DMA_CCR_DIR)
+    {
+        v = mem_read(maddr, msize);
+        periph_write(paddr, v);
+    }
+    else
+    {
+        v = periph_read(paddr);
+        mem_write(maddr, v, msize);
+    }
+
+    dma[ch - 1].index++;
+    dma[ch - 1].remaining--;
+
+    if (dma[ch - 1].index == dma[ch - 1].count / 2)
+    {
+        dma_isr |= (DMA_ISR_HTIF(ch) | DMA_IFCR_CGIF(ch));
+    }
+    if (dma[ch - 1].remaining == 0)
+    {
+        dma_isr |= (DMA_ISR_TCIF(ch) | DMA_IFCR_CGIF(ch));
+        if (ccr & DMA_CCR_CIRC)
+        {
+            dma[ch - 1].remaining = dma[ch - 1].count;
+            dma[ch - 1].index = 0;
+        }
+    }
+    r->CNDTR = dma[ch - 1].remaining;
+}
+
+// Nivel de la petición de interrupción de un canal
+static uint8_t dma_irq_level(uint8_t ch)
+{
+    uint32_t ccr = sim_hw.dma1.CH[ch - 1].CCR;
+    uint32_t flags = dma_isr >> (4 * (ch - 1));
+
+    return ((ccr & DMA_CCR_TCIE) && (flags & 0x2U)) || ((ccr & DMA_CCR_HTIE) && (flags & 0x4U)) ||
+           ((ccr & SIM_DMA_CCR_TEIE) && (flags & 0x8U));
+}
+
+/* ------------------------------------------------------------------------- */
+/* USART2                                                                    */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Duración de una trama según BRR, OVER8, M y STOP
+ *
+ * @return Ciclos del reloj del sistema por byte
+ */
+static uint64_t uart_frame_cycles(void)
+{
+    uint32_t brr = sim_hw.usart2.BRR;
+    uint32_t cr1 = sim_hw.usart2.CR1;
+    uint32_t bit = (cr1 & USART_CR1_OVER8) ? (((brr & 0xFFF0) | ((brr & 0x7) << 1)) / 2) : brr;
+    uint32_t data = (cr1 & USART_CR1_M1) ? 7 : (cr1 & USART_CR1_M0) ? 9 : 8;
+    uint32_t stop = (FIELD_GET(sim_hw.usart2.CR2, USART_CR2_STOP) >= 2) ? 2 : 1;
+
+    if (bit == 0)
+    {
+        bit = 16;
+    }
+    return (uint64_t)bit * (1 + data + stop);
+}
+
+static uint8_t uart_tx_enabled(void)
+{
+    return (sim_hw.usart2.CR1 & (USART_CR1_UE | USART_CR1_TE)) == (USART_CR1_UE | USART_CR1_TE);
+}
+
+static uint8_t uart_rx_enabled(void)
+{
+    return (sim_hw.usart2.CR1 & (USART_CR1_UE | USART_CR1_RE)) == (USART_CR1_UE | USART_CR1_RE);
+}
+
+// Escritura en TDR: pasa al registro de desplazamiento si está libre
+static void uart_tdr_write(uint32_t v)
+{
+    if (!uart_tx_enabled())
+    {
+        return;
+    }
+
+    ua.isr &= ~USART_ISR_TC;
+    if (!ua.shift_busy)
+    {
+        ua.shift_busy = 1;
+        ua.shift_byte = (uint8_t)v;
+        ua.shift_done = now + uart_frame_cycles();
+    }
+    else
+    {
+        ua.hold_valid = 1; // Con TXE = 0 una segunda escritura sustituye al dato
+        ua.hold_byte = (uint8_t)v;
+    }
+}
+
+// Peticiones DMA de transmisión mientras TDR esté libre
+static void uart_dma_tx_feed(void)
+{
+    while ((sim_hw.usart2.CR3 & USART_CR3_DMAT) && uart_tx_enabled() && !ua.hold_valid && dma_active(4) &&
+           sim_hw.dma1.CH[3].CPAR == reg_addr(&sim_hw.usart2.TDR))
+    {
+        dma_request(4);
+    }
+}
+
+static void uart_apply(void)
+{
+    usart_regs_t *u = &sim_hw.usart2;
+
+    if (u->ICR)
+    {
+        ua.isr &= ~(u->ICR & (USART_ICR_ORECF | USART_ICR_IDLECF | USART_ICR_TCCF));
+        u->ICR = 0;
+    }
+
+    if (u->TDR != SIM_TDR_EMPTY)
+    {
+        uint32_t v = u->TDR;
+
+        u->TDR = SIM_TDR_EMPTY;
+        uart_tdr_write(v);
+    }
+
+    uart_dma_tx_feed();
+}
+
+// Fin del byte en el registro de desplazamiento
+static void uart_tx_event(void)
+{
+    ua.tx_log[ua.tx_head++ & (SIM_UART_TX_LOG - 1)] = (char)ua.shift_byte;
+    if (ua.tx_head - ua.tx_tail > SIM_UART_TX_LOG)
+    {
+        ua.tx_tail = ua.tx_head - SIM_UART_TX_LOG; // Se pierden los bytes más antiguos sin leer
+    }
+    if (ua.echo)
+    {
+        putchar(ua.shift_byte);
+    }
+
+    if (ua.hold_valid)
+    {
+        ua.hold_valid = 0;
+        ua.shift_byte = ua.hold_byte;
+        ua.shift_done = now + uart_frame_cycles();
+    }
+    else
+    {
+        ua.shift_busy = 0;
+        ua.shift_done = SIM_NEVER;
+        ua.isr |= USART_ISR_TC;
+    }
+
+    uart_dma_tx_feed();
+}
+
+// Llegada de un byte por RX
+static void uart_rx_event(void)
+{
+    uint8_t b = ua.rx_queue[ua.rx_tail++ & (SIM_UART_RX_QUEUE - 1)];
+    uint64_t frame = uart_frame_cycles();
+
+    if (uart_rx_enabled())
+    {
+        if (ua.isr & USART_ISR_RXNE)
+        {
+            ua.isr |= USART_ISR_ORE; // RDR sin leer: el byte se pierde
+        }
+        else
+        {
+            sim_hw.usart2.RDR = b;
+            ua.isr |= USART_ISR_RXNE;
+            if ((sim_hw.usart2.CR3 & USART_CR3_DMAR) && sim_hw.dma1.CH[4].CPAR == reg_addr(&sim_hw.usart2.RDR))
+            {
+                dma_request(5);
+            }
+        }
+        ua.idle_at = now + frame;
+    }
+
+    ua.rx_next = (ua.rx_head != ua.rx_tail) ? now + frame : SIM_NEVER;
+}
+
+static void uart_idle_event(void)
+{
+    ua.idle_at = SIM_NEVER;
+    if (ua.rx_head == ua.rx_tail)
+    {
+        ua.isr |= USART_ISR_IDLE;
+    }
+}
+
+static uint8_t uart_irq_level(void)
+{
+    uint32_t cr1 = sim_hw.usart2.CR1;
+    uint32_t isr = ua.isr | (ua.hold_valid ? 0 : USART_ISR_TXE);
+
+    return ((cr1 & USART_CR1_RXNEIE) && (isr & USART_ISR_RXNE)) ||
+           ((cr1 & USART_CR1_TXEIE) && (isr & USART_ISR_TXE)) ||
+           ((cr1 & USART_CR1_TCIE) && (isr & USART_ISR_TC)) ||
+           ((cr1 & USART_CR1_IDLEIE) && (isr & USART_ISR_IDLE)) ||
+           (((cr1 & USART_CR1_RXNEIE) || (sim_hw.usart2.CR3 & USART_CR3_EIE)) && (isr & USART_ISR_ORE));
+}
+
+/**
+ * @brief Añade bytes a la línea RX del USART2
+ *
+ * @details Llegan uno por trama a la velocidad configurada, a partir del momento actual.
+ *
+ * @return Bytes aceptados (la cola tiene SIM_UART_RX_QUEUE posiciones)
+ */
+uint16_t sim_uart_rx_write(const uint8_t *data, uint16_t len)
+{
+    uint16_t n = 0;
+
+    while (n < len && (uint16_t)(ua.rx_head - ua.rx_tail) < SIM_UART_RX_QUEUE)
+    {
+        ua.rx_queue[ua.rx_head++ & (SIM_UART_RX_QUEUE - 1)] = data[n++];
+    }
+    if (n && ua.rx_next == SIM_NEVER)
+    {
+        ua.rx_next = now + uart_frame_cycles();
+    }
+    return n;
+}
+
+/**
+ * @brief Devuelve los bytes escritos con sim_uart_rx_write() que aún no han llegado
+ *
+ * @return Bytes en la cola de RX
+ */
+uint16_t sim_uart_rx_pending(void)
+{
+    return (uint16_t)(ua.rx_head - ua.rx_tail);
+}
+
+/**
+ * @brief Copia la salida del USART2 no leída todavía
+ *
+ * @param buf Destino, terminado en '\0'
+ * @param size Tamaño de buf
+ *
+ * @return Bytes copiados (sin el terminador)
+ */
+uint32_t sim_uart_tx_read(char *buf, uint32_t size)
+{
+    uint32_t n = 0;
+
+    while (n + 1 < size && ua.tx_tail != ua.tx_head)
+    {
+        buf[n++] = ua.tx_log[ua.tx_tail++ & (SIM_UART_TX_LOG - 1)];
+    }
+    if (size)
+    {
+        buf[n] = '\0';
+    }
+    return n;
+}
+
+/**
+ * @brief Devuelve el número de bytes transmitidos desde sim_reset()
+ *
+ * @return Bytes completados por el registro de desplazamiento
+ */
+uint32_t sim_uart_tx_count(void)
+{
+    return ua.tx_head;
+}
+
+/**
+ * @brief Copia o no la salida del USART2 a stdout según se transmite
+ *
+ * @return Ninguno
+ */
+void sim_uart_echo(uint8_t on)
+{
+    ua.echo = on;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ADC                                                                       */
+/* ------------------------------------------------------------------------- */
+
+/**
+ * @brief Duración de una conversión según SMPR y CKMODE
+ *
+ * @return Ciclos del reloj del sistema (muestreo + 12.5 ciclos del ADC)
+ */
+static uint64_t adc_conv_cycles(void)
+{
+    static const uint16_t smp_half[8] = { 3, 15, 27, 57, 83, 111, 143, 479 }; // Ciclos x2
+    uint32_t core = sim_core_clock();
+    uint32_t ckmode = FIELD_GET(sim_hw.adc.CFGR2, SIM_ADC_CFGR2_CKMODE);
+    uint32_t adc_hz = (ckmode == 1) ? core / 2 : (ckmode == 2) ? core / 4 : SIM_HSI14_HZ;
+    uint64_t half = smp_half[sim_hw.adc.SMPR & 0x7] + 25;
+
+    return (half * core + 2ULL * adc_hz - 1) / (2ULL * adc_hz);
+}
+
+// Siguiente canal de la secuencia a partir de from (incluido), -1 si no hay más
+static int8_t adc_next_channel(int8_t from)
+{
+    uint32_t chselr = sim_hw.adc.CHSELR;
+    int8_t step = (sim_hw.adc.CFGR1 & SIM_ADC_CFGR1_SCANDIR) ? -1 : 1;
+
+    for (int8_t ch = from; ch >= 0 && ch < ADC_SCAN_MAX_CHANNELS; ch += step)
+    {
+        if (chselr & (1UL << ch))
+        {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+static int8_t adc_first_channel(void)
+{
+    return adc_next_channel((sim_hw.adc.CFGR1 & SIM_ADC_CFGR1_SCANDIR) ? ADC_SCAN_MAX_CHANNELS - 1 : 0);
+}
+
+// Empieza una secuencia: inmediatamente o al llegar el disparo externo
+static void adc_sequence_start(void)
+{
+    adc.channel = adc_first_channel();
+    if (adc.channel < 0)
+    {
+        adc.conv_at = SIM_NEVER;
+        return;
+    }
+    adc.conv_at = now + adc_conv_cycles();
+    adc.waiting = 0;
+}
+
+static void adc_apply(void)
+{
+    uint32_t cr = sim_hw.adc.CR;
+
+    if (sim_hw.adc.ISR != adc.isr)
+    {
+        adc.isr &= ~sim_hw.adc.ISR; // Borrado escribiendo 1
+    }
+
+    if (cr & ADC_CR_ADDIS)
+    {
+        cr &= ~(ADC_CR_ADDIS | ADC_CR_ADEN | ADC_CR_ADSTART);
+        adc.isr &= ~SIM_ADC_ISR_ADRDY;
+        adc.started = 0;
+        adc.conv_at = SIM_NEVER;
+    }
+
+    if ((cr & ADC_CR_ADCAL) && !(cr & ADC_CR_ADEN))
+    {
+        cr &= ~ADC_CR_ADCAL;
+        sim_hw.adc.DR = SIM_ADC_CALFACT;
+    }
+
+    if (cr & ADC_CR_ADEN)
+    {
+        adc.isr |= SIM_ADC_ISR_ADRDY;
+    }
+
+    if (cr & ADC_CR_ADSTP)
+    {
+        cr &= ~(ADC_CR_ADSTP | ADC_CR_ADSTART);
+        adc.started = 0;
+        adc.conv_at = SIM_NEVER;
+    }
+
+    if ((cr & ADC_CR_ADSTART) && (cr & ADC_CR_ADEN) && !adc.started)
+    {
+        adc.started = 1;
+        if (sim_hw.adc.CFGR1 & ADC_CFGR1_EXTEN)
+        {
+            adc.waiting = 1;
+            adc.conv_at = SIM_NEVER;
+        }
+        else
+        {
+            adc_sequence_start();
+        }
+    }
+    else if (!(cr & ADC_CR_ADSTART))
+    {
+        adc.started = 0;
+        adc.waiting = 0;
+        adc.conv_at = SIM_NEVER;
+    }
+
+    sim_hw.adc.CR = cr;
+}
+
+// Fin de una conversión: resultado, petición DMA y siguiente canal o fin de secuencia
+static void adc_conv_event(void)
+{
+    uint32_t cfgr1 = sim_hw.adc.CFGR1;
+    int8_t step = (cfgr1 & SIM_ADC_CFGR1_SCANDIR) ? -1 : 1;
+
+    if (adc.isr & SIM_ADC_ISR_EOC)
+    {
+        adc.isr |= SIM_ADC_ISR_OVR;
+    }
+    sim_hw.adc.DR = adc_raw[adc.channel] & 0xFFF;
+    adc.isr |= SIM_ADC_ISR_EOC;
+
+    if ((cfgr1 & ADC_CFGR1_AWDEN) &&
+        (!(cfgr1 & ADC_CFGR1_AWDSGL) || FIELD_GET(cfgr1, ADC_CFGR1_AWDCH) == (uint32_t)adc.channel) &&
+        (sim_hw.adc.DR < FIELD_GET(sim_hw.adc.TR, ADC_TR_LT) || sim_hw.adc.DR > FIELD_GET(sim_hw.adc.TR, ADC_TR_HT)))
+    {
+        adc.isr |= ADC_ISR_AWD;
+    }
+
+    if ((cfgr1 & ADC_CFGR1_DMAEN) && sim_hw.dma1.CH[0].CPAR == reg_addr(&sim_hw.adc.DR))
+    {
+        dma_request(1);
+    }
+
+    adc.channel = adc_next_channel(adc.channel + step);
+    if (adc.channel >= 0)
+    {
+        adc.conv_at = now + adc_conv_cycles();
+        return;
+    }
+
+    adc.isr |= SIM_ADC_ISR_EOS;
+    if (cfgr1 & ADC_CFGR1_CONT)
+    {
+        adc_sequence_start();
+    }
+    else if (cfgr1 & ADC_CFGR1_EXTEN)
+    {
+        adc.waiting = 1;
+        adc.conv_at = SIM_NEVER;
+    }
+    else
+    {
+        sim_hw.adc.CR &= ~ADC_CR_ADSTART; // Secuencia única terminada
+        adc.started = 0;
+        adc.conv_at = SIM_NEVER;
+    }
+}
+
+// TRGO de TIM3
+static void adc_trigger(void)
+{
+    if (adc.started && adc.waiting &&
+        (sim_hw.adc.CFGR1 & ADC_CFGR1_EXTSEL) == ADC_CFGR1_EXTSEL_TIM3)
+    {
+        adc_sequence_start();
+    }
+}
+
+/**
+ * @brief Fija el resultado de las conversiones de un canal
+ *
+ * @param channel 0-15 externos, ADC_CH_TEMP o ADC_CH_VREFINT
+ * @param raw Cuentas de 12 bits
+ *
+ * @return Ninguno
+ */
+void sim_adc_set(uint8_t channel, uint16_t raw)
+{
+    if (channel < ADC_SCAN_MAX_CHANNELS)
+    {
+        adc_raw[channel] = raw & 0xFFF;
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* TIM2 / TIM3, RCC, SysTick y NVIC                                          */
+/* ------------------------------------------------------------------------- */
+
+static uint64_t tim_period(const sim_tim_t *t)
+{
+    return (uint64_t)(t->regs->PSC + 1) * ((t->regs->ARR & 0xFFFF) + 1);
+}
+
+static void tim_apply(sim_tim_t *t)
+{
+    uint8_t cen = (t->regs->CR1 & TIM_CR1_CEN) ? 1 : 0;
+
+    if (t->regs->EGR & TIM_EGR_UG)
+    {
+        t->regs->EGR = 0;
+        t->regs->CNT = 0;
+        if (cen)
+        {
+            t->update_at = now + tim_period(t);
+        }
+    }
+    if (cen && !t->running)
+    {
+        t->update_at = now + tim_period(t);
+    }
+    else if (!cen)
+    {
+        t->update_at = SIM_NEVER;
+    }
+    t->running = cen;
+}
+
+static void tim_event(sim_tim_t *t)
+{
+    t->update_at = now + tim_period(t);
+    t->regs->SR |= SIM_TIM_SR_UIF;
+
+    if (t == &tim2 && (t->regs->DIER & TIM_DIER_UDE))
+    {
+        dma_request(2);
+    }
+    if (t == &tim3 && (t->regs->CR2 & SIM_TIM_CR2_MMS) == TIM_CR2_MMS_UPDATE)
+    {
+        adc_trigger();
+    }
+}
+
+static void rcc_apply(void)
+{
+    uint32_t cr = sim_hw.rcc.CR;
+
+    cr = (cr & RCC_CR_HSION) ? (cr | RCC_CR_HSIRDY) : (cr & ~RCC_CR_HSIRDY);
+    cr = ((cr & RCC_CR_HSEON) && hse_present) ? (cr | RCC_CR_HSERDY) : (cr & ~RCC_CR_HSERDY);
+    cr = (cr & RCC_CR_PLLON) ? (cr | RCC_CR_PLLRDY) : (cr & ~RCC_CR_PLLRDY);
+    sim_hw.rcc.CR = cr;
+
+    REG_MODIFY(sim_hw.rcc.CFGR, RCC_CFGR_SWS, (sim_hw.rcc.CFGR & RCC_CFGR_SW) << 2);
+}
+
+static uint32_t systick_value(void)
+{
+    uint64_t left;
+
+    if (!st.running)
+    {
+        return st.frozen;
+    }
+    left = st.zero_at - now;
+    return (left > sim_hw.systick.RVR) ? sim_hw.systick.RVR : (uint32_t)left;
+}
+
+/**
+ * @brief Aplica las escrituras del firmware en el SysTick
+ *
+ * @details Una escritura en CVR lo pone a 0 y el siguiente ciclo carga RVR; al parar
+ *          el contador se conserva su valor y al habilitarlo continúa desde él.
+ *
+ * @return Ninguno
+ */
+static void systick_apply(void)
+{
+    uint8_t en = (sim_hw.systick.CSR & SYST_CSR_ENABLE) ? 1 : 0;
+    uint32_t reload = (sim_hw.systick.RVR & SYST_RVR_MAX) + 1;
+
+    if (sim_hw.systick.CVR != st.cvr)
+    {
+        if (st.running)
+        {
+            st.zero_at = now + reload;
+        }
+        st.frozen = 0;
+    }
+
+    if (en && !st.running)
+    {
+        st.zero_at = now + (st.frozen ? st.frozen : reload);
+    }
+    else if (!en && st.running)
+    {
+        st.frozen = systick_value();
+    }
+    st.running = en;
+}
+
+static void systick_event(void)
+{
+    sim_hw.systick.CSR |= SYST_CSR_COUNTFLAG;
+    if (sim_hw.systick.CSR & SYST_CSR_TICKINT)
+    {
+        st.pending = 1;
+    }
+    st.zero_at = now + (sim_hw.systick.RVR & SYST_RVR_MAX) + 1;
+}
+
+static void nvic_apply(void)
+{
+    nvic_enabled |= sim_hw.nvic_iser;
+    nvic_enabled &= ~sim_hw.nvic_icer;
+    sim_hw.nvic_icer = 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Bucle de eventos                                                          */
+/* ------------------------------------------------------------------------- */
+
+// Copia el estado del modelo en los registros que lee el firmware
+static void sim_publish(void)
+{
+    st.cvr = systick_value();
+    sim_hw.systick.CVR = st.cvr;
+    sim_hw.scb_icsr = st.pending ? SCB_ICSR_PENDSTSET : 0;
+    sim_hw.nvic_iser = nvic_enabled;
+    sim_hw.usart2.ISR = ua.isr | (ua.hold_valid ? 0 : USART_ISR_TXE);
+    sim_hw.dma1.ISR = dma_isr;
+    sim_hw.adc.ISR = adc.isr;
+}
+
+// Efectos de las escrituras del firmware desde el último paso
+static void sim_apply(void)
+{
+    nvic_apply();
+    rcc_apply();
+    systick_apply();
+    dma_apply();
+    uart_apply();
+    adc_apply();
+    tim_apply(&tim2);
+    tim_apply(&tim3);
+    sim_publish();
+}
+
+static uint64_t sim_next_event(void)
+{
+    uint64_t t = SIM_NEVER;
+
+    if (st.running && st.zero_at < t) t = st.zero_at;
+    if (ua.shift_busy && ua.shift_done < t) t = ua.shift_done;
+    if (ua.rx_next < t) t = ua.rx_next;
+    if (ua.idle_at < t) t = ua.idle_at;
+    if (adc.conv_at < t) t = adc.conv_at;
+    if (tim2.update_at < t) t = tim2.update_at;
+    if (tim3.update_at < t) t = tim3.update_at;
+
+    return t;
+}
+
+// Procesa los eventos que vencen en el ciclo actual, en orden fijo
+static void sim_process_events(void)
+{
+    if (st.running && st.zero_at == now) systick_event();
+    if (ua.shift_busy && ua.shift_done == now) uart_tx_event();
+    if (ua.rx_next == now) uart_rx_event();
+    if (ua.idle_at == now) uart_idle_event();
+    if (adc.conv_at == now) adc_conv_event();
+    if (tim2.update_at == now) tim_event(&tim2);
+    if (tim3.update_at == now) tim_event(&tim3);
+    sim_publish();
+}
+
+// Excepción pendiente y habilitada de mayor prioridad (menor número), 0 si no hay
+static uint32_t sim_pending_exception(void)
+{
+    if (st.pending)
+    {
+        return SIM_EXC_SYSTICK;
+    }
+    if ((nvic_enabled & (1U << DMA1_CH1_IRQn)) && dma_irq_level(1))
+    {
+        return SIM_EXC_IRQ0 + DMA1_CH1_IRQn;
+    }
+    if ((nvic_enabled & (1U << DMA1_CH2_3_IRQn)) && (dma_irq_level(2) || dma_irq_level(3)))
+    {
+        return SIM_EXC_IRQ0 + DMA1_CH2_3_IRQn;
+    }
+    if ((nvic_enabled & (1U << DMA1_CH4_5_IRQn)) && (dma_irq_level(4) || dma_irq_level(5)))
+    {
+        return SIM_EXC_IRQ0 + DMA1_CH4_5_IRQn;
+    }
+    if ((nvic_enabled & (1U << ADC_IRQn)) && (sim_hw.adc.IER & adc.isr))
+    {
+        return SIM_EXC_IRQ0 + ADC_IRQn;
+    }
+    if ((nvic_enabled & (1U << USART2_IRQn)) && uart_irq_level())
+    {
+        return SIM_EXC_IRQ0 + USART2_IRQn;
+    }
+    return 0;
+}
+
+// Ejecuta un manejador como lo haría el NVIC
+static void sim_run_handler(uint32_t exc)
+{
+    uint32_t entry_isr = ua.isr;
+    uint32_t entry_cr1 = sim_hw.usart2.CR1;
+
+    ipsr = exc;
+    handlers_run++;
+    switch (exc)
+    {
+    case SIM_EXC_SYSTICK:
+        st.pending = 0;
+        sim_publish();
+        SysTick_Handler();
+        break;
+    case SIM_EXC_IRQ0 + DMA1_CH1_IRQn:
+        DMA1_CH1_IRQHandler();
+        break;
+    case SIM_EXC_IRQ0 + DMA1_CH2_3_IRQn:
+        DMA1_CH2_3_IRQHandler();
+        break;
+    case SIM_EXC_IRQ0 + DMA1_CH4_5_IRQn:
+        DMA1_CH4_5_IRQHandler();
+        break;
+    case SIM_EXC_IRQ0 + ADC_IRQn:
+        ADC_IRQHandler();
+        break;
+    case SIM_EXC_IRQ0 + USART2_IRQn:
+        USART2_IRQHandler();
+        if ((entry_isr & USART_ISR_RXNE) && (entry_cr1 & USART_CR1_RXNEIE))
+        {
+            ua.isr &= ~USART_ISR_RXNE; // La ISR ha leído RDR
+        }
+        break;
+    default:
+        break;
+    }
+    ipsr = 0;
+
+    sim_apply();
+}
+
+// Ejecuta las ISR pendientes si PRIMASK y el modo actual lo permiten
+static void sim_dispatch(void)
+{
+    uint32_t n = 0;
+    uint32_t exc;
+
+    if (primask || ipsr)
+    {
+        return;
+    }
+
+    while ((exc = sim_pending_exception()) != 0)
+    {
+        if (++n > SIM_IRQ_STORM)
+        {
+            sim_fatal("interrupt storm (exception %u)", exc);
+        }
+        sim_run_handler(exc);
+    }
+}
+
+/**
+ * @brief Una iteración de espera activa del firmware
+ *
+ * @details Aplica las escrituras pendientes, procesa los eventos de los próximos
+ *          SIM_POLL_CYCLES ciclos y atiende las interrupciones (HW_POLL()).
+ *
+ * @return Ninguno
+ */
+void sim_poll(void)
+{
+    uint64_t target = now + SIM_POLL_CYCLES;
+    uint64_t t;
+
+    sim_apply();
+    sim_dispatch();
+
+    while ((t = sim_next_event()) <= target)
+    {
+        now = t;
+        sim_process_events();
+        sim_dispatch();
+    }
+
+    now = target;
+    sim_publish();
+}
+
+/**
+ * @brief WFI: avanza el tiempo virtual hasta la siguiente interrupción
+ *
+ * @details Si ya hay una interrupción pendiente retorna sin dormir. Si no, llama al
+ *          gancho de inactividad (que puede inyectar datos o terminar la simulación) y
+ *          salta de evento en evento hasta que alguno deja una interrupción pendiente.
+ *          Con PRIMASK activo la ISR se ejecuta al restaurar las interrupciones.
+ *
+ * @return Ninguno
+ */
+void sim_wfi(void)
+{
+    uint64_t t;
+
+    sim_apply();
+    if (sim_pending_exception())
+    {
+        sim_dispatch();
+        return;
+    }
+
+    if (idle_hook && !in_hook)
+    {
+        uint32_t prev_primask = primask;
+        uint32_t prev_handlers = handlers_run;
+
+        in_hook = 1;
+        primask = 0;
+        idle_hook();
+        primask = prev_primask;
+        in_hook = 0;
+
+        sim_apply();
+        if (handlers_run != prev_handlers || sim_pending_exception())
+        {
+            sim_dispatch();
+            return; // Despertar espurio: el firmware vuelve a comprobar si tiene trabajo
+        }
+    }
+
+    do
+    {
+        t = sim_next_event();
+        if (t == SIM_NEVER)
+        {
+            sim_fatal("WFI with no pending event");
+        }
+        now = t;
+        sim_process_events();
+    } while (!sim_pending_exception());
+
+    sim_dispatch();
+}
+
+/**
+ * @brief Registra la función a la que se llama cada vez que el firmware ejecuta WFI
+ *
+ * @details Se ejecuta con las interrupciones habilitadas, como una tarea más en el
+ *          punto en que el firmware se queda sin trabajo, por lo que puede llamar a
+ *          cualquier función de los drivers, incluidas las que esperan (uart_flush()).
+ *          Si durante el gancho se ejecuta alguna ISR, WFI retorna sin dormir.
+ *
+ * @return Ninguno
+ */
+void sim_set_idle_hook(sim_idle_hook_t hook)
+{
+    idle_hook = hook;
+}
+
+/**
+ * @brief Indica si el MCO del ST-LINK está conectado (HSE bypass)
+ *
+ * @return Ninguno
+ */
+void sim_hse_present(uint8_t present)
+{
+    hse_present = present;
+}
+
+/**
+ * @brief Lleva el modelo al estado de reset
+ *
+ * @details Registros a su valor de reset (HSI activo, TXE y TC a 1), tiempo virtual a
+ *          0, interrupciones habilitadas y lecturas del ADC a las de 30°C y 3.3V con
+ *          los valores de calibración simulados. A continuación el llamador debe
+ *          ejecutar SystemInit(), como Reset_Handler.
+ *
+ * @return Ninguno
+ */
+void sim_reset(void)
+{
+    if ((uintptr_t)&sim_hw > UINT32_MAX || (uintptr_t)&adc_raw > UINT32_MAX)
+    {
+        sim_fatal("static data above 4GB: link with -no-pie");
+    }
+
+    sim_hw = (sim_hw_t){ 0 };
+    sim_hw.rcc.CR = RCC_CR_HSION | RCC_CR_HSIRDY;
+    sim_hw.usart2.TDR = SIM_TDR_EMPTY;
+    sim_hw.adc.TR = ADC_TR_HT;
+    sim_hw.ts_cal30 = SIM_TS_CAL30;
+    sim_hw.vrefint_cal = SIM_VREFINT_CAL;
+
+    now = 0;
+    primask = 0;
+    ipsr = 0;
+    nvic_enabled = 0;
+    handlers_run = 0;
+
+    uint8_t echo = ua.echo; // Opciones del host: se conservan
+
+    st = (typeof(st)){ 0 };
+    ua = (typeof(ua)){ 0 };
+    ua.echo = echo;
+    ua.isr = SIM_USART_ISR_RESET & ~USART_ISR_TXE;
+    ua.shift_done = ua.rx_next = ua.idle_at = SIM_NEVER;
+    for (uint8_t ch = 0; ch < SIM_DMA_CHANNELS; ch++)
+    {
+        dma[ch] = (typeof(dma[0])){ 0 };
+    }
+    dma_isr = 0;
+    adc = (typeof(adc)){ 0 };
+    adc.conv_at = SIM_NEVER;
+    tim2.running = tim3.running = 0;
+    tim2.update_at = tim3.update_at = SIM_NEVER;
+
+    for (uint8_t ch = 0; ch < ADC_SCAN_MAX_CHANNELS; ch++)
+    {
+        adc_raw[ch] = 0x800;
+    }
+    adc_raw[ADC_CH_TEMP] = SIM_TS_CAL30;
+    adc_raw[ADC_CH_VREFINT] = SIM_VREFINT_CAL;
+
+    sim_publish();
+}
+
+/* ------------------------------------------------------------------------- */
+/* Núcleo (system.h)                                                         */
+/* ------------------------------------------------------------------------- */
+
+uint32_t irq_save(void)
+{
+    uint32_t prev = primask;
+
+    primask = 1;
+    return prev;
+}
+
+void irq_restore(uint32_t prev)
+{
+    primask = prev & 1U;
+    if (!primask)
+    {
+        sim_apply();
+        sim_dispatch();
+    }
+}
+
+uint32_t irq_blocked(void)
+{
+    return primask | ipsr;
+}
+
+/**
+ * @brief Sustituye a memmap_dump(): memmap.c usa los símbolos del script del enlazador
+ *
+ * @return Ninguno
+ */
+void memmap_dump(void)
+{
+    uart_send_string("RAM map not available in HOST_SIM\r\n");
+}
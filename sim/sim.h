@@ -0,0 +1,98 @@
+/**
+ * @file sim.h
+ * @brief Modelo de periféricos para compilar los drivers en el host (HOST_SIM)
+ * @details Con HOST_SIM definido, nucleo_conf.h apunta las instancias de los periféricos
+ *          (RCC, USART2, DMA1...) a los miembros de sim_hw en lugar de a sus direcciones
+ *          y system.h toma PRIMASK, IPSR y WFI de este modelo. El código de Src/ se
+ *          compila sin cambios y se ejecuta contra un STM32F070 simulado con tiempo
+ *          virtual medido en ciclos del reloj del sistema.
+ *          El código del firmware se ejecuta en tiempo virtual nulo: el tiempo solo
+ *          avanza en las esperas activas (HW_WAIT_WHILE / HW_POLL, sim_poll()) y en WFI
+ *          (sim_wfi()). En esos puntos el modelo aplica los efectos de las escrituras
+ *          hechas desde el último paso (p.ej. TDR escrito, IFCR, CVR reiniciado),
+ *          procesa en orden los eventos vencidos (tick del SysTick, fin de cada byte de
+ *          la UART, conversiones del ADC, transferencias del DMA, actualizaciones de
+ *          TIM2/TIM3) y ejecuta las ISR pendientes si PRIMASK lo permite.
+ *          Limitaciones: las lecturas no tienen efectos (la lectura de RDR por la ISR de
+ *          USART2 se supone al volver de ella y la del DR del ADC la hace el DMA), dos
+ *          escrituras en un registro de borrado (IFCR, ICR) sin un paso del modelo entre
+ *          ellas se combinan solo si son distintas, y las direcciones que se escriben en
+ *          CPAR/CMAR deben caber en 32 bits: se enlaza con -no-pie y los buffers del DMA
+ *          deben ser estáticos (como en todos los drivers).
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include "regs.h"
+
+#define SIM_HSI_HZ              8000000     // HSI y MCO del ST-LINK (HSE bypass)
+#define SIM_HSI14_HZ            14000000    // Reloj asíncrono del ADC (CKMODE = 00)
+#define SIM_POLL_CYCLES         4           // Ciclos que avanza cada iteración de una espera activa
+#define SIM_TS_CAL30            1750        // TEMP30_CAL simulado (cuentas a 30°C y 3.3V)
+#define SIM_VREFINT_CAL         1530        // VREFINT_CAL simulado (cuentas a 3.3V)
+#define SIM_ADC_CALFACT         0x42        // Factor devuelto en ADC_DR al terminar ADCAL
+#define SIM_UART_TX_LOG         65536       // Bytes transmitidos que se conservan (potencia de 2)
+#define SIM_UART_RX_QUEUE       4096        // Bytes pendientes de llegar por RX (potencia de 2)
+#define SIM_IRQ_STORM           100000      // ISR seguidas sin avanzar el tiempo antes de abortar
+
+// Periféricos simulados
+typedef struct
+{
+    systick_regs_t systick;
+    rcc_regs_t rcc;
+    flash_regs_t flash;
+    adc_regs_t adc;
+    adc_common_regs_t adc_common;
+    gpio_regs_t gpioa;
+    gpio_regs_t gpiob;
+    gpio_regs_t gpioc;
+    usart_regs_t usart2;
+    dma_regs_t dma1;
+    tim_regs_t tim1;
+    tim_regs_t tim2;
+    tim_regs_t tim3;
+    volatile uint32_t scb_icsr;     // SCB_ICSR (solo PENDSTSET)
+    volatile uint32_t scb_scr;      // SCB_SCR
+    volatile uint32_t nvic_iser;    // Lectura: interrupciones habilitadas
+    volatile uint32_t nvic_icer;
+    uint16_t ts_cal30;              // Memoria de sistema: TEMP30_CAL
+    uint16_t vrefint_cal;           // Memoria de sistema: VREFINT_CAL
+} sim_hw_t;
+
+extern sim_hw_t sim_hw;
+
+// Función llamada por sim_wfi() cada vez que el firmware se queda sin trabajo
+typedef void (*sim_idle_hook_t)(void);
+
+void sim_reset(void);
+void sim_poll(void);
+void sim_wfi(void);
+void sim_set_idle_hook(sim_idle_hook_t hook);
+uint64_t sim_cycles(void);
+uint32_t sim_core_clock(void);
+uint32_t sim_handler_count(void);
+
+void sim_hse_present(uint8_t present);
+void sim_adc_set(uint8_t channel, uint16_t raw);
+
+uint16_t sim_uart_rx_write(const uint8_t *data, uint16_t len);
+uint16_t sim_uart_rx_pending(void);
+uint32_t sim_uart_tx_read(char *buf, uint32_t size);
+uint32_t sim_uart_tx_count(void);
+void sim_uart_echo(uint8_t on);
+
+// Manejadores del firmware que ejecuta el modelo
+void SysTick_Handler(void);
+void DMA1_CH1_IRQHandler(void);
+void DMA1_CH2_3_IRQHandler(void);
+void DMA1_CH4_5_IRQHandler(void);
+void ADC_IRQHandler(void);
+void USART2_IRQHandler(void);
+
+// Arranque del firmware (Reset_Handler y main() de Src/main.c, renombrado en la compilación)
+void SystemInit(void);
+int firmware_main(void);
+
+#endif // SIM_H_
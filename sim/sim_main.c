@@ -0,0 +1,851 @@
+/**
+ * @file sim_main.c
+ * @brief Pruebas del firmware en el host (HOST_SIM)
+ * @details Primero ejercita en bucle cerrado los módulos sin periféricos (buffer
+ *          circular, filtro del ADC frente a una implementación de referencia y pools
+ *          de memoria) con comprobación de invariantes e informe de rendimiento.
+ *          Después arranca el firmware completo sobre el modelo de sim.c y, desde el
+ *          gancho de inactividad, le envía comandos por la UART simulada y comprueba sus
+ *          respuestas y sus efectos con plazos en tiempo virtual: arranque, comando L,
+ *          informe y alarma de temperatura, despertares en reposo, secuencias Q/S,
+ *          rueda de temporizadores, planificador, ráfaga de líneas para el intérprete,
+ *          modo DMA de la UART y barrido de la conversión a temperatura frente a una
+ *          referencia en coma flotante.
+ *          Uso: sim [-v]   (-v copia la salida de la UART a stdout)
+ *          Devuelve 0 si todas las comprobaciones pasan y 1 si alguna falla.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "adc.h"
+#include "cmd.h"
+#include "filter.h"
+#include "gamma.h"
+#include "led_seq.h"
+#include "mempool.h"
+#include "pwm.h"
+#include "ring_buffer.h"
+#include "scheduler.h"
+#include "system.h"
+#include "timer_wheel.h"
+#include "uart.h"
+
+#define SIM_RING_SIZE       256     // Buffer de la prueba de carga (potencia de 2)
+#define SIM_RING_OPS        20000000UL // Bytes que atraviesan el buffer en la prueba de carga
+#define SIM_FILTER_SAMPLES  4000000UL  // Muestras por modo en la prueba de rendimiento del filtro
+#define SIM_FILTER_OUTPUTS  300     // Salidas comparadas con la referencia en cada configuración
+#define SIM_PARSER_LINES    200000UL   // Líneas de la ráfaga del intérprete
+#define SIM_TEMP_RAW        1803    // Lectura del sensor para el informe de temperatura (~40°C)
+#define SIM_TEMP_TOLERANCE  50      // Error máximo admitido de adc_temp_mdeg_from_raw() en m°C
+#define SIM_TEMP_REPEAT     256     // Barridos completos de 12 bits para medir su rendimiento
+#define SIM_OUTPUT_SIZE     4096    // Salida de la UART que se conserva en cada paso
+#define SIM_IDLE_WINDOW_MS  2000    // Ventana de medida de los despertares en reposo
+#define SIM_IDLE_MAX_WAKES  20      // Despertares por segundo admitidos en reposo
+#define SIM_TIMER_LATE_MS   2       // Desviación admitida entre un vencimiento y su instante ideal
+#define SIM_TASK_PERIOD_MS  7       // Periodo de la tarea de prueba del planificador
+#define SIM_TASK_RUNS       12      // Activaciones medidas de la tarea de prueba
+#define SIM_DMA_LAP_BYTES   200     // Bytes recibidos sin leer en la prueba de vuelta del DMA
+
+// Temporizadores de la prueba de la rueda: vencimiento y veces que debe dispararse
+typedef struct
+{
+    uint32_t delay_ms;
+    uint32_t period_ms;
+    uint8_t expected;       // Disparos esperados (el periódico lo cancela el último)
+} sim_timer_case_t;
+
+// Paso de la prueba del firmware: opcionalmente una acción y bytes por RX, y lo que se espera
+typedef struct
+{
+    const char *name;
+    void (*action)(void);   // Se ejecuta al empezar el paso (opcional)
+    const char *input;      // Bytes enviados por RX (opcional)
+    const char *expect;     // Texto que debe aparecer en la salida (opcional)
+    uint8_t (*ready)(void); // Condición que debe cumplirse (opcional)
+    uint32_t timeout_ms;    // Plazo en tiempo virtual
+} sim_step_t;
+
+static uint8_t verbose = 0;
+static uint32_t failures = 0;
+static uint8_t step = 0;
+static uint8_t step_started = 0;
+static uint64_t step_deadline = 0;
+static char output[SIM_OUTPUT_SIZE];
+static uint32_t output_len = 0;
+static char step_detail[64];        // Detalle del resultado del paso (opcional)
+static uint64_t idle_start;         // Inicio de la medida de despertares
+static uint32_t idle_handlers;      // Manejadores al inicio de la medida
+static volatile int32_t sink; // Impide que el compilador elimine las conversiones medidas
+
+// Cortos, más largos que la rueda (varias vueltas), periódico y cancelado antes de vencer
+static const sim_timer_case_t timer_cases[] =
+{
+    { 5,  0,  1 },
+    { 37, 0,  1 },
+    { 10, 10, 3 },
+    { 20, 0,  0 },
+    { 70, 0,  1 },
+};
+
+#define TIMER_CASES (sizeof(timer_cases) / sizeof(timer_cases[0]))
+
+static soft_timer_t timers[TIMER_CASES];
+static uint32_t timer_start_ms;         // msTicks al armar los temporizadores
+static uint64_t timer_start_cycles;
+static uint8_t timer_fired[TIMER_CASES];
+static uint8_t timer_ok;                // Todos los disparos en su tick y a tiempo
+
+static int8_t task_id = SCHED_NO_TASK;
+static uint32_t task_ms[SIM_TASK_RUNS]; // msTicks de cada activación de la tarea de prueba
+static uint64_t task_cycles[SIM_TASK_RUNS];
+static uint8_t task_runs;
+
+static uint32_t overruns_start;         // uart_rx_overruns() antes de la prueba de vuelta del DMA
+
+/**
+ * @brief Segundos de reloj de pared, para los informes de rendimiento
+ *
+ * @return Tiempo monótono en segundos
+ */
+static double wall_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void check(int ok, const char *name, const char *detail)
+{
+    printf("%s%-16s %s%s%s\n", verbose ? "\n" : "", name, ok ? "PASS" : "FAIL", detail[0] ? "  " : "", detail);
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+static uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/**
+ * @brief Prueba de carga del buffer circular
+ *
+ * @details Ráfagas aleatorias de escritura y lectura (byte a byte o por bloques con
+ *          ring_linear_count()/ring_skip()) que comprueban el orden FIFO, que count más
+ *          space es siempre el tamaño y que push falla solo con el buffer lleno.
+ *
+ * @return Ninguno
+ */
+static void test_ring(void)
+{
+    static uint8_t storage[SIM_RING_SIZE];
+    ring_buffer_t rb;
+    uint32_t seed = 0x12345678;
+    uint8_t in = 0, out = 0;
+    uint32_t moved = 0;
+    int ok = 1;
+    char detail[64];
+    double t0;
+
+    ring_init(&rb, storage, SIM_RING_SIZE);
+    t0 = wall_time();
+
+    while (ok && moved < SIM_RING_OPS)
+    {
+        uint32_t r = xorshift32(&seed);
+        uint16_t n = (uint16_t)(r & (2 * SIM_RING_SIZE - 1));
+
+        for (uint16_t i = 0; i < n; i++)
+        {
+            uint8_t full = (ring_space(&rb) == 0);
+
+            if (ring_push(&rb, in) == full)
+            {
+                ok = 0;
+                break;
+            }
+            in += !full;
+        }
+
+        n = (uint16_t)((r >> 16) & (2 * SIM_RING_SIZE - 1));
+        if (r & 0x100)
+        {
+            const uint8_t *data;
+            uint16_t len;
+
+            while (n && (len = ring_linear_count(&rb, &data)) != 0)
+            {
+                len = (len > n) ? n : len;
+                for (uint16_t i = 0; i < len; i++)
+                {
+                    ok &= (data[i] == out++);
+                }
+                ring_skip(&rb, len);
+                moved += len;
+                n -= len;
+            }
+        }
+        else
+        {
+            uint8_t data;
+
+            while (n-- && ring_pop(&rb, &data))
+            {
+                ok &= (data == out++);
+                moved++;
+            }
+        }
+
+        ok &= (ring_count(&rb) + ring_space(&rb) == SIM_RING_SIZE);
+        ok &= (ring_count(&rb) == (uint8_t)(in - out) || ring_count(&rb) == SIM_RING_SIZE);
+    }
+
+    snprintf(detail, sizeof(detail), "%.1f Mbytes/s", moved / (wall_time() - t0) * 1e-6);
+    check(ok, "ring_buffer", detail);
+}
+
+/**
+ * @brief Muestra de prueba del filtro: escalones entre niveles aleatorios con ruido
+ *
+ * @return Muestra de 12 bits
+ */
+static uint16_t filter_input(uint32_t *seed, uint32_t n)
+{
+    static uint16_t level = 0;
+    uint32_t r = xorshift32(seed);
+
+    if ((n & 1023) == 0)
+    {
+        level = (uint16_t)(r & 0xFFF);  // Escalón cada 1024 muestras
+    }
+    r = level + (r >> 28) - 8;          // Ruido de ±8 cuentas
+    return (uint16_t)((r > 0xFFF) ? ((r & 0x80000000UL) ? 0 : 0xFFF) : r);
+}
+
+/**
+ * @brief Compara el filtro con una implementación de referencia
+ *
+ * @details La referencia guarda todas las salidas diezmadas y recalcula cada una sin
+ *          estado incremental: suma del bloque de 4^os_bits muestras, media móvil
+ *          re-sumando la ventana (rellenada con la primera salida) y el IIR con su
+ *          recurrencia y = y - y / 2^shift + x escrita sobre el historial. Un índice de
+ *          ventana erróneo, una resta de la salida más antigua equivocada o un estado
+ *          del IIR mal conservado dan otra salida.
+ *
+ * @return 1 si todas las salidas coinciden
+ */
+static int filter_matches_reference(uint8_t os_bits, filter_mode_t mode, uint8_t shift, uint32_t *seed)
+{
+    static uint16_t window[1U << FILTER_MAX_SHIFT];
+    static uint16_t history[SIM_FILTER_OUTPUTS];
+    uint32_t block = 1UL << (2 * os_bits);
+    uint64_t iir = 0;
+    uint32_t os_sum = 0;
+    uint32_t n = 0;
+    filter_t f;
+
+    if (!filter_init(&f, os_bits, mode, shift, window))
+    {
+        return 0;
+    }
+
+    for (uint32_t k = 0; k < SIM_FILTER_OUTPUTS; k++)
+    {
+        uint32_t ref;
+
+        os_sum = 0;
+        for (uint32_t i = 0; i < block; i++, n++)
+        {
+            uint16_t sample = filter_input(seed, n);
+
+            os_sum += sample;
+            if (filter_push(&f, sample) != (i == block - 1))
+            {
+                return 0; // Salida antes o después de completar el bloque
+            }
+        }
+        history[k] = (uint16_t)(os_sum >> os_bits);
+
+        if (mode == FILTER_MOVING_AVG)
+        {
+            uint64_t sum = 0;
+
+            for (uint32_t j = 0; j < (1UL << shift); j++)
+            {
+                sum += history[(k >= j) ? k - j : 0];
+            }
+            ref = (uint32_t)(sum >> shift);
+        }
+        else if (mode == FILTER_IIR)
+        {
+            iir = (k == 0) ? (uint64_t)history[0] << shift : iir - (iir >> shift) + history[k];
+            ref = (uint32_t)(iir >> shift);
+        }
+        else
+        {
+            ref = history[k];
+        }
+
+        if (!filter_ready(&f) || filter_output(&f) != ref)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Prueba del filtro frente a la referencia y medida de su rendimiento
+ *
+ * @details Recorre todos los bits de sobremuestreo con varias ventanas y constantes
+ *          de tiempo sobre entrada con escalones y ruido; después mide el coste por
+ *          muestra en los tres modos.
+ *
+ * @return Ninguno
+ */
+static void test_filter(void)
+{
+    static uint16_t window[1U << 4];
+    static const filter_mode_t modes[] = { FILTER_NONE, FILTER_MOVING_AVG, FILTER_IIR };
+    static const uint8_t shifts[] = { 0, 1, 3, 4, 6 };
+    uint32_t seed = 0xC0FFEE01;
+    uint16_t configs = 0;
+    filter_t f;
+    int ok = 1;
+    char detail[64];
+    double t0;
+
+    for (uint8_t os_bits = 0; os_bits <= FILTER_OS_MAX_BITS; os_bits++)
+    {
+        for (uint8_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+        {
+            for (uint8_t s = 0; s < sizeof(shifts); s++)
+            {
+                if (!filter_matches_reference(os_bits, modes[m], shifts[s], &seed))
+                {
+                    printf("filter mismatch: os_bits %u mode %u shift %u\n", os_bits, modes[m], shifts[s]);
+                    ok = 0;
+                }
+                configs++;
+            }
+        }
+    }
+
+    t0 = wall_time();
+    for (uint8_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+    {
+        ok &= filter_init(&f, 3, modes[m], 4, window);
+        for (uint32_t i = 0; i < SIM_FILTER_SAMPLES; i++)
+        {
+            filter_push(&f, (uint16_t)(i & 0xFFF));
+        }
+    }
+
+    snprintf(detail, sizeof(detail), "%u configs, %.1f Msamples/s", configs,
+             3.0 * SIM_FILTER_SAMPLES / (wall_time() - t0) * 1e-6);
+    check(ok, "filter", detail);
+}
+
+/**
+ * @brief Prueba de los pools de memoria
+ *
+ * @details Agota la clase pequeña, comprueba que cada bloque es distinto y que una
+ *          petición más cae en la siguiente clase, y que mempool_free() ignora la
+ *          segunda liberación de un bloque, un bloque nunca reservado, un puntero
+ *          interior y uno ajeno sin alterar la lista ni las estadísticas.
+ *
+ * @return Ninguno
+ */
+static void test_mempool(void)
+{
+    void *blocks[MEMPOOL_SMALL_COUNT];
+    static uint8_t foreign[MEMPOOL_SMALL_SIZE];
+    mempool_stats_t small, medium;
+    void *spill, *a, *b;
+    int ok = 1;
+
+    mempool_init();
+
+    for (uint16_t i = 0; i < MEMPOOL_SMALL_COUNT; i++)
+    {
+        blocks[i] = mempool_alloc(MEMPOOL_SMALL_SIZE);
+        ok &= (blocks[i] != 0);
+        for (uint16_t j = 0; j < i; j++)
+        {
+            ok &= (blocks[j] != blocks[i]);
+        }
+    }
+    spill = mempool_alloc(1);           // Clase pequeña agotada: bloque mediano
+    mempool_stats(MEMPOOL_MEDIUM, &medium);
+    ok &= (spill != 0 && medium.used == 1);
+    mempool_free(spill);
+
+    mempool_free(blocks[3]);
+    mempool_free(blocks[3]);            // Segunda liberación
+    mempool_free((uint8_t *)blocks[5] + 4); // Puntero interior
+    mempool_free(foreign);              // Fuera de los pools
+    mempool_stats(MEMPOOL_SMALL, &small);
+    ok &= (small.used == MEMPOOL_SMALL_COUNT - 1 && small.high_water == MEMPOOL_SMALL_COUNT);
+
+    a = mempool_alloc(MEMPOOL_SMALL_SIZE);
+    b = mempool_alloc(MEMPOOL_SMALL_SIZE);
+    mempool_stats(MEMPOOL_SMALL, &small);
+    ok &= (a == blocks[3] && b != a && b != blocks[3]); // b sale de la clase mediana
+    ok &= (small.used == MEMPOOL_SMALL_COUNT);
+
+    for (uint16_t i = 0; i < MEMPOOL_SMALL_COUNT; i++)
+    {
+        mempool_free(blocks[i]);
+    }
+    mempool_free(b);
+    mempool_free(blocks[0]);            // Ya libre: no puede volver a encadenarse
+    mempool_stats(MEMPOOL_SMALL, &small);
+    mempool_stats(MEMPOOL_MEDIUM, &medium);
+    ok &= (small.used == 0 && medium.used == 0);
+
+    for (uint16_t i = 0; i < MEMPOOL_SMALL_COUNT; i++)
+    {
+        blocks[i] = mempool_alloc(MEMPOOL_SMALL_SIZE);
+        for (uint16_t j = 0; j < i; j++)
+        {
+            ok &= (blocks[j] != blocks[i]); // Sin ciclos en la lista de libres
+        }
+    }
+    mempool_stats(MEMPOOL_SMALL, &small);
+    ok &= (small.used == MEMPOOL_SMALL_COUNT && small.failures == 0);
+
+    mempool_init();                     // El firmware arranca con los pools vacíos
+    check(ok, "mempool", "");
+}
+
+static uint64_t ms_to_cycles(uint32_t ms)
+{
+    return (uint64_t)ms * (sim_core_clock() / 1000);
+}
+
+static void step_temp_input(void)
+{
+    sim_adc_set(ADC_CH_TEMP, SIM_TEMP_RAW);
+}
+
+static void step_temp_normal(void)
+{
+    sim_adc_set(ADC_CH_TEMP, SIM_TS_CAL30); // 30°C
+}
+
+/**
+ * @brief Valor de TIM2_CCR1 para un nivel de brillo (mismo cálculo que pwm.c)
+ *
+ * @return Cuentas del ciclo de trabajo del LED
+ */
+static uint32_t led_counts(uint8_t level)
+{
+    uint16_t duty = gamma_table[level];
+
+    return (duty == PWM_DUTY_MAX) ? pwm_get_steps(PWM_TIM2)
+                                  : ((uint32_t)duty * pwm_get_steps(PWM_TIM2)) >> 16;
+}
+
+static uint8_t led_is_50(void)
+{
+    return sim_hw.tim2.CCR[0] == led_counts(50);
+}
+
+static uint8_t led_is_99(void)
+{
+    return led_seq_state() == LED_SEQ_DONE && sim_hw.tim2.CCR[0] == led_counts(99);
+}
+
+static void timer_fire(soft_timer_t *t)
+{
+    uint8_t i = (uint8_t)(t - timers);
+    const sim_timer_case_t *c = &timer_cases[i];
+    uint32_t due_ms = c->delay_ms + c->period_ms * timer_fired[i];
+    int64_t late = (int64_t)(sim_cycles() - timer_start_cycles) - (int64_t)ms_to_cycles(due_ms);
+
+    timer_ok &= (msTicks - timer_start_ms == due_ms);
+    timer_ok &= (late <= (int64_t)ms_to_cycles(SIM_TIMER_LATE_MS) && -late <= (int64_t)ms_to_cycles(SIM_TIMER_LATE_MS));
+    timer_fired[i]++;
+
+    if (i == 1)
+    {
+        timer_cancel(&timers[2]);       // El de 37ms cancela el periódico tras su tercer disparo
+    }
+}
+
+/**
+ * @brief Arma los temporizadores de prueba y despierta al firmware
+ *
+ * @details El gancho se ejecuta al entrar en WFI, con el SysTick ya alargado para el
+ *          reposo calculado antes de armarlos: la línea vacía por RX despierta al
+ *          firmware para que system_sleep() los tenga en cuenta.
+ *
+ * @return Ninguno
+ */
+static void step_timers(void)
+{
+    timer_start_ms = msTicks;
+    timer_start_cycles = sim_cycles();
+    timer_ok = 1;
+    for (uint8_t i = 0; i < TIMER_CASES; i++)
+    {
+        timer_fired[i] = 0;
+        timer_init(&timers[i], timer_fire);
+        timer_arm(&timers[i], timer_cases[i].delay_ms, timer_cases[i].period_ms);
+    }
+    timer_cancel(&timers[3]);           // Cancelado antes de vencer: no debe dispararse
+}
+
+static uint8_t timers_done(void)
+{
+    uint8_t ok = timer_ok;
+
+    for (uint8_t i = 0; i < TIMER_CASES; i++)
+    {
+        if (timer_armed(&timers[i]))
+        {
+            return 0;
+        }
+        ok &= (timer_fired[i] == timer_cases[i].expected);
+    }
+    return ok;
+}
+
+static void task_probe(void)
+{
+    if (task_runs < SIM_TASK_RUNS)
+    {
+        task_ms[task_runs] = msTicks;
+        task_cycles[task_runs] = sim_cycles();
+        task_runs++;
+    }
+}
+
+/**
+ * @brief Registra una tarea periódica de prueba en el planificador del firmware
+ *
+ * @return Ninguno
+ */
+static void step_sched(void)
+{
+    task_runs = 0;
+    task_id = sched_add_periodic(task_probe, SIM_TASK_PERIOD_MS, SIM_TASK_PERIOD_MS, 1);
+}
+
+/**
+ * @brief Comprueba las activaciones de la tarea de prueba y la retira
+ *
+ * @details Cada activación debe llegar exactamente un periodo de msTicks después de la
+ *          anterior y, en tiempo virtual, dentro de SIM_TIMER_LATE_MS de ese instante
+ *          (el reposo sin ticks no puede retrasarla), sin plazos incumplidos.
+ *
+ * @return 1 cuando ha medido todas las activaciones y son correctas
+ */
+static uint8_t sched_done(void)
+{
+    const sched_task_t *info;
+    uint8_t ok = 1;
+
+    if (task_id == SCHED_NO_TASK || task_runs < SIM_TASK_RUNS)
+    {
+        return 0;
+    }
+
+    info = sched_task_info(task_id);
+    ok &= (info != 0 && info->misses == 0);
+    for (uint8_t i = 1; i < SIM_TASK_RUNS; i++)
+    {
+        uint64_t gap = task_cycles[i] - task_cycles[i - 1];
+
+        ok &= (task_ms[i] - task_ms[i - 1] == SIM_TASK_PERIOD_MS);
+        ok &= (gap + ms_to_cycles(SIM_TIMER_LATE_MS) >= ms_to_cycles(SIM_TASK_PERIOD_MS) &&
+               gap <= ms_to_cycles(SIM_TASK_PERIOD_MS + SIM_TIMER_LATE_MS));
+    }
+    sched_remove(task_id);
+    task_id = SCHED_NO_TASK;
+    return ok;
+}
+
+static void step_idle_start(void)
+{
+    idle_start = sim_cycles();
+    idle_handlers = sim_handler_count();
+}
+
+/**
+ * @brief Despertares por segundo sin informe de temperatura ni alarma
+ *
+ * @details Cada manejador ejecutado es un despertar de WFI. Sin el filtro del sensor
+ *          solo deberían quedar el SysTick de las tareas periódicas y sus reposos largos.
+ *
+ * @return 1 cuando ha pasado la ventana y la tasa está dentro del límite
+ */
+static uint8_t idle_wakes_ok(void)
+{
+    uint64_t elapsed = sim_cycles() - idle_start;
+    uint32_t rate;
+
+    if (elapsed < ms_to_cycles(SIM_IDLE_WINDOW_MS))
+    {
+        return 0;
+    }
+    rate = (uint32_t)((uint64_t)(sim_handler_count() - idle_handlers) * sim_core_clock() / elapsed);
+    snprintf(step_detail, sizeof(step_detail), "%lu wakes/s", (unsigned long)rate);
+    return rate <= SIM_IDLE_MAX_WAKES;
+}
+
+/**
+ * @brief Ráfaga de líneas entregadas directamente al intérprete
+ *
+ * @details La UART descarta la salida durante la ráfaga para medir solo el análisis,
+ *          la ejecución del comando y el formateo de la respuesta. Después se comprueba
+ *          el efecto: el LED queda en el último nivel de la ráfaga, una línea de
+ *          CMD_LINE_MAX + 1 caracteres se descarta entera y una de CMD_LINE_MAX se ejecuta.
+ *
+ * @return Ninguno
+ */
+static void step_parser(void)
+{
+    static const char line[] = "L42;L7\r";
+    char detail[64];
+    int ok;
+    double t0;
+
+    uart_flush();
+    uart_set_tx_policy(UART_TX_DROP);
+
+    t0 = wall_time();
+    for (uint32_t n = 0; n < SIM_PARSER_LINES; n++)
+    {
+        for (const char *c = line; *c; c++)
+        {
+            cmd_feed(*c);
+        }
+    }
+    snprintf(detail, sizeof(detail), "%.2f Mlines/s", SIM_PARSER_LINES / (wall_time() - t0) * 1e-6);
+    ok = (sim_hw.tim2.CCR[0] == led_counts(7));
+
+    for (uint8_t n = 0; n <= CMD_LINE_MAX; n++)
+    {
+        cmd_feed("L50;"[n & 3]);        // 65 caracteres: "L50;" x 16 + "L"
+    }
+    cmd_feed('\r');
+    ok &= (sim_hw.tim2.CCR[0] == led_counts(7));
+
+    for (uint8_t n = 0; n < CMD_LINE_MAX; n++)
+    {
+        cmd_feed("L50;"[n & 3]);        // Exactamente CMD_LINE_MAX caracteres
+    }
+    cmd_feed('\r');
+    ok &= (sim_hw.tim2.CCR[0] == led_counts(50));
+
+    uart_set_tx_policy(UART_TX_BLOCK);
+    uart_flush();
+    check(ok, "parser", detail);
+}
+
+static void step_uart_dma(void)
+{
+    uart_set_mode(UART_MODE_DMA);
+}
+
+/**
+ * @brief Recibe por DMA más de un buffer sin que el firmware lo lea
+ *
+ * @details El gancho retiene al firmware (que está en WFI) mientras avanza el tiempo
+ *          virtual: el canal 5 da varias vueltas sobre bytes sin leer. Se envían
+ *          espacios y un CR, de modo que lo que sobrevive es una línea vacía.
+ *
+ * @return Ninguno
+ */
+static void step_dma_lap(void)
+{
+    static uint8_t burst[SIM_DMA_LAP_BYTES + 1];
+    uint16_t sent = 0;
+
+    memset(burst, ' ', SIM_DMA_LAP_BYTES);
+    burst[SIM_DMA_LAP_BYTES] = '\r';
+    overruns_start = uart_rx_overruns();
+    while (sent < sizeof(burst) || sim_uart_rx_pending())
+    {
+        sent += sim_uart_rx_write(burst + sent, (uint16_t)(sizeof(burst) - sent));
+        sim_poll();
+    }
+}
+
+/**
+ * @brief Comprueba que los bytes sobrescritos por el DMA constan como perdidos
+ *
+ * @return 1 cuando el firmware ha leído lo que quedaba y la cuenta es exacta
+ */
+static uint8_t dma_lap_counted(void)
+{
+    uint32_t lost = uart_rx_overruns() - overruns_start;
+
+    snprintf(step_detail, sizeof(step_detail), "%lu bytes lost", (unsigned long)lost);
+    return uart_data_available() == 0 && lost == SIM_DMA_LAP_BYTES + 1 - UART_RX_DMA_SIZE;
+}
+
+/**
+ * @brief Barrido de adc_temp_mdeg_from_raw() frente a la fórmula en coma flotante
+ *
+ * @return Ninguno
+ */
+static void step_temp_sweep(void)
+{
+    double vdd = adc_get_vdd();
+    double max_err = 0;
+    char detail[64];
+    double t0;
+
+    for (uint16_t raw = 0; raw < 4096; raw++)
+    {
+        double ref = (raw * vdd / 3300.0 - SIM_TS_CAL30) * 1e6 / 5336.0 + 30000.0;
+        double err = adc_temp_mdeg_from_raw(raw) - ref;
+
+        err = (err < 0) ? -err : err;
+        max_err = (err > max_err) ? err : max_err;
+    }
+
+    t0 = wall_time();
+    for (uint32_t n = 0; n < SIM_TEMP_REPEAT; n++)
+    {
+        for (uint16_t raw = 0; raw < 4096; raw++)
+        {
+            sink = adc_temp_mdeg_from_raw(raw);
+        }
+    }
+
+    snprintf(detail, sizeof(detail), "max error %.1f mdegC, %.1f Mconv/s", max_err,
+             SIM_TEMP_REPEAT * 4096.0 / (wall_time() - t0) * 1e-6);
+    check(max_err <= SIM_TEMP_TOLERANCE, "temp_sweep", detail);
+}
+
+static const sim_step_t steps[] =
+{
+    { "boot",       0,                  0,          "STM32F0xx Demo",               0,          100 },
+    { "adc_ready",  0,                  0,          0,                              adc_ready,  500 },
+    { "led",        0,                  "L50\r",    "LED brightness set to 50%",    0,          500 },
+    { "temp_on",    step_temp_input,    "T\r",      "Temperature reading ON",       0,          100 },
+    { "temp_value", 0,                  0,          "Temp: 40 degC",                0,          1500 },
+    { "temp_off",   0,                  "T\r",      "Temperature reading OFF",      0,          100 },
+    { "alarm_high", 0,                  "A35\r",    "Temperature alarm HIGH",       0,          200 },
+    { "alarm_clear", step_temp_normal,  0,          "Temperature alarm cleared",    0,          200 },
+    { "alarm_off",  0,                  "A0\r",     "Temperature alarm OFF",        0,          200 },
+    { "idle_wakes", step_idle_start,    0,          0,                              idle_wakes_ok, SIM_IDLE_WINDOW_MS + 100 },
+    { "long_line",  0,                  "L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;L10;\r",
+                                                    "Line too long",                led_is_50,  1000 },
+    { "sequence",   0,                  "Q 10 50 99;S 5\r", "Sequence: 3 steps every 5 ms", led_is_99, 1000 },
+    { "timer_wheel", step_timers,       "\r",       0,                              timers_done, 200 },
+    { "scheduler",  step_sched,         "\r",       0,                              sched_done, 200 },
+    { "parser",     step_parser,        0,          0,                              0,          0 },
+    { "uart_dma",   step_uart_dma,      "L60\r",    "LED brightness set to 60%",    0,          500 },
+    { "help_dma",   0,                  "H\r",      "to show this help",            0,          1000 },
+    { "dma_rx_lap", step_dma_lap,       0,          0,                              dma_lap_counted, 1000 },
+    { "after_lap",  0,                  "L30\r",    "LED brightness set to 30%",    0,          500 },
+    { "temp_sweep", step_temp_sweep,    0,          0,                              0,          0 },
+};
+
+#define STEP_COUNT  (sizeof(steps) / sizeof(steps[0]))
+
+static void finish(void)
+{
+    printf("%lu checks failed, %.3f s virtual\n", (unsigned long)failures,
+           (double)sim_cycles() / sim_core_clock());
+    exit(failures ? 1 : 0);
+}
+
+/**
+ * @brief Gancho de inactividad: avanza la secuencia de pasos
+ *
+ * @details Se llama cada vez que el firmware duerme. Un paso termina cuando su texto
+ *          esperado aparece en la salida de la UART y se cumple su condición o, si no
+ *          espera nada, en cuanto se ejecuta su acción; falla si vence su plazo en
+ *          tiempo virtual.
+ *
+ * @return Ninguno
+ */
+static void idle_hook(void)
+{
+    const sim_step_t *s;
+
+    while (step < STEP_COUNT)
+    {
+        s = &steps[step];
+
+        if (!step_started)
+        {
+            step_started = 1;
+            step_deadline = sim_cycles() + ms_to_cycles(s->timeout_ms);
+            if (s->action)
+            {
+                s->action();
+            }
+            if (s->input)
+            {
+                sim_uart_rx_write((const uint8_t *)s->input, (uint16_t)strlen(s->input));
+            }
+        }
+
+        output_len += sim_uart_tx_read(output + output_len, sizeof(output) - output_len);
+        if (output_len == sizeof(output) - 1)
+        {
+            memmove(output, output + output_len / 2, output_len - output_len / 2 + 1);
+            output_len -= output_len / 2;
+        }
+
+        if (!s->expect && !s->ready)
+        {
+            // La acción del paso informa de su propio resultado
+        }
+        else if ((!s->expect || strstr(output, s->expect)) && (!s->ready || s->ready()))
+        {
+            check(1, s->name, step_detail);
+        }
+        else if (sim_cycles() < step_deadline)
+        {
+            return; // Esperar a la siguiente vez que el firmware duerma
+        }
+        else
+        {
+            check(0, s->name, step_detail[0] ? step_detail : "timeout");
+        }
+
+        step++;
+        step_started = 0;
+        output_len = 0;
+        output[0] = '\0';
+        step_detail[0] = '\0';
+    }
+
+    finish();
+}
+
+int main(int argc, char **argv)
+{
+    verbose = (argc > 1 && strcmp(argv[1], "-v") == 0);
+    sim_uart_echo(verbose);
+
+    test_ring();
+    test_filter();
+    test_mempool();
+
+    sim_reset();
+    sim_set_idle_hook(idle_hook);
+    SystemInit();
+    firmware_main();
+
+    return 2; // firmware_main() no retorna
+}
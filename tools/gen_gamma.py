@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""Genera la tabla de corrección de brillo del LED (Src/gamma.c).
+
+Cada nivel de brillo percibido (0 a levels - 1) se convierte en un ciclo de
+trabajo de 16 bits para pwm_set_duty(), de forma que el firmware solo hace una
+lectura de tabla en Flash, sin pow() ni coma flotante en el Cortex-M0.
+
+Curvas disponibles:
+  cie    Luminosidad CIE 1976 L* (por defecto): percepción uniforme a lo largo
+         de todo el rango.
+  gamma  Potencia simple duty = level^gamma.
+
+Uso:
+  python3 tools/gen_gamma.py                  # escribe Src/gamma.c
+  python3 tools/gen_gamma.py --curve gamma --gamma 2.2
+  python3 tools/gen_gamma.py --output -       # salida estándar
+"""
+
+import argparse
+import os
+import sys
+
+DUTY_MAX = 0xFFFF  # PWM_DUTY_MAX: salida siempre activa
+
+
+def cie_luminance(lightness):
+    """Luminancia relativa (0-1) de una luminosidad L* (0-100)."""
+    if lightness <= 8.0:
+        return lightness / 903.3
+    return ((lightness + 16.0) / 116.0) ** 3
+
+
+def build_table(levels, curve, gamma):
+    table = []
+    for level in range(levels):
+        x = level / (levels - 1)
+        if curve == "cie":
+            y = cie_luminance(100.0 * x)
+        else:
+            y = x ** gamma
+        table.append(int(round(y * DUTY_MAX)))
+    return table
+
+
+def render(table, curve, gamma):
+    if curve == "cie":
+        desc = "luminosidad CIE 1976 L*"
+    else:
+        desc = "gamma %.2f" % gamma
+
+    lines = [
+        "/**",
+        " * @file gamma.c",
+        " * @brief Tabla de corrección de brillo del LED (%s)" % desc,
+        " * @details Generado por tools/gen_gamma.py: no editar a mano.",
+        " *          gamma_table[n] es el ciclo de trabajo de 16 bits (pwm_set_duty()) que",
+        " *          corresponde al nivel de brillo percibido n.",
+        " */",
+        "",
+        '#include "gamma.h"',
+        "",
+        "const uint16_t gamma_table[GAMMA_LEVELS] =",
+        "{",
+    ]
+
+    per_line = 10
+    for i in range(0, len(table), per_line):
+        chunk = table[i:i + per_line]
+        row = ", ".join("%5u" % v for v in chunk)
+        sep = "," if i + per_line < len(table) else " "
+        lines.append("    %s%s   // %d-%d" % (row, sep, i, i + len(chunk) - 1))
+
+    lines.append("};")
+    lines.append("")
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--levels", type=int, default=100,
+                        help="niveles de brillo (debe coincidir con GAMMA_LEVELS, por defecto 100)")
+    parser.add_argument("--curve", choices=("cie", "gamma"), default="cie",
+                        help="curva de corrección (por defecto cie)")
+    parser.add_argument("--gamma", type=float, default=2.2,
+                        help="exponente de la curva gamma (por defecto 2.2)")
+    parser.add_argument("--output", default=None,
+                        help="fichero de salida (por defecto Src/gamma.c, '-' para la salida estándar)")
+    args = parser.parse_args()
+
+    if args.levels < 2:
+        parser.error("--levels debe ser al menos 2")
+
+    text = render(build_table(args.levels, args.curve, args.gamma), args.curve, args.gamma)
+
+    if args.output == "-":
+        sys.stdout.write(text)
+        return
+
+    output = args.output
+    if output is None:
+        output = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "Src", "gamma.c")
+
+    with open(output, "w", newline="\n") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()